@@ -0,0 +1,159 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "bare/Arena.h"
+
+using namespace bare;
+
+static inline uint8_t* alignUp(uint8_t* p, size_t alignment)
+{
+    uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<uint8_t*>((addr + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+}
+
+Arena::~Arena()
+{
+    Block* block = _first;
+    while (block) {
+        Block* next = block->next;
+        delete [ ] reinterpret_cast<uint8_t*>(block);
+        block = next;
+    }
+}
+
+bool Arena::nextBlock(size_t size, size_t alignment)
+{
+    // Use the block after the current one if it's big enough. Otherwise
+    // put a new block in front of it. Blocks which are too small for this
+    // request stay in the chain for later requests
+    size_t needed = size + alignment - 1;
+    Block* next = _current ? _current->next : _first;
+    if (!next || next->size < needed) {
+        size_t blockSize = (needed > _blockSize) ? needed : _blockSize;
+        Block* block = reinterpret_cast<Block*>(new uint8_t[sizeof(Block) + blockSize]);
+        if (!block) {
+            return false;
+        }
+        block->size = blockSize;
+        block->next = next;
+        if (_current) {
+            _current->next = block;
+        } else {
+            _first = block;
+        }
+        next = block;
+    }
+    
+    _current = next;
+    _cur = next->start();
+    _end = next->end();
+    return true;
+}
+
+void* Arena::alloc(size_t size, size_t alignment)
+{
+    uint8_t* p = alignUp(_cur, alignment);
+    if (!_cur || p + size > _end) {
+        if (!nextBlock(size, alignment)) {
+            return nullptr;
+        }
+        p = alignUp(_cur, alignment);
+    }
+    
+    _cur = p + size;
+    _last = p;
+    return p;
+}
+
+void Arena::free(void* addr, size_t size)
+{
+    if (addr && addr == _last && _last + size == _cur) {
+        _cur = _last;
+        _last = nullptr;
+    }
+}
+
+bool Arena::expand(void* addr, size_t oldSize, size_t newSize)
+{
+    if (newSize <= oldSize) {
+        return true;
+    }
+    if (!addr || addr != _last || _last + oldSize != _cur || _last + newSize > _end) {
+        return false;
+    }
+    _cur = _last + newSize;
+    return true;
+}
+
+void Arena::release(const Mark& mark)
+{
+    _last = nullptr;
+    _current = mark._block;
+    if (!_current) {
+        _cur = _end = nullptr;
+        return;
+    }
+    _cur = mark._cur;
+    _end = _current->end();
+}
+
+void Arena::reset()
+{
+    release(Mark(nullptr, nullptr));
+}
+
+size_t Arena::used() const
+{
+    if (!_current) {
+        return 0;
+    }
+    
+    size_t size = 0;
+    for (Block* block = _first; block != _current; block = block->next) {
+        size += block->size;
+    }
+    return size + (_cur - _current->start());
+}
+
+size_t Arena::capacity() const
+{
+    size_t size = 0;
+    for (Block* block = _first; block; block = block->next) {
+        size += block->size;
+    }
+    return size;
+}
@@ -49,6 +49,15 @@ OBJCOPY = $(TOOLCHAIN)objcopy
 ASFLAGS = -mcpu=arm1176jzf-s -mfpu=vfp
 CFLAGS = $(INCLUDES) -D$(PLATFORM) -D$(FLOATTYPE) -Wall -nostdlib -nostartfiles -ffreestanding -mcpu=arm1176jzf-s -mtune=arm1176jzf-s -mhard-float -mfpu=vfp -MMD
 
+# Keep gcc from turning the loops in memcpy, memset, etc. (bare.cpp) into
+# calls to those same functions
+CFLAGS += -fno-tree-loop-distribute-patterns
+
+# FLOATNONE is the bootloader's build, which has no room for the trace ring
+ifeq ($(FLOATTYPE), FLOATNONE)
+    CFLAGS += -DDISABLE_TRACE
+endif
+
 DEBUG ?= 0
 ifeq ($(DEBUG), 1)
     CFLAGS += -DDEBUG -g
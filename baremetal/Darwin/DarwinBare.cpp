@@ -68,6 +68,14 @@ bool interruptsSupported()
     return false;
 }
 
+void WFE()
+{
+}
+
+void SEV()
+{
+}
+
 void restart()
 {
     printf("RESTART\n");
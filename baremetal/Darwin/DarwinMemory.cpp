@@ -49,6 +49,34 @@ static constexpr uint32_t MinHeapSize = 0x1000;
 
 Memory::Heap* Memory::_kernelHeap = nullptr;
 
+// The host C++ runtime allocates before main, so this is bigger than on RPi
+static constexpr size_t BootstrapHeapSize = 0x10000;
+alignas(Memory::DefaultPageSize) static uint8_t _bootstrapHeapMemory[BootstrapHeapSize];
+static size_t _bootstrapHeapUsed = 0;
+
+bool Memory::mapBootstrapSegment(size_t size, void*& addr)
+{
+    size = (size + DefaultPageSize - 1) / DefaultPageSize * DefaultPageSize;
+    if (size > BootstrapHeapSize - _bootstrapHeapUsed) {
+        return false;
+    }
+    addr = _bootstrapHeapMemory + _bootstrapHeapUsed;
+    _bootstrapHeapUsed += size;
+    return true;
+}
+
+size_t Memory::bootstrapHeapSize()
+{
+    return BootstrapHeapSize;
+}
+
+size_t Memory::bootstrapHeapUsed()
+{
+    return _bootstrapHeapUsed;
+}
+
+Memory::ExpandFunction Memory::_expandFunction = nullptr;
+
 void* Memory::heapStart()
 {
     return _kernelHeapMemory;
@@ -50,9 +50,11 @@ void  Timer::init()
     // FIXME:: Implement
 }
 
+// There are no timer interrupts on the host. Calling this fires the
+// timers which are due
 void Timer::handleInterrupt()
 {
-    // FIXME:: Implement
+    fireDue();
 }
 
 void Timer::updateTimers()
@@ -39,6 +39,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare/FAT32DirectoryIterator.h"
 #include "bare/Serial.h"
+#include "bare/Trace.h"
 
 using namespace bare;
 
@@ -116,6 +117,7 @@ Volume::Error FAT32::rawWrite(const char* buf, Block block, uint32_t blocks)
 
 Volume::Error FAT32::mount()
 {
+    TRACE_SCOPE("fat.mount");
     _error = static_cast<FAT32::Error>(Volume::Error::OK);
     
     if (_partition >= 4) {
@@ -200,6 +202,7 @@ Volume::Error FAT32::mount()
 
 bool FAT32::readFATBlock(uint32_t block)
 {
+    TRACE_SCOPE("fat.readFATBlock");
     if (!_fatBufferValid || block != _currentFATBufferAddr) {
         if (_fatBufferNeedsWriting) {
             if (!writeFATBlock()) {
@@ -219,6 +222,7 @@ bool FAT32::readFATBlock(uint32_t block)
 
 bool FAT32::writeFATBlock()
 {
+    TRACE_SCOPE("fat.writeFATBlock");
     if (!_fatBufferValid || !_fatBufferNeedsWriting) {
         return true;
     }
@@ -261,6 +265,7 @@ FAT32::FATEntryType FAT32::nextClusterFATEntry(Cluster cluster, Cluster& nextClu
 
 Cluster FAT32::allocateCluster(Cluster prev)
 {
+    TRACE_SCOPE("fat.allocateCluster");
     Cluster dummyCluster;
     uint32_t lastCluster = _blocksPerFAT * 512 / sizeof(uint32_t) - 1;
     
@@ -335,6 +340,7 @@ bool FAT32::freeClusters(Cluster cluster)
 
 bool FAT32::find(FileInfo& fileInfo, const char* name)
 {
+    TRACE_SCOPE("fat.find");
     // Convert the incoming filename to 8.3 and then compare all 11 characters
     char nameToFind[12];
     convertTo8dot3(nameToFind, name);
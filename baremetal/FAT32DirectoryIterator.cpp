@@ -37,6 +37,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare/FAT32DirectoryIterator.h"
 
+#include "bare/Trace.h"
+
 using namespace bare;
 
 FAT32DirectoryIterator::FAT32DirectoryIterator(FAT32* fs, const char* path)
@@ -49,6 +51,7 @@ FAT32DirectoryIterator::FAT32DirectoryIterator(FAT32* fs, const char* path)
 
 DirectoryIterator& FAT32DirectoryIterator::next()
 {
+    TRACE_SCOPE("fat.dirNext");
     while (1) {
         rawNext();
         if (!deleted() && !subdir()) {
@@ -67,7 +67,7 @@ Volume::Error FAT32RawFile::write(const char* buf, Block logicalBlock, uint32_t
 Volume::Error FAT32RawFile::rename(const char* to)
 {
     if (_directoryBlock == 0) {
-        Serial::printf("*** FAT32RawFile::rename invalid directoryBlock\n");
+        Serial::printf(FMT("*** FAT32RawFile::rename invalid directoryBlock\n"));
         return Volume::Error::InternalError;
     }
     
@@ -101,7 +101,7 @@ Volume::Error FAT32RawFile::insertCluster()
 Volume::Error FAT32RawFile::updateSize()
 {
     if (_directoryBlock == 0) {
-        Serial::printf("*** FAT32RawFile::updateSize invalid directoryBlock\n");
+        Serial::printf(FMT("*** FAT32RawFile::updateSize invalid directoryBlock\n"));
         return Volume::Error::InternalError;
     }
     
@@ -151,10 +151,10 @@ Volume::Error FAT32RawFile::logicalToPhysicalBlock(Block logicalBlock, Block& ph
                 return Volume::Error::EndOfFile;
             }
             if (type == FAT32::FATEntryType::Error) {
-                Serial::printf("**** Error: failed to read FAT block\n");
+                Serial::printf(FMT("**** Error: failed to read FAT block\n"));
                 return Volume::Error::Failed;
             }
-            Serial::printf("**** Error: Disk inconsistency - next FAT entry is free\n");
+            Serial::printf(FMT("**** Error: Disk inconsistency - next FAT entry is free\n"));
             return Volume::Error::InternalError;
         }
     }
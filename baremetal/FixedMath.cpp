@@ -0,0 +1,506 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare/FixedMath.h"
+
+#include <limits>
+
+using namespace bare;
+
+static constexpr int64_t One = FixedMath::One;
+
+// Constants are Q30 unless they say otherwise. Pi / 2 and ln 2 are also
+// split into a rounded down Q30 part and the 31 bits below it, for
+// reducing large arguments
+static constexpr int64_t Pi = 3373259426;
+static constexpr int64_t HalfPi = 1686629713;
+static constexpr int64_t HalfPiLow = 140128397;
+static constexpr int64_t Ln2 = 744261117;
+static constexpr int64_t Ln2Low = 2050617141;
+static constexpr int64_t Log2e = 1549082005;
+
+// 128 / pi in Q24 and pi / 128 in Q40, for the sin table index and step
+static constexpr int64_t SinIndexScale = 683565276;
+static constexpr int64_t SinStep = 26986075409;
+
+// log2(e) in Q24, to find the power of two for exp
+static constexpr int64_t Log2eQ24 = 24204406;
+
+// sin(i * pi / 128). Entry 64 - i is cos(i * pi / 128)
+static const int32_t sinTable[65] = {
+    0, 26350943, 52686014, 78989349, 105245103, 131437462,
+    157550647, 183568930, 209476638, 235258165, 260897982, 286380643,
+    311690799, 336813204, 361732726, 386434353, 410903207, 435124548,
+    459083786, 482766489, 506158392, 529245404, 552013618, 574449320,
+    596538995, 618269338, 639627258, 660599890, 681174602, 701339000,
+    721080937, 740388522, 759250125, 777654384, 795590213, 813046808,
+    830013654, 846480531, 862437520, 877875009, 892783698, 907154608,
+    920979082, 934248793, 946955747, 959092290, 970651112, 981625251,
+    992008094, 1001793390, 1010975242, 1019548121, 1027506862, 1034846671,
+    1041563127, 1047652185, 1053110176, 1057933813, 1062120190, 1065666786,
+    1068571464, 1070832474, 1072448455, 1073418433, 1073741824,
+};
+
+// 2^(i / 64)
+static const uint32_t exp2Table[64] = {
+    1073741824, 1085434106, 1097253708, 1109202018, 1121280436, 1133490379,
+    1145833280, 1158310587, 1170923762, 1183674286, 1196563654, 1209593378,
+    1222764986, 1236080024, 1249540052, 1263146652, 1276901417, 1290805962,
+    1304861917, 1319070932, 1333434672, 1347954824, 1362633090, 1377471191,
+    1392470869, 1407633882, 1422962010, 1438457051, 1454120821, 1469955159,
+    1485961921, 1502142985, 1518500250, 1535035634, 1551751076, 1568648537,
+    1585730000, 1602997467, 1620452965, 1638098541, 1655936265, 1673968228,
+    1692196547, 1710623359, 1729250827, 1748081133, 1767116489, 1786359126,
+    1805811301, 1825475297, 1845353420, 1865448001, 1885761398, 1906295993,
+    1927054196, 1948038440, 1969251188, 1990694927, 2012372174, 2034285470,
+    2056437387, 2078830522, 2101467502, 2124350982,
+};
+
+// For log of m in [1 + i / 64, 1 + (i + 1) / 64): logRecipTable[i] is
+// about 1 / m, and logTable[i] is -log of that exact value. So
+// log(m) = logTable[i] + log(m * logRecipTable[i]), where the last term is
+// within 1/128 of log(1)
+static const int32_t logRecipTable[64] = {
+    1065418244, 1049152317, 1033375590, 1018066322, 1003204040, 988769449,
+    974744351, 961111563, 947854852, 934958867, 922409084, 910191745,
+    898293814, 886702926, 875407347, 864395934, 853658096, 843183764,
+    832963354, 822987745, 813248245, 803736570, 794444818, 785365448,
+    776491263, 767815383, 759331235, 751032533, 742913262, 734967666,
+    727190230, 719575673, 712118930, 704815146, 697659662, 690648007,
+    683775888, 677039180, 670433919, 663956297, 657602648, 651369448,
+    645253303, 639250946, 633359233, 627575130, 621895717, 616318177,
+    610839793, 605457945, 600170102, 594973825, 589866753, 584846611,
+    579911196, 575058383, 570286114, 565592401, 560975320, 556433010,
+    551963669, 547565552, 543236970, 538976288,
+};
+
+static const int32_t logTable[64] = {
+    8356010, 24875440, 41144567, 57170862, 72961468, 88523216,
+    103862645, 118986020, 133899340, 148608363, 163118608, 177435378,
+    191563763, 205508658, 219274768, 232866618, 246288566, 259544805,
+    272639381, 285576186, 298358978, 310991380, 323476890, 335818887,
+    348020629, 360085271, 372015858, 383815338, 395486560, 407032282,
+    418455175, 429757825, 440942737, 452012338, 462968983, 473814952,
+    484552459, 495183653, 505710619, 516135378, 526459899, 536686088,
+    546815803, 556850847, 566792971, 576643883, 586405240, 596078655,
+    605665700, 615167901, 624586750, 633923693, 643180146, 652357482,
+    661457044, 670480137, 679428038, 688301988, 697103200, 705832856,
+    714492110, 723082091, 731603897, 740058601,
+};
+
+// atan(i / 64)
+static const int32_t atanTable[65] = {
+    0, 16775851, 33543516, 50294833, 67021687, 83716036,
+    100369930, 116975536, 133525159, 150011262, 166426484, 182763663,
+    199015846, 215176309, 231238569, 247196400, 263043837, 278775192,
+    294385059, 309868320, 325220151, 340436023, 355511705, 370443267,
+    385227074, 399859787, 414338361, 428660037, 442822340, 456823070,
+    470660297, 484332355, 497837829, 511175551, 524344587, 537344232,
+    550173994, 562833591, 575322936, 587642129, 599791448, 611771334,
+    623582386, 635225352, 646701114, 658010682, 669155185, 680135863,
+    690954054, 701611191, 712108791, 722448447, 732631822, 742660643,
+    752536690, 762261796, 771837835, 781266719, 790550395, 799690833,
+    808690030, 817549999, 826272767, 834860371, 843314857,
+};
+
+// Product of Q30 values, rounded. The full product has to fit in 63 bits
+static inline int64_t mul(int64_t a, int64_t b)
+{
+    return (a * b + (One >> 1)) >> FixedMath::FractionBits;
+}
+
+static inline uint64_t magnitude(int64_t x)
+{
+    return (x < 0) ? (0 - static_cast<uint64_t>(x)) : static_cast<uint64_t>(x);
+}
+
+// Bit at a time square root, rounded to nearest
+static uint64_t integerSqrt(uint64_t n)
+{
+    uint64_t root = 0;
+    uint64_t bit = static_cast<uint64_t>(1) << 62;
+    while (bit > n) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    
+    // n is now the remainder of the root rounded down
+    return (n > root) ? root + 1 : root;
+}
+
+int64_t FixedMath::sqrt(int64_t x)
+{
+    if (x <= 0) {
+        return 0;
+    }
+    
+    // The root in Q30 is the integer root of x * 2^30. When that doesn't fit
+    // in 64 bits drop an even number of bits from x and put half as many
+    // back on the root
+    uint64_t n = static_cast<uint64_t>(x);
+    int32_t highBit = 63 - __builtin_clzll(n);
+    int32_t drop = 0;
+    if (highBit + FractionBits > 63) {
+        drop = (highBit + FractionBits - 63 + 1) & ~1;
+    }
+    return static_cast<int64_t>(integerSqrt((n >> drop) << FractionBits) << (drop / 2));
+}
+
+// Reduce |x| to r in [0, pi / 2) and the quadrant, mod 4, it was in
+static int64_t reduceAngle(int64_t x, uint32_t& quadrant)
+{
+    uint64_t ax = magnitude(x);
+    uint64_t n = (ax < static_cast<uint64_t>(HalfPi)) ? 0 : ax / HalfPi;
+    
+    // The low part of pi / 2 makes the result a bit smaller, for a large
+    // n by more than pi / 2
+    int64_t r = static_cast<int64_t>(ax - n * HalfPi) - static_cast<int64_t>((n * HalfPiLow) >> 31);
+    while (r < 0) {
+        r += HalfPi;
+        --n;
+    }
+    quadrant = static_cast<uint32_t>(n & 3);
+    return r;
+}
+
+// sin and cos of r in [0, pi / 2]. With a the table angle just below r and
+// d = r - a, which is under pi / 128, sin(r) = sin(a)cos(d) + cos(a)sin(d)
+// and cos(r) = cos(a)cos(d) - sin(a)sin(d). The series for sin(d) and
+// cos(d) are good to 1e-11 with these terms
+static void sinCos(int64_t r, int64_t& s, int64_t& c)
+{
+    int64_t i = (r * SinIndexScale) >> (FixedMath::FractionBits + 24);
+    if (i > 63) {
+        i = 63;
+    }
+    int64_t d = r - ((i * SinStep + (1 << 9)) >> 10);
+    int64_t d2 = mul(d, d);
+    int64_t sinD = d - mul(d, d2) / 6;
+    int64_t cosD = One - d2 / 2 + mul(d2, d2) / 24;
+    int64_t sinA = sinTable[i];
+    int64_t cosA = sinTable[64 - i];
+    s = mul(sinA, cosD) + mul(cosA, sinD);
+    c = mul(cosA, cosD) - mul(sinA, sinD);
+}
+
+int64_t FixedMath::sin(int64_t x)
+{
+    uint32_t quadrant;
+    int64_t s, c;
+    sinCos(reduceAngle(x, quadrant), s, c);
+    int64_t result = (quadrant & 1) ? c : s;
+    if (quadrant & 2) {
+        result = -result;
+    }
+    return (x < 0) ? -result : result;
+}
+
+int64_t FixedMath::cos(int64_t x)
+{
+    uint32_t quadrant;
+    int64_t s, c;
+    sinCos(reduceAngle(x, quadrant), s, c);
+    int64_t result = (quadrant & 1) ? -s : c;
+    return (quadrant & 2) ? -result : result;
+}
+
+// atan of z in [0, 1]. With a the nearest table value,
+// atan(z) = atan(a) + atan((z - a) / (1 + za)), and that last argument is
+// under 1/128 so two terms of its series are enough
+static int64_t atan(int64_t z)
+{
+    int64_t i = (z + (1 << 23)) >> 24;
+    int64_t a = i << 24;
+    int64_t u = ((z - a) << FixedMath::FractionBits) / (One + mul(z, a));
+    return atanTable[i] + u - mul(mul(u, u), u) / 3;
+}
+
+int64_t FixedMath::atan2(int64_t y, int64_t x)
+{
+    uint64_t ax = magnitude(x);
+    uint64_t ay = magnitude(y);
+    if (!ax && !ay) {
+        return 0;
+    }
+    
+    // Work in the first octant, with the ratio of the smaller to the larger.
+    // Shift both so the division doesn't overflow
+    bool steep = ay > ax;
+    uint64_t num = steep ? ax : ay;
+    uint64_t den = steep ? ay : ax;
+    int32_t highBit = 63 - __builtin_clzll(den);
+    if (highBit > 31) {
+        num >>= highBit - 31;
+        den >>= highBit - 31;
+    }
+    int64_t angle = atan(static_cast<int64_t>((num << FractionBits) / den));
+    
+    if (steep) {
+        angle = HalfPi - angle;
+    }
+    if (x < 0) {
+        angle = Pi - angle;
+    }
+    return (y < 0) ? -angle : angle;
+}
+
+int64_t FixedMath::exp(int64_t x, int64_t max)
+{
+    // e^44 is over 2^63 and e^-22 rounds to 0 in Q30
+    if (x >= 44 * One) {
+        return max;
+    }
+    if (x <= -22 * One) {
+        return 0;
+    }
+    
+    // e^x = 2^k * e^r, with k the nearest integer to x / ln 2 and r what's
+    // left over. Then e^r = 2^y, where y = r / ln 2 made positive, is the
+    // table entry for the 64th below y times e^(t ln 2) for the fraction
+    // of a 64th left. t ln 2 is under 1/92 so four terms of its series
+    // are good to 1e-11
+    int64_t k = (x * Log2eQ24 + (static_cast<int64_t>(1) << 53)) >> (FractionBits + 24);
+    int64_t r = x - k * Ln2 - ((k * Ln2Low) >> 31);
+    int64_t y = mul(r, Log2e);
+    if (y < 0) {
+        y += One;
+        --k;
+    } else if (y >= One) {
+        y -= One;
+        ++k;
+    }
+    int64_t i = y >> 24;
+    int64_t t = mul(y - (i << 24), Ln2);
+    int64_t t2 = mul(t, t);
+    int64_t series = One + t + t2 / 2 + mul(t2, t) / 6 + mul(t2, t2) / 24;
+    int64_t m = mul(exp2Table[i], series);
+    
+    // m is in [1, 2)
+    if (k >= 0) {
+        return (k > 32 || m > (max >> k)) ? max : (m << k);
+    }
+    return (m + (static_cast<int64_t>(1) << (-k - 1))) >> -k;
+}
+
+int64_t FixedMath::log(int64_t x, int64_t lowest)
+{
+    if (x <= 0) {
+        return lowest;
+    }
+    
+    // x = 2^e * m with m in [1, 2), so log(x) = e ln 2 + log(m). Large x
+    // loses its low bits, which are below the precision of the result
+    int32_t e = 63 - __builtin_clzll(static_cast<uint64_t>(x)) - FractionBits;
+    int64_t m = (e >= 0) ? (x >> e) : (x << -e);
+    int64_t i = (m - One) >> 24;
+    
+    // t is under 1/128, so four terms of the series for log(1 + t) are good
+    // to 1e-11
+    int64_t t = mul(m, logRecipTable[i]) - One;
+    int64_t t2 = mul(t, t);
+    int64_t series = t - t2 / 2 + mul(t2, t) / 3 - mul(t2, t2) / 4;
+    return e * Ln2 + ((e * Ln2Low) >> 31) + logTable[i] + series;
+}
+
+// Double versions
+
+static constexpr double Infinity = std::numeric_limits<double>::infinity();
+static constexpr double DoubleOne = static_cast<double>(One);
+
+// 2 pi and ln 2 split in a part with its low bits clear, so multiplying it
+// by a small integer is exact, and the rest
+static constexpr double TwoPiHigh = 6.28318530321121216;
+static constexpr double TwoPiLow = 3.96837431872216200e-09;
+static constexpr double InverseTwoPi = 0.159154943091895336;
+static constexpr double DoubleLn2High = 0.693147180369123816;
+static constexpr double DoubleLn2Low = 1.90821492927058770e-10;
+static constexpr double Log2eDouble = 1.44269504088896341;
+
+union DoubleBits
+{
+    double number;
+    uint64_t bits;
+};
+
+// 2^e for e in the range of normal doubles, [-1022, 1023]
+static inline double powerOfTwo(int32_t e)
+{
+    DoubleBits value;
+    value.bits = static_cast<uint64_t>(e + 1023) << 52;
+    return value.number;
+}
+
+// Split finite x > 0 into m in [1, 2) and the power of two it's scaled by
+static int32_t splitExponent(double x, double& m)
+{
+    int32_t adjust = 0;
+    if (x < std::numeric_limits<double>::min()) {
+        // Denormal. Make it normal first
+        x *= powerOfTwo(54);
+        adjust = 54;
+    }
+    DoubleBits value;
+    value.number = x;
+    int32_t e = static_cast<int32_t>((value.bits >> 52) & 0x7ff) - 1023;
+    value.bits = (value.bits & 0xfffffffffffff) | (static_cast<uint64_t>(1023) << 52);
+    m = value.number;
+    return e - adjust;
+}
+
+static inline int64_t toQ30(double x)
+{
+    double scaled = x * DoubleOne;
+    return static_cast<int64_t>((scaled < 0) ? (scaled - 0.5) : (scaled + 0.5));
+}
+
+static inline double fromQ30(int64_t x)
+{
+    return static_cast<double>(x) / DoubleOne;
+}
+
+double FixedMath::sqrt(double x)
+{
+    if (x <= 0) {
+        return (x == 0) ? x : std::numeric_limits<double>::quiet_NaN();
+    }
+    if (!(x < Infinity)) {
+        return x;
+    }
+    
+    // sqrt(m * 2^e) is sqrt(m) * 2^(e / 2) with e made even and m in [1, 4).
+    // The kernel is good to 31 bits, so one Newton step gets all 53
+    double m;
+    int32_t e = splitExponent(x, m);
+    if (e & 1) {
+        m *= 2;
+        --e;
+    }
+    double root = fromQ30(sqrt(toQ30(m)));
+    root = (root + m / root) * 0.5;
+    return root * powerOfTwo(e / 2);
+}
+
+// Reduce x to [-pi, pi]. Past 2^62 the angle is meaningless anyway
+static double reduceAngle(double x)
+{
+    if (!(x > -4.6e18 && x < 4.6e18)) {
+        return (x == x) ? 0 : x;
+    }
+    double turns = x * InverseTwoPi;
+    double n = static_cast<double>(static_cast<int64_t>((turns < 0) ? (turns - 0.5) : (turns + 0.5)));
+    return (x - n * TwoPiHigh) - n * TwoPiLow;
+}
+
+double FixedMath::sin(double x)
+{
+    if (x != x) {
+        return x;
+    }
+    return fromQ30(sin(toQ30(reduceAngle(x))));
+}
+
+double FixedMath::cos(double x)
+{
+    if (x != x) {
+        return x;
+    }
+    return fromQ30(cos(toQ30(reduceAngle(x))));
+}
+
+double FixedMath::atan2(double y, double x)
+{
+    if (x != x || y != y) {
+        return x + y;
+    }
+    
+    // Scale both into [-1, 1]. An infinite one counts as 1 and a finite one
+    // next to it as 0
+    double ax = (x < 0) ? -x : x;
+    double ay = (y < 0) ? -y : y;
+    double larger = (ax > ay) ? ax : ay;
+    if (larger == 0) {
+        return 0;
+    }
+    if (!(larger < Infinity)) {
+        x = (ax < Infinity) ? 0 : ((x < 0) ? -1 : 1);
+        y = (ay < Infinity) ? 0 : ((y < 0) ? -1 : 1);
+        larger = 1;
+    }
+    return fromQ30(atan2(toQ30(y / larger), toQ30(x / larger)));
+}
+
+double FixedMath::exp(double x)
+{
+    if (x != x) {
+        return x;
+    }
+    if (x > 709.8) {
+        return Infinity;
+    }
+    if (x < -745.2) {
+        return 0;
+    }
+    
+    // e^x = 2^k * e^r with r in [-ln2 / 2, ln2 / 2], where the kernel is
+    // in [0.7, 1.42]. 2^k goes on in two steps so each is a normal double
+    double scaled = x * Log2eDouble;
+    int32_t k = static_cast<int32_t>((scaled < 0) ? (scaled - 0.5) : (scaled + 0.5));
+    double r = (x - k * DoubleLn2High) - k * DoubleLn2Low;
+    double result = fromQ30(exp(toQ30(r), std::numeric_limits<int64_t>::max()));
+    return result * powerOfTwo(k / 2) * powerOfTwo(k - k / 2);
+}
+
+double FixedMath::log(double x)
+{
+    if (x <= 0) {
+        return (x == 0) ? -Infinity : std::numeric_limits<double>::quiet_NaN();
+    }
+    if (!(x < Infinity)) {
+        return x;
+    }
+    
+    // log(m * 2^e) = log(m) + e ln 2
+    double m;
+    int32_t e = splitExponent(x, m);
+    return fromQ30(log(toQ30(m), 0)) + e * DoubleLn2High + e * DoubleLn2Low;
+}
@@ -0,0 +1,130 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "bare/Log.h"
+
+#include "bare/InterruptManager.h"
+#include "bare/Timer.h"
+
+using namespace bare;
+
+Log::Entry Log::_entries[Capacity];
+uint32_t Log::_head = 0;
+uint32_t Log::_tail = 0;
+uint32_t Log::_dropped = 0;
+bool Log::_backgroundDrain = false;
+
+static inline uint32_t next(uint32_t i) { return (i + 1) % Log::Capacity; }
+
+// Entries can be recorded from interrupt handlers, so the ring is only
+// touched under an IRQGuard
+void Log::record(Level level, const char* format, const uint64_t* args, uint32_t count)
+{
+    int64_t time = Timer::systemTime();
+    
+    IRQGuard guard;
+    
+    // When full, the oldest entry gives way
+    if (next(_head) == _tail) {
+        _tail = next(_tail);
+        ++_dropped;
+    }
+    
+    Entry& entry = _entries[_head];
+    entry.format = format;
+    entry.time = time;
+    entry.level = level;
+    entry.count = static_cast<uint8_t>(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        entry.args[i] = args[i];
+    }
+    _head = next(_head);
+}
+
+uint32_t Log::drain(Print::Sink& sink, uint32_t max)
+{
+    uint32_t drained = 0;
+    
+    while (drained < max) {
+        // Copy the entry out so it can be formatted with interrupts on
+        Entry entry;
+        {
+            IRQGuard guard;
+            if (_tail == _head) {
+                break;
+            }
+            entry = _entries[_tail];
+            _tail = next(_tail);
+        }
+        
+        uint32_t us = static_cast<uint32_t>(entry.time % 1000000);
+        uint32_t sec = static_cast<uint32_t>(entry.time / 1000000);
+        Print::format(sink, FMT("[%u.%06u] %s"), sec, us, prefix(entry.level));
+        Print::vformat(sink, entry.format, entry.args, entry.count);
+        ++drained;
+    }
+    return drained;
+}
+
+uint32_t Log::pending()
+{
+    IRQGuard guard;
+    return (_head + Capacity - _tail) % Capacity;
+}
+
+uint32_t Log::dropped()
+{
+    return _dropped;
+}
+
+void Log::clear()
+{
+    IRQGuard guard;
+    _tail = _head;
+    _dropped = 0;
+}
+
+bool Log::idle()
+{
+    if (!_backgroundDrain) {
+        return false;
+    }
+    
+    // A few at a time, so input isn't kept waiting
+    Serial::PrintSink sink;
+    return drain(sink, 4) != 0;
+}
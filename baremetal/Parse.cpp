@@ -0,0 +1,147 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare/Parse.h"
+
+using namespace bare;
+
+// A uint64_t holds any 19 decimal digits
+static constexpr int32_t MaxMantissaDigits = 19;
+
+// Powers of ten which are exact in a double. A mantissa up to 2^53 scaled
+// by one of these is correctly rounded
+static const double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+static constexpr int32_t MaxExactPower = 22;
+
+// Largest magnitude a Float holds. For fixed point that's just below the
+// sign bit, by the fixed point or the double precision, whichever is
+// coarser, so the conversion can't round up into it
+static double floatLimit()
+{
+    if (Float::IsFixedPoint) {
+        double top = static_cast<double>(static_cast<uint64_t>(1) << (Float::MaxIntegerBits - 1));
+        double fixedStep = 1.0 / static_cast<double>(static_cast<uint64_t>(1) << Float::BinaryExponent);
+        double doubleStep = top / 9007199254740992.0; // 2^53
+        return top - ((fixedStep > doubleStep) ? fixedStep : doubleStep);
+    }
+    return static_cast<double>(std::numeric_limits<Float::value_type>::max());
+}
+
+ParseResult bare::parse(const char* s, const char* end, Float& value)
+{
+    const char* start = s;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s++ == '-';
+    }
+    
+    // value is mantissa * 10^exponent. Leading zeros aren't significant
+    uint64_t mantissa = 0;
+    int32_t digits = 0;
+    int32_t exponent = 0;
+    bool haveDigits = false;
+    for ( ; s < end && isDigit(*s); ++s) {
+        haveDigits = true;
+        if (digits < MaxMantissaDigits) {
+            mantissa = mantissa * 10 + static_cast<uint8_t>(*s - '0');
+            digits += mantissa ? 1 : 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (s < end && *s == '.') {
+        ++s;
+        for ( ; s < end && isDigit(*s); ++s) {
+            haveDigits = true;
+            if (digits < MaxMantissaDigits) {
+                mantissa = mantissa * 10 + static_cast<uint8_t>(*s - '0');
+                digits += mantissa ? 1 : 0;
+                --exponent;
+            }
+        }
+    }
+    if (!haveDigits) {
+        value = Float();
+        return { start, ParseError::NoDigits };
+    }
+    
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negativeExponent = *e++ == '-';
+        }
+        if (e < end && isDigit(*e)) {
+            // Clamped well past where the result is 0 or infinite
+            int32_t n = 0;
+            for ( ; e < end && isDigit(*e); ++e) {
+                if (n < 100000) {
+                    n = n * 10 + (*e - '0');
+                }
+            }
+            exponent += negativeExponent ? -n : n;
+            s = e;
+        }
+    }
+    
+    // Dividing by an exact power of ten rounds better than multiplying by
+    // an inexact negative one
+    double d = static_cast<double>(mantissa);
+    if (mantissa == 0) {
+        exponent = 0;
+    }
+    for ( ; exponent > MaxExactPower && d <= std::numeric_limits<double>::max(); exponent -= MaxExactPower) {
+        d *= powersOfTen[MaxExactPower];
+    }
+    for ( ; exponent < -MaxExactPower && d != 0; exponent += MaxExactPower) {
+        d /= powersOfTen[MaxExactPower];
+    }
+    if (exponent > 0 && exponent <= MaxExactPower) {
+        d *= powersOfTen[exponent];
+    } else if (exponent < 0 && exponent >= -MaxExactPower) {
+        d /= powersOfTen[-exponent];
+    }
+    
+    double limit = floatLimit();
+    bool overflow = d > limit;
+    if (overflow) {
+        d = limit;
+    }
+    value = Float(negative ? -d : d);
+    return { s, overflow ? ParseError::Overflow : ParseError::None };
+}
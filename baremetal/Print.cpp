@@ -35,40 +35,61 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare.h"
 
+#include "bare/Parse.h"
 #include "bare/Print.h"
 
 #include <cassert>
+#include <type_traits>
 
 using namespace bare;
 
 bool Print::toNumber(const char*& s, uint32_t& n)
 {
-    n = 0;
-    bool haveNumber = false;
-    while (1) {
-        if (*s < '0' || *s > '9') {
-            return haveNumber;
-        }
-        n = n * 10 + *s++ - '0';
-        haveNumber = true;
-    }
+    ParseResult result = parse(s, n);
+    s = result.end;
+    return result.error != ParseError::NoDigits;
 }
 
-enum class Signed { Yes, No };
-enum class FloatType { Float, Exp, Shortest };
- 
-enum class Flag {
-    leftJustify = 0x01,
-    plus = 0x02,
-    space = 0x04,
-    alt = 0x08,
-    zeroPad = 0x10,
+using Flag = Format::Flag;
+using Length = Format::Length;
+
+// Arguments for formatArgs come from one of these. va_list can be either
+// an array or a struct. This makes it impossible to pass by reference in a
+// cross-platform way. Wrap it in a struct and pass that by reference so it
+// works in all platforms
+struct VaArgs
+{
+    template<typename T> T next() { return va_arg(value, T); }
+    
+    va_list value;
 };
 
-// va_list can be either an array or a struct. This makes it impossible to pass by reference
-// in a cross-platform way. Wrap it in a struct and pass that by reference so it works in
-// all platforms
-struct VA_LIST { va_list value; };
+// Arguments stored by Print::toArgSlot. Missing ones read as 0
+class SlotArgs
+{
+public:
+    SlotArgs(const uint64_t* slots, uint32_t count) : _slots(slots), _count(count) { }
+    
+    template<typename T> T next()
+    {
+        uint64_t slot = (_index < _count) ? _slots[_index++] : 0;
+        return fromSlot<T>(slot, std::integral_constant<bool, std::is_pointer<T>::value>(), std::integral_constant<bool, std::is_floating_point<T>::value>());
+    }
+    
+private:
+    template<typename T> static T fromSlot(uint64_t slot, std::false_type, std::false_type) { return static_cast<T>(slot); }
+    template<typename T> static T fromSlot(uint64_t slot, std::true_type, std::false_type) { return reinterpret_cast<T>(static_cast<uintptr_t>(slot)); }
+    template<typename T> static T fromSlot(uint64_t slot, std::false_type, std::true_type)
+    {
+        double d;
+        memcpy(&d, &slot, sizeof(d));
+        return static_cast<T>(d);
+    }
+    
+    const uint64_t* _slots;
+    uint32_t _count;
+    uint32_t _index = 0;
+};
 
 static inline bool isFlag(uint8_t flags, Flag flag) { return (flags & static_cast<uint8_t>(flag)) != 0; }
 static inline void setFlag(uint8_t& flags, Flag flag) { flags |= static_cast<uint8_t>(flag); }
@@ -88,28 +109,31 @@ static void handleFlags(const char*& format, uint8_t& flags)
     }
 }
 
-static int32_t handleWidth(const char*& format, VA_LIST& va)
+template<typename Args>
+static int32_t handleWidth(const char*& format, Args& args)
 {
     if (*format == '*') {
         ++format;
-        return va_arg(va.value, int);
+        return args.template next<int>();
     }
     
     uint32_t n;
     return Print::toNumber(format, n) ? static_cast<int32_t>(n) : -1;
 }
 
-enum class Length { None, H, HH, L, LL, J, Z, T };
-
 static Length handleLength(const char*& format)
 {
     Length length = Length::None;
     if (*format == 'h') {
-        ++format;
-        length = (*++format == 'h') ? Length::HH : Length::H;
+        if (*++format != 'h') {
+            return Length::H;
+        }
+        length = Length::HH;
     } else if (*format == 'l') {
-        ++format;
-        length = (*++format == 'l') ? Length::LL : Length::L;
+        if (*++format != 'l') {
+            return Length::L;
+        }
+        length = Length::LL;
     } else if (*format == 'j') {
         length = Length::J;
     } else if (*format == 'z') {
@@ -123,109 +147,209 @@ static Length handleLength(const char*& format)
     return length;
 }
 
-static uintmax_t getInteger(Length length, VA_LIST& va)
+// Signed values are sign extended, so outInteger can tell they are negative.
+// Unsigned values are zero extended from the size of the argument.
+template<typename Args>
+static uintmax_t getInteger(Length length, bool isSigned, Args& args)
 {
+    if (isSigned) {
+        switch(length) {
+        case Length::None: return static_cast<uintmax_t>(args.template next<int>());
+        case Length::H: return static_cast<uintmax_t>(static_cast<int16_t>(args.template next<int>()));
+        case Length::HH: return static_cast<uintmax_t>(static_cast<int8_t>(args.template next<int>()));
+        case Length::L: return static_cast<uintmax_t>(args.template next<long int>());
+        case Length::LL: return static_cast<uintmax_t>(args.template next<long long int>());
+        case Length::J: return static_cast<uintmax_t>(args.template next<intmax_t>());
+        case Length::Z: return static_cast<uintmax_t>(args.template next<size_t>());
+        case Length::T: return static_cast<uintmax_t>(args.template next<ptrdiff_t>());
+        }
+    }
+    
     switch(length) {
-    case Length::None: return static_cast<uintmax_t>(va_arg(va.value, int));
-    case Length::H: return static_cast<uintmax_t>(va_arg(va.value, int)) & 0xffff;
-    case Length::HH: return static_cast<uintmax_t>(va_arg(va.value, int)) & 0xff;
-    case Length::L: return static_cast<uintmax_t>(va_arg(va.value, long int));
-    case Length::LL: return static_cast<uintmax_t>(va_arg(va.value, long long int));
-    case Length::J: return static_cast<uintmax_t>(va_arg(va.value, intmax_t));
-    case Length::Z: return static_cast<uintmax_t>(va_arg(va.value, size_t));
-    case Length::T: return static_cast<uintmax_t>(va_arg(va.value, ptrdiff_t));
+    case Length::None: return static_cast<uintmax_t>(args.template next<unsigned int>());
+    case Length::H: return static_cast<uintmax_t>(args.template next<unsigned int>()) & 0xffff;
+    case Length::HH: return static_cast<uintmax_t>(args.template next<unsigned int>()) & 0xff;
+    case Length::L: return static_cast<uintmax_t>(args.template next<unsigned long int>());
+    case Length::LL: return static_cast<uintmax_t>(args.template next<unsigned long long int>());
+    case Length::J: return static_cast<uintmax_t>(args.template next<uintmax_t>());
+    case Length::Z: return static_cast<uintmax_t>(args.template next<size_t>());
+    case Length::T: return static_cast<uintmax_t>(args.template next<ptrdiff_t>());
     }
     return 0;
 }
 
-static char* intToString(uint64_t value, char* buf, size_t size, uint8_t base = 10, bare::Print::Capital cap = bare::Print::Capital::No)
+// The ARM1176 has no divide instruction, so every '/' or '%' by a variable
+// calls __aeabi_uidivmod, or __aeabi_uldivmod for 64 bits. Decimal
+// conversion instead divides by constants with a reciprocal multiply and
+// makes two digits at a time from a table. Hex and octal use shifts
+// and masks.
+
+static const char DigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char LowerDigits[] = "0123456789abcdef";
+static const char UpperDigits[] = "0123456789ABCDEF";
+
+// n / 100 for any 32 bit n
+static inline uint32_t div100(uint32_t n)
 {
-    if (value == 0) {
-        buf[0] = '0';
-        buf[1] = '\0';
-        return buf;
+    return static_cast<uint32_t>((static_cast<uint64_t>(n) * 0x51eb851f) >> 37);
+}
+
+// n / 100000000 for any 64 bit n. 10^8 is 2^8 * 390625, and the reciprocal
+// of 390625 is exact for the 56 bits left after the shift
+static inline uint64_t div1e8(uint64_t n)
+{
+    uint64_t hi, lo;
+    mult64to128(n >> 8, 0xabcc77118461cefd, hi, lo);
+    return hi >> 18;
+}
+
+static inline char* putPair(char* p, uint32_t n)
+{
+    p -= 2;
+    p[0] = DigitPairs[n * 2];
+    p[1] = DigitPairs[n * 2 + 1];
+    return p;
+}
+
+// Digits are written backward ending at p. Returns the first digit
+static char* decimalToString(uint64_t value, char* p)
+{
+    // Take 8 digits at a time off the bottom until the rest fits in 32 bits
+    while (value > 0xffffffff) {
+        uint64_t q = div1e8(value);
+        uint32_t r = static_cast<uint32_t>(value - q * 100000000);
+        for (int i = 0; i < 4; ++i) {
+            uint32_t q2 = div100(r);
+            p = putPair(p, r - q2 * 100);
+            r = q2;
+        }
+        value = q;
     }
     
-    char hexBase = (cap == bare::Print::Capital::Yes) ? 'A' : 'a';
+    uint32_t v = static_cast<uint32_t>(value);
+    while (v >= 100) {
+        uint32_t q = div100(v);
+        p = putPair(p, v - q * 100);
+        v = q;
+    }
+    if (v >= 10) {
+        return putPair(p, v);
+    }
+    *--p = static_cast<char>('0' + v);
+    return p;
+}
+
+template<typename T>
+static char* powerOf2ToString(T value, char* p, uint8_t bits, const char* digits)
+{
+    T mask = (1 << bits) - 1;
+    do {
+        *--p = digits[value & mask];
+        value >>= bits;
+    } while (value);
+    return p;
+}
+
+static char* intToString(uint64_t value, char* buf, size_t size, uint8_t base = 10, bare::Print::Capital cap = bare::Print::Capital::No)
+{
+    // Digits are at the end of buf, so callers can get the length
+    // without strlen
     char* p = buf + size;
     *--p = '\0';
     
-    while (value) {
+    const char* digits = (cap == bare::Print::Capital::Yes) ? UpperDigits : LowerDigits;
+    bool small = value <= 0xffffffff;
+    switch (base) {
+    case 10:
+        return decimalToString(value, p);
+    case 16:
+        return small ? powerOf2ToString(static_cast<uint32_t>(value), p, 4, digits) : powerOf2ToString(value, p, 4, digits);
+    case 8:
+        return small ? powerOf2ToString(static_cast<uint32_t>(value), p, 3, digits) : powerOf2ToString(value, p, 3, digits);
+    case 2:
+        return small ? powerOf2ToString(static_cast<uint32_t>(value), p, 1, digits) : powerOf2ToString(value, p, 1, digits);
+    default:
+        break;
+    }
+    
+    do {
         uint8_t digit = value % base;
-        *--p = (digit > 9) ? (digit - 10 + hexBase) : (digit + '0');
+        *--p = digits[digit];
         value /= base;
-    }
+    } while (value);
     return p;
 }
 
-static int32_t outInteger(bare::Print::Printer printer, uintmax_t value, Signed sign, int32_t width, int32_t precision, uint8_t flags, uint8_t base, bare::Print::Capital cap)
+void Print::outInteger(Output& out, uintmax_t value, Signed sign, int32_t width, int32_t precision, uint8_t flags, uint8_t base, Capital cap)
 {
-    uint32_t size = 0;
-    if (sign == Signed::Yes) {
-        if (value < 0) {
-            value = -value;
-            printer('-');
-            size = 1;
-            width--;
-        }
-    }
-    
-    if (isFlag(flags, Flag::alt) && base != 10) {
-        printer('0');
-        size++;
-        width--;
+    char prefix[2];
+    int32_t prefixSize = 0;
+    if (sign == Signed::Yes && static_cast<intmax_t>(value) < 0) {
+        value = -value;
+        prefix[prefixSize++] = '-';
+    } else if (isFlag(flags, Flag::alt) && base != 10) {
+        prefix[prefixSize++] = '0';
         if (base == 16) {
-            printer((cap == bare::Print::Capital::Yes) ? 'X' : 'x');
-            size++;
-            width--;
+            prefix[prefixSize++] = (cap == Capital::Yes) ? 'X' : 'x';
         }
     }
     
     char buf[bare::Print::MaxIntegerBufferSize];
     char* p = intToString(static_cast<uint64_t>(value), buf, bare::Print::MaxIntegerBufferSize, base, cap);
-    size += static_cast<uint32_t>(p - buf);
-
-    if (isFlag(flags, Flag::zeroPad)) {
-        int32_t pad = static_cast<int32_t>(width) - static_cast<int32_t>(bare::strlen(p));
-        while (pad > 0) {
-            printer('0');
-            size++;
-            pad--;
-        }
-    }
-    
-    for ( ; *p; ++p) {
-        printer(*p);
-    }
-
-    return size;
+    int32_t digits = static_cast<int32_t>(buf + bare::Print::MaxIntegerBufferSize - 1 - p);
+    outField(out, prefix, prefixSize, p, digits, width, flags);
 }
 
 #if !defined(FLOATNONE)
-static int32_t outFloat(bare::Print::Printer printer, Float value, int32_t width, int32_t precision, uint8_t flags, bare::Print::Capital cap, FloatType type)
+void Print::outFloat(Output& out, Float value, int32_t width, int32_t precision, uint8_t flags, char conversion)
 {
-    // FIXME: Handle flags.leftJustify
-    // FIXME: Handle flags.plus
-    // FIXME: Handle flags.space
-    // FIXME: Handle flags.alt
-    // FIXME: Handle flags.zeroPad
-    // FIXME: Handle width
-    // FIXME: Handle precision
-    return bare::Print::printString(printer, value, precision, cap);
+    char buf[MaxFloatBufferSize];
+    int32_t size = static_cast<int32_t>(floatToString(buf, value, precision, flags, conversion));
+    
+    // Zeros go after the sign
+    int32_t sign = (buf[0] == '-' || buf[0] == '+' || buf[0] == ' ') ? 1 : 0;
+    outField(out, buf, sign, buf + sign, size - sign, width, flags);
 }
 #endif
 
-static int32_t outString(bare::Print::Printer printer, const char* s, int32_t width, int32_t precision, uint8_t flags)
+void Print::outString(Output& out, const char* s, int32_t width, int32_t precision, uint8_t flags)
 {
-    // FIXME: Handle flags.leftJustify
-    // FIXME: Handle width
-    // FIXME: Handle precision
-    int32_t size = 0;
-    while (*s) {
-        printer(*s++);
-        ++size;
+    // Precision is the most chars to take. Strings aren't zero padded
+    int32_t size = static_cast<int32_t>(bare::strlen(s));
+    if (precision >= 0 && size > precision) {
+        size = precision;
+    }
+    outField(out, "", 0, s, size, width, flags & ~static_cast<uint8_t>(Flag::zeroPad));
+}
+
+void Print::outChar(Output& out, char c, int32_t width, uint8_t flags)
+{
+    outField(out, "", 0, &c, 1, width, flags & ~static_cast<uint8_t>(Flag::zeroPad));
+}
+
+void Print::outField(Output& out, const char* prefix, int32_t prefixSize, const char* s, int32_t size, int32_t width, uint8_t flags)
+{
+    int32_t pad = width - prefixSize - size;
+    bool left = isFlag(flags, Flag::leftJustify);
+    bool zeros = !left && isFlag(flags, Flag::zeroPad);
+    
+    if (!left && !zeros) {
+        out.fill(' ', pad);
+    }
+    out.write(prefix, prefixSize);
+    if (zeros) {
+        out.fill('0', pad);
+    }
+    out.write(s, size);
+    if (left) {
+        out.fill(' ', pad);
     }
-    return size;
 }
 
 // Unsupported features:
@@ -235,32 +359,57 @@ static int32_t outString(bare::Print::Printer printer, const char* s, int32_t wi
 //     'L' length - long double
 //     'l' length for 'c' and 's' specifiers - wide characters
  
-int32_t Print::vformat(Print::Printer printer, const char *format, va_list vaIn)
+int32_t Print::vformat(Printer printer, const char *format, va_list va)
+{
+    PrinterSink sink(printer);
+    return vformat(sink, format, va);
+}
+
+int32_t Print::vformat(Sink& sink, const char *format, va_list vaIn)
+{
+    VaArgs args;
+    va_copy(args.value, vaIn);
+    Output out(sink);
+    formatArgs(out, format, args);
+    va_end(args.value);
+    out.flush();
+    return out.count();
+}
+
+int32_t Print::vformat(Sink& sink, const char *format, const uint64_t* slots, uint32_t count)
+{
+    SlotArgs args(slots, count);
+    Output out(sink);
+    formatArgs(out, format, args);
+    out.flush();
+    return out.count();
+}
+
+template<typename Args>
+void Print::formatArgs(Output& out, const char* format, Args& args)
 {
     assert(format);
     
-    VA_LIST va;
-    va_copy(va.value, vaIn);
-    
-    uint8_t flags = 0;
-        
-    int32_t size = 0;
-    
     while (*format) {
         if (*format != '%') {
-            printer(*format++);
-            size++;
+            // Literal run up to the next format or the end
+            const char* run = format;
+            while (*format && *format != '%') {
+                ++format;
+            }
+            out.write(run, format - run);
             continue;
         }
         
         format++;
         
         // We have a format, do the optional part
+        uint8_t flags = 0;
         handleFlags(format, flags);
-        int32_t width = handleWidth(format, va);
+        int32_t width = handleWidth(format, args);
         int32_t precision = -1;
         if (*format == '.') {
-            precision = handleWidth(++format, va);
+            precision = handleWidth(++format, args);
         }
         Length length = handleLength(format);
         
@@ -269,17 +418,17 @@ int32_t Print::vformat(Print::Printer printer, const char *format, va_list vaIn)
         {
         case 'd':
         case 'i':
-            size += outInteger(printer, getInteger(length, va), Signed::Yes, width, precision, flags, 10, Print::Capital::No);
+            outInteger(out, getInteger(length, true, args), Signed::Yes, width, precision, flags, 10, Capital::No);
             break;
         case 'u':
-            size += outInteger(printer, getInteger(length, va), Signed::No, width, precision, flags, 10, Print::Capital::No);
+            outInteger(out, getInteger(length, false, args), Signed::No, width, precision, flags, 10, Capital::No);
             break;
         case 'o':
-            size += outInteger(printer, getInteger(length, va), Signed::No, width, precision, flags, 8, Print::Capital::No);
+            outInteger(out, getInteger(length, false, args), Signed::No, width, precision, flags, 8, Capital::No);
             break;
         case 'x':
         case 'X':
-            size += outInteger(printer, getInteger(length, va), Signed::No, width, precision, flags, 16, (*format == 'X') ? Print::Capital::Yes : Print::Capital::No);
+            outInteger(out, getInteger(length, false, args), Signed::No, width, precision, flags, 16, (*format == 'X') ? Capital::Yes : Capital::No);
             break;
 #if !defined(FLOATNONE)
         case 'f':
@@ -287,42 +436,28 @@ int32_t Print::vformat(Print::Printer printer, const char *format, va_list vaIn)
         case 'e':
         case 'E':
         case 'g':
-        case 'G': {
-            Print::Capital cap = Print::Capital::No;
-            FloatType type = FloatType::Shortest;
-            switch(*format)
-            {
-            case 'f': cap = Print::Capital::No; type = FloatType::Float; break;
-            case 'F': cap = Print::Capital::Yes; type = FloatType::Float; break;
-            case 'e': cap = Print::Capital::No; type = FloatType::Exp; break;
-            case 'E': cap = Print::Capital::Yes; type = FloatType::Exp; break;
-            case 'g': cap = Print::Capital::No; type = FloatType::Shortest; break;
-            case 'G': cap = Print::Capital::Yes; type = FloatType::Shortest; break;
-            }
-
-            size += outFloat(printer, Float::fromArg(va_arg(va.value, Float::arg_type)), width, precision, flags, cap, type);
+        case 'G':
+            outFloat(out, Float::fromArg(args.template next<Float::arg_type>()), width, precision, flags, *format);
             break;
-        }
 #endif
         case 'c':
-            printer(static_cast<char>(va_arg(va.value, int)));
-            size++;
+            outChar(out, static_cast<char>(args.template next<int>()), width, flags);
             break;
         case 's':
-            size += outString(printer, va_arg(va.value, const char*), width, precision, flags);
+            outString(out, args.template next<const char*>(), width, precision, flags);
             break;
         case 'p':
-            size += outInteger(printer, reinterpret_cast<int64_t>(va_arg(va.value, void*)), Signed::No, width, precision, flags, 16, Print::Capital::No);
+            outInteger(out, reinterpret_cast<uintptr_t>(args.template next<void*>()), Signed::No, width, precision, flags, 16, Capital::No);
             break;
+        case '\0':
+            continue;
         default:
-            printer(*format++);
-            size++;
+            // Includes '%%'
+            out.put(*format);
             break;
         }
         ++format;
     }
-    
-    return size;
 }
 
 uint32_t Print::printString(Printer printer, uint64_t v, uint8_t base, Capital cap)
@@ -337,3 +472,21 @@ uint32_t Print::printString(Printer printer, uint64_t v, uint8_t base, Capital c
     printer('\0');
     return size;
 }
+
+uint32_t Print::toString(char* buf, uint64_t v, uint8_t base, Capital cap)
+{
+    char digits[MaxIntegerBufferSize];
+    char* p = ::intToString(v, digits, MaxIntegerBufferSize, base, cap);
+    uint32_t size = static_cast<uint32_t>(digits + MaxIntegerBufferSize - 1 - p);
+    memcpy(buf, p, size + 1);
+    return size;
+}
+
+uint32_t Print::toString(char* buf, int64_t v)
+{
+    if (v < 0) {
+        *buf = '-';
+        return toString(buf + 1, -static_cast<uint64_t>(v)) + 1;
+    }
+    return toString(buf, static_cast<uint64_t>(v));
+}
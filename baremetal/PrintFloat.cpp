@@ -38,90 +38,260 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "bare/Print.h"
 
 #include <cassert>
+#include <type_traits>
 
 using namespace bare;
 
-static uint32_t mantissaToString(const char* mantissa, char* buf, int32_t digitsToLeft)
+// Decimal
+//
+// A float as a run of decimal digits with no leading or trailing zeros.
+// The decimal point is 'point' digits from the left, which can be before
+// the first digit or past the last. Zero has no digits. Fixed point values
+// give all their digits exactly, so rounding them is exact at any
+// precision. IEEE values give fpconv's shortest digits.
+class Decimal
 {
-    const char* p = buf;
-    char* trailingNonZeroDigit = nullptr;
+public:
+    static constexpr int32_t MaxDigits = 48;
     
-    while (*mantissa) {
-        if (digitsToLeft-- == 0) {
-            *buf++ = '.';
+    char digit(int32_t i) const { return (i >= 0 && i < _size) ? _digits[i] : '0'; }
+    int32_t size() const { return _size; }
+    int32_t point() const { return _point; }
+    bool negative() const { return _negative; }
+    
+    // Fixed point: the integer digits, then one fraction digit for each
+    // multiply by 10 until the fraction runs out
+    template<typename T>
+    void set(const T& v, std::true_type)
+    {
+        uint64_t intPart, frac;
+        _negative = v.decompose(intPart, frac);
+        if (intPart) {
+            _size = Print::toString(_digits, intPart);
+        }
+        _point = _size;
+        
+        // The fraction times 10 fits in 32 bits for all but Float64
+        using Frac = typename std::conditional<(T::BinaryExponent <= 28), uint32_t, uint64_t>::type;
+        Frac fracPart = static_cast<Frac>(frac);
+        while (fracPart && _size < MaxDigits) {
+            fracPart *= 10;
+            _digits[_size++] = static_cast<char>('0' + (fracPart >> T::BinaryExponent));
+            fracPart &= T::BinaryMask;
         }
+        normalize();
+    }
+    
+    template<typename T>
+    void set(const T& v, std::false_type)
+    {
+        if (v == T()) {
+            return;
+        }
+        _negative = v < T();
+        int16_t exponent;
+        char buf[25];
+        (_negative ? -v : v).toString(buf, exponent);
+        _size = static_cast<int32_t>(strlen(buf));
+        memcpy(_digits, buf, _size);
+        _point = _size + exponent;
+        normalize();
+    }
     
-        if (*mantissa == '0' && digitsToLeft <= 0) {
-            if (!trailingNonZeroDigit) {
-                trailingNonZeroDigit = buf;
+    // Keep the first n digits and round the rest off, half to even
+    void round(int32_t n)
+    {
+        if (n >= _size) {
+            return;
+        }
+        if (n < 0) {
+            _size = 0;
+            return;
+        }
+        
+        bool up = _digits[n] > '5';
+        if (_digits[n] == '5') {
+            up = (digit(n - 1) - '0') & 1;
+            for (int32_t i = n + 1; i < _size; ++i) {
+                if (_digits[i] != '0') {
+                    up = true;
+                    break;
+                }
             }
-        } else {
-            trailingNonZeroDigit = nullptr;
         }
-        *buf++ = *mantissa;
         
-        ++mantissa;
+        _size = n;
+        if (up) {
+            int32_t i = n - 1;
+            while (i >= 0 && _digits[i] == '9') {
+                --i;
+            }
+            if (i < 0) {
+                // All nines, or nothing kept
+                _digits[0] = '1';
+                _size = 1;
+                _point++;
+            } else {
+                _digits[i]++;
+                _size = i + 1;
+            }
+        }
+        normalize();
     }
     
-    if (trailingNonZeroDigit) {
-        buf = trailingNonZeroDigit;
+private:
+    void normalize()
+    {
+        int32_t leading = 0;
+        while (leading < _size && _digits[leading] == '0') {
+            ++leading;
+        }
+        if (leading) {
+            memmove(_digits, _digits + leading, _size - leading);
+            _size -= leading;
+            _point -= leading;
+        }
+        while (_size && _digits[_size - 1] == '0') {
+            --_size;
+        }
+        if (!_size) {
+            _point = 0;
+        }
     }
-    *buf = '\0';
     
-    return static_cast<uint32_t>(buf - p);
-}
+    char _digits[MaxDigits];
+    int32_t _size = 0;
+    int32_t _point = 0;
+    bool _negative = false;
+};
 
-static uint32_t mantissaToString(const char* mantissa, bare::Print::Printer printer, int32_t digitsToLeft)
+// Digits of 'f' form with the given number of fraction digits
+static char* fixedForm(char* p, const Decimal& d, int32_t precision, bool alt)
 {
-    char buf[bare::Print::MaxToStringBufferSize];
-    uint32_t size = mantissaToString(mantissa, buf, digitsToLeft);
-    for (char* p = buf; *p; ++p) {
-        printer(*p);
+    if (d.point() <= 0) {
+        *p++ = '0';
     }
-    return size;
+    for (int32_t i = 0; i < d.point(); ++i) {
+        *p++ = d.digit(i);
+    }
+    if (precision > 0 || alt) {
+        *p++ = '.';
+    }
+    for (int32_t i = 0; i < precision; ++i) {
+        *p++ = d.digit(d.point() + i);
+    }
+    return p;
 }
 
-uint32_t Print::printString(Printer printer, Float v, int32_t precision, Capital cap)
+// Digits of 'e' form with the given number of fraction digits
+static char* exponentForm(char* p, const Decimal& d, int32_t precision, bool alt, bool capital)
 {
-    if (v == Float()) {
-        printer('0');
-        printer('\0');
-        return 1;
+    *p++ = d.digit(0);
+    if (precision > 0 || alt) {
+        *p++ = '.';
+    }
+    for (int32_t i = 1; i <= precision; ++i) {
+        *p++ = d.digit(i);
     }
     
-    uint32_t size = 0;
-    int16_t exponent;    
-    char buf[20];
-    v.toString(buf, exponent);
+    int32_t exponent = d.size() ? (d.point() - 1) : 0;
+    *p++ = capital ? 'E' : 'e';
+    *p++ = (exponent < 0) ? '-' : '+';
+    if (exponent < 0) {
+        exponent = -exponent;
+    }
+    if (exponent < 10) {
+        *p++ = '0';
+    }
+    return p + Print::toString(p, static_cast<uint32_t>(exponent));
+}
+
+static constexpr int32_t DefaultPrecision = 6;
+
+// Longest 'f' form allowed. Anything bigger is printed in 'e' form
+static constexpr int32_t MaxFixedDigits = 24;
 
-    // FIXME: Round using precision
+uint32_t Print::floatToString(char* buf, Float v, int32_t precision, uint8_t flags, char conversion)
+{
+    Decimal d;
+    d.set(v, std::integral_constant<bool, Float::IsFixedPoint>());
+    
+    bool alt = flags & static_cast<uint8_t>(Format::Flag::alt);
+    bool capital = conversion == 'F' || conversion == 'E' || conversion == 'G';
     
-    if (v < Float()) {
-        printer('-');
-        size++;
+    char* p = buf;
+    if (d.negative()) {
+        *p++ = '-';
+    } else if (flags & static_cast<uint8_t>(Format::Flag::plus)) {
+        *p++ = '+';
+    } else if (flags & static_cast<uint8_t>(Format::Flag::space)) {
+        *p++ = ' ';
     }
-        
-    int32_t numDigits = static_cast<int32_t>(strlen(buf));
-
-    // Compute n as exponent if form is 1.xxxe<n>
-    int16_t n = numDigits - 1 + exponent;
     
-    if (n >= -4 && n <= 6) {
-        // no exponent
-        return mantissaToString(buf, printer, n + 1) + size;
+    if (precision > MaxFloatPrecision) {
+        precision = MaxFloatPrecision;
     }
     
-    size += mantissaToString(buf, printer, 1);
-    printer((cap == bare::Print::Capital::Yes) ? 'E' : 'e');
-    size++;
-
-    if (n < 0) {
-        printer('-');
-        size++;
-        n = -n;
+    switch (conversion) {
+    case 'f':
+    case 'F':
+        if (precision < 0) {
+            precision = DefaultPrecision;
+        }
+        d.round(d.point() + precision);
+        if (d.point() <= MaxFixedDigits) {
+            p = fixedForm(p, d, precision, alt);
+            break;
+        }
+        // Fall through to exponent form for huge values
+    case 'e':
+    case 'E':
+        if (precision < 0) {
+            precision = DefaultPrecision;
+        }
+        d.round(precision + 1);
+        p = exponentForm(p, d, precision, alt, capital);
+        break;
+    default: {
+        // 'g' and 'G'. With no precision, print the shortest digits: for
+        // fixed point, those to DecimalExponent places, for IEEE, what
+        // fpconv gives.
+        bool shortest = precision < 0;
+        if (shortest) {
+            if (Float::IsFixedPoint) {
+                d.round(d.point() + Float::DecimalExponent);
+            }
+        } else {
+            if (precision == 0) {
+                precision = 1;
+            }
+            d.round(precision);
+        }
+        
+        int32_t exponent = d.size() ? (d.point() - 1) : 0;
+        int32_t limit = shortest ? 7 : precision;
+        if (exponent >= -4 && exponent < limit) {
+            int32_t fraction = alt ? (precision - 1 - exponent) : (d.size() - d.point());
+            p = fixedForm(p, d, (fraction < 0) ? 0 : fraction, alt);
+        } else {
+            int32_t fraction = alt ? (precision - 1) : (d.size() - 1);
+            p = exponentForm(p, d, (fraction < 0) ? 0 : fraction, alt, capital);
+        }
+        break;
+    }
     }
     
-    size += printString(printer, static_cast<uint64_t>(n));
+    *p = '\0';
+    return static_cast<uint32_t>(p - buf);
+}
+
+uint32_t Print::printString(Printer printer, Float v, int32_t precision, Capital cap)
+{
+    char buf[MaxFloatBufferSize];
+    uint32_t size = floatToString(buf, v, precision, 0, (cap == Capital::Yes) ? 'G' : 'g');
+    for (const char* p = buf; *p; ++p) {
+        printer(*p);
+    }
     printer('\0');
     return size;
 }
@@ -67,14 +67,14 @@ extern "C" {
 
     void* malloc(size_t size)
     {
-        bare::Serial::printf("Attempted to malloc %d bytes\n", size);
+        bare::Serial::printf(FMT("Attempted to malloc %d bytes\n"), size);
         abort();
         return nullptr;
     }
 
     void free(void*)
     {
-        bare::Serial::printf("Attempted to free\n");
+        bare::Serial::printf(FMT("Attempted to free\n"));
         abort();
     }
 
@@ -106,6 +106,14 @@ extern "C" {
         );
     }
 
+    void SEV()
+    {
+        __asm volatile (
+            "sev\n"
+            "bx lr"
+        );
+    }
+
     uint8_t* kernelBase() { return reinterpret_cast<uint8_t*>(0x8000); }
 
     int __aeabi_idiv(int value, int divisor)
@@ -115,7 +123,7 @@ extern "C" {
 
     void __aeabi_idiv0()
     {
-        Serial::printf("Divide by zero\n");
+        Serial::printf(FMT("Divide by zero\n"));
         abort();
     }
 
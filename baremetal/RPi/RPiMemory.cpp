@@ -75,6 +75,8 @@ static constexpr uint32_t FirstLevelTTB = 0x4000;
 static constexpr uint32_t SecondLevelTTB = 0xc00;
 
 extern uint8_t _end;
+extern uint8_t __bootheap_start;
+extern uint8_t __bootheap_end;
 
 static void* KernelHeapStart = &_end;
 
@@ -236,6 +238,34 @@ static void setMMUSectionDescriptors(uint32_t ttb, uint32_t vaddr, uint32_t padd
 }
 
 Memory::Heap* Memory::_kernelHeap = nullptr;
+Memory::ExpandFunction Memory::_expandFunction = nullptr;
+
+// The region is the .bootheap section in kernel/loadmap.ld
+static uint8_t* BootstrapHeapCur = nullptr;
+
+bool Memory::mapBootstrapSegment(size_t size, void*& addr)
+{
+    if (!BootstrapHeapCur) {
+        BootstrapHeapCur = &__bootheap_start;
+    }
+    size = (size + DefaultPageSize - 1) / DefaultPageSize * DefaultPageSize;
+    if (size > static_cast<size_t>(&__bootheap_end - BootstrapHeapCur)) {
+        return false;
+    }
+    addr = BootstrapHeapCur;
+    BootstrapHeapCur += size;
+    return true;
+}
+
+size_t Memory::bootstrapHeapSize()
+{
+    return &__bootheap_end - &__bootheap_start;
+}
+
+size_t Memory::bootstrapHeapUsed()
+{
+    return BootstrapHeapCur ? BootstrapHeapCur - &__bootheap_start : 0;
+}
 
 void Memory::init(Heap* kernelHeap)
 {
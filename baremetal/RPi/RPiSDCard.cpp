@@ -47,6 +47,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "bare/GPIO.h"
 #include "bare/Serial.h"
 #include "bare/Timer.h"
+#include "bare/Trace.h"
 
 //#define ENABLE_DEBUG_LOG
 #include "bare/Log.h"
@@ -556,6 +557,7 @@ SDCard::SDCard()
 
 Volume::Error SDCard::read(char* buf, Block blockAddr, uint32_t blocks)
 {
+    TRACE_SCOPE("sd.read");
     if (blocks < 1) {
         blocks = 1;
     }
@@ -624,6 +626,7 @@ Volume::Error SDCard::read(char* buf, Block blockAddr, uint32_t blocks)
 
 Volume::Error SDCard::write(const char* buf, Block blockAddr, uint32_t blocks)
 {
+    TRACE_SCOPE("sd.write");
     if (blocks < 1) {
         blocks = 1;
     }
@@ -89,28 +89,32 @@ void  Timer::init()
 
 void Timer::updateTimers()
 {
-    // FIXME: For now we only support a single timer at the head of the list
-    if (!_head) {
-        return;
-    }
-    
-    disableIRQ();
     InterruptManager::enableBasicIRQ(0, false);
 
-    // Reset Free running prescaler
+    // Stop the timer with the free running prescaler reset
     armTimer().control = 0x003E0000;
+    armTimer().clearIRQ = 0;
     
-    armTimer().load = _head->_timeout - 1;
-    armTimer().reload = _head->_timeout - 1;
+    // With hooks set, fireDue() is called instead
+    if (_heap.empty() || _hooks) {
+        return;
+    }
     
-    InterruptManager::enableBasicIRQ(0, true);
-    armTimer().clearIRQ = 0;
+    // One-shot to the nearest deadline. One past the range of the counter
+    // fires early, finds nothing due and comes back here
+    int64_t delay = _heap[0]->_deadline - systemTime();
+    if (delay < 1) {
+        delay = 1;
+    } else if (delay > 0xffffffff) {
+        delay = 0xffffffff;
+    }
+    armTimer().load = static_cast<uint32_t>(delay - 1);
+    armTimer().reload = static_cast<uint32_t>(delay - 1);
     
-    enableIRQ();
+    InterruptManager::enableBasicIRQ(0, true);
 
     // 32 bit counter, timer enabled, timer interrupt enabled
     armTimer().control = 0x003E00A2;
-    armTimer().clearIRQ = 0;
 }
 
 void Timer::handleInterrupt()
@@ -119,11 +123,14 @@ void Timer::handleInterrupt()
         return;
     }
     
-    for (Timer* timer = _head; timer; timer = timer->_next) {
-        timer->handleTimerEvent();
-	}
-    
+    // Other interrupts come through here too
+    if (!(armTimer().maskedIRQ & 1)) {
+        return;
+    }
 	armTimer().clearIRQ = 0;
+    
+    fireTimers(systemTime());
+    updateTimers();
 }
 
 int64_t Timer::systemTime()
@@ -54,7 +54,19 @@ int32_t Serial::printf(const char* format, ...)
 
 int32_t Serial::vprintf(const char* format, va_list va)
 {
-    return Print::vformat([](char c) { Serial::write(c); }, format, va);
+    PrintSink sink;
+    return Print::vformat(sink, format, va);
+}
+
+Serial::Error Serial::write(const char* s, uint32_t size)
+{
+    while (size--) {
+        Error error = write(static_cast<uint8_t>(*s++));
+        if (error != Error::OK) {
+            return error;
+        }
+    }
+    return Error::OK;
 }
 
 Serial::Error Serial::puts(const char* s, uint32_t size)
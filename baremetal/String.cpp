@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare/String.h"
 
+#include "bare/Parse.h"
 #include "bare/Print.h"
 
 using namespace bare;
@@ -42,19 +43,22 @@ using namespace bare;
 String::operator uint32_t()
 {
     uint32_t n;
-    const char* p = c_str();
-    return Print::toNumber(p, n) ? n : 0;
+    parse(c_str(), n);
+    return n;
 }
 
 String& String::printf(const char* format, ...)
 {
     va_list va;
     va_start(va, format);
-    return String::vprintf(format, va);
+    String::vprintf(format, va);
+    va_end(va);
+    return *this;
 }
 
 String& String::vprintf(const char* format, va_list va)
 {
-    bare::Print::vformat([this](char c) { *this += c; }, format, va);
+    PrintSink sink(*this);
+    bare::Print::vformat(sink, format, va);
     return *this;
 }
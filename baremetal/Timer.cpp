@@ -42,32 +42,192 @@ POSSIBILITY OF SUCH DAMAGE.
 
 using namespace bare;
 
-Timer* Timer::_head = nullptr;
 int64_t Timer::_epochOffset = 0;
+FixedVector<Timer*, Timer::MaxTimers> Timer::_heap;
+const Timer::Hooks* Timer::_hooks = nullptr;
 
-void Timer::start(Timer* timer, uint32_t us, bool repeat)
+int64_t Timer::now()
 {
-    if (!interruptsSupported()) {
-        return;
+    return _hooks ? _hooks->clock() : systemTime();
+}
+
+bool Timer::interrupts()
+{
+    return _hooks ? _hooks->interrupts : interruptsSupported();
+}
+
+void Timer::idle()
+{
+    if (_hooks) {
+        _hooks->idle();
+    } else {
+        WFE();
+    }
+}
+
+void Timer::setHooks(const Hooks* hooks)
+{
+    IRQGuard guard;
+    _hooks = hooks;
+    updateTimers();
+}
+
+bool Timer::start(Timer* timer, uint32_t us, bool repeat)
+{
+    if (!interrupts()) {
+        return false;
     }
     
-    timer->_next = _head;
-    timer->_timeout = us;
-    timer->_repeat = repeat;
-    _head = timer;
+    IRQGuard guard;
     
+    if (timer->running()) {
+        remove(timer->_index);
+    } else if (_heap.full()) {
+        return false;
+    }
+    
+    // A period of 0 would fire forever
+    timer->_deadline = now() + us;
+    timer->_period = repeat ? ((us > 0) ? us : 1) : 0;
+    insert(timer);
+    
+    updateTimers();
+    return true;
+}
+
+void Timer::stop(Timer* timer)
+{
+    IRQGuard guard;
+    
+    if (!timer->running()) {
+        return;
+    }
+    
+    remove(timer->_index);
+    updateTimers();
+}
+
+void Timer::fireDue()
+{
+    IRQGuard guard;
+    fireTimers(now());
     updateTimers();
 }
 
-void Timer::stop(Timer*)
+void Timer::fireTimers(int64_t now)
+{
+    // Handlers can start and stop timers, so look at the top again each time
+    while (!_heap.empty() && _heap[0]->_deadline <= now) {
+        Timer* timer = _heap[0];
+        if (timer->_period) {
+            timer->_deadline += timer->_period;
+            if (timer->_deadline <= now) {
+                timer->_deadline += ((now - timer->_deadline) / timer->_period + 1) * timer->_period;
+            }
+            siftDown(0);
+        } else {
+            remove(0);
+        }
+        timer->handleTimerEvent();
+    }
+}
+
+void Timer::place(Timer* timer, uint32_t index)
+{
+    _heap[index] = timer;
+    timer->_index = index;
+}
+
+void Timer::insert(Timer* timer)
 {
-    // FIXME: Implement
+    _heap.push_back(timer);
+    siftUp(static_cast<uint32_t>(_heap.size() - 1));
 }
 
+void Timer::remove(uint32_t index)
+{
+    Timer* timer = _heap[index];
+    Timer* last = _heap.back();
+    _heap.pop_back();
+    timer->_index = NotRunning;
+    if (timer == last) {
+        return;
+    }
+    
+    // Move the last one into the hole. It can belong above or below it
+    place(last, index);
+    siftUp(index);
+    siftDown(last->_index);
+}
+
+void Timer::siftUp(uint32_t index)
+{
+    Timer* timer = _heap[index];
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (_heap[parent]->_deadline <= timer->_deadline) {
+            break;
+        }
+        place(_heap[parent], index);
+        index = parent;
+    }
+    place(timer, index);
+}
+
+void Timer::siftDown(uint32_t index)
+{
+    Timer* timer = _heap[index];
+    uint32_t size = static_cast<uint32_t>(_heap.size());
+    while (true) {
+        uint32_t child = index * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && _heap[child + 1]->_deadline < _heap[child]->_deadline) {
+            ++child;
+        }
+        if (timer->_deadline <= _heap[child]->_deadline) {
+            break;
+        }
+        place(_heap[child], index);
+        index = child;
+    }
+    place(timer, index);
+}
+
+// Wakes usleep when the deadline passes. The SEV makes sure the WFE
+// returns if the interrupt comes between checking done and the WFE
+class SleepTimer : public Timer
+{
+public:
+    virtual void handleTimerEvent() override
+    {
+        done = true;
+        SEV();
+    }
+    
+    volatile bool done = false;
+};
+
 void Timer::usleep(uint32_t us)
 {
-    int64_t t0 = Timer::systemTime();
-    while(Timer::systemTime() < t0 + us) ;
+    int64_t deadline = now() + us;
+    
+    // Wait for the interrupt unless the sleep is too short to be worth it,
+    // or IRQs are masked, as they are in a handler, so it would never come.
+    // Other interrupts wake it early, so it goes back to sleep until its
+    // own one comes, then spins off any difference between the ARM timer
+    // and the system timer
+    if (us >= MinIdleSleep && !irqsMasked()) {
+        SleepTimer timer;
+        if (start(&timer, us, false)) {
+            while (!timer.done) {
+                idle();
+            }
+        }
+    }
+    
+    while (now() < deadline) { }
 }
 
 void Timer::setCurrentTime(const RealTime& t)
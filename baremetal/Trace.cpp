@@ -0,0 +1,60 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "bare/Trace.h"
+
+using namespace bare;
+
+bool Trace::_recording = true;
+uint32_t Trace::_count = 0;
+int64_t Trace::_base = 0;
+Trace::Event Trace::_events[Capacity];
+
+void Trace::dump(Print::Sink& sink)
+{
+    uint32_t n = count();
+    uint32_t first = _count - n;
+    
+    // Complete ("X") events. Timestamps and durations are in microseconds
+    Print::format(sink, FMT("{\"traceEvents\":[\n"));
+    for (uint32_t i = 0; i < n; ++i) {
+        const Event& event = _events[(first + i) % Capacity];
+        Print::format(sink, FMT("{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%u,\"pid\":1,\"tid\":1}%s\n"),
+            event.name, static_cast<long long>(_base + event.begin), event.duration, (i + 1 < n) ? "," : "");
+    }
+    Print::format(sink, FMT("],\"displayTimeUnit\":\"ms\"}\n"));
+}
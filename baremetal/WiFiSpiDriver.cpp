@@ -28,7 +28,7 @@ static constexpr uint8_t REPLY_FLAG = 1 << 7;
 // Read and check one byte from the input
 void WiFiSpiDriver::showCheckError(const char* err, uint8_t expected, uint8_t got)
 {
-    Serial::printf("%s exp:%#02x, got:%#02x\n", err, expected, got);
+    Serial::printf(FMT("%s exp:%#02x, got:%#02x\n"), err, expected, got);
 }
 
 static inline uint8_t setReply(WiFiSpiDriver::Command cmd) { return static_cast<uint8_t>(cmd) | REPLY_FLAG; }
@@ -37,6 +37,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare/XYModem.h"
 
+#include "bare/Trace.h"
+
 using namespace bare;
 
 static constexpr uint32_t SOH = 0x01;
@@ -116,16 +118,17 @@ uint32_t _bufferIndex;
 
 void showXModemData()
 {
-    bare::Serial::printf("\n\nxmodem buffer:\n");
+    bare::Serial::printf(FMT("\n\nxmodem buffer:\n"));
     for (uint32_t i = 0; i < _bufferIndex; ++i) {
-        bare::Serial::printf("    0x%02x\n", _buffer[i]);
+        bare::Serial::printf(FMT("    0x%02x\n"), _buffer[i]);
     }
-    bare::Serial::printf("\n\n");
+    bare::Serial::printf(FMT("\n\n"));
 }
 #endif
 
 bool XYModem::receive(ReceiveFunction func)
 {
+    TRACE_SCOPE("xymodem.receive");
 #ifdef CAPTURE_DATA
     _bufferIndex = 0;
 #endif
@@ -42,6 +42,86 @@ using namespace bare;
 
 bool bare::SystemIsInited = false;
 
+// Memory and string functions work a word at a time once the destination
+// is aligned, and copy or fill in blocks of 8 words. On RPi the blocks are
+// done with ldm/stm, which move 8 registers in one instruction. Sizes
+// below MinWordSize aren't worth the setup and just use bytes.
+
+typedef uint32_t __attribute__((__may_alias__)) Word;
+
+static constexpr uintptr_t WordMask = sizeof(Word) - 1;
+static constexpr size_t BlockSize = 8 * sizeof(Word);
+static constexpr size_t MinWordSize = 16;
+
+static inline bool hasZeroByte(Word w)
+{
+    return ((w - 0x01010101) & ~w & 0x80808080) != 0;
+}
+
+#if defined(PLATFORM_RPI)
+static inline void copyBlocks(Word*& dst, const Word*& src, size_t blocks)
+{
+    if (blocks == 0) {
+        return;
+    }
+    __asm volatile (
+        "1:\n"
+        "ldmia %[src]!, {r3-r10}\n"
+        "stmia %[dst]!, {r3-r10}\n"
+        "subs %[blocks], %[blocks], #1\n"
+        "bne 1b\n"
+        : [dst] "+r" (dst), [src] "+r" (src), [blocks] "+r" (blocks)
+        :
+        : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory"
+    );
+}
+
+static inline void fillBlocks(Word*& dst, Word value, size_t blocks)
+{
+    if (blocks == 0) {
+        return;
+    }
+    __asm volatile (
+        "mov r3, %[value]\n"
+        "mov r4, %[value]\n"
+        "mov r5, %[value]\n"
+        "mov r6, %[value]\n"
+        "mov r7, %[value]\n"
+        "mov r8, %[value]\n"
+        "mov r9, %[value]\n"
+        "mov r10, %[value]\n"
+        "1:\n"
+        "stmia %[dst]!, {r3-r10}\n"
+        "subs %[blocks], %[blocks], #1\n"
+        "bne 1b\n"
+        : [dst] "+r" (dst), [blocks] "+r" (blocks)
+        : [value] "r" (value)
+        : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory"
+    );
+}
+#else
+static inline void copyBlocks(Word*& dst, const Word*& src, size_t blocks)
+{
+    while (blocks--) {
+        Word w0 = src[0], w1 = src[1], w2 = src[2], w3 = src[3];
+        Word w4 = src[4], w5 = src[5], w6 = src[6], w7 = src[7];
+        dst[0] = w0; dst[1] = w1; dst[2] = w2; dst[3] = w3;
+        dst[4] = w4; dst[5] = w5; dst[6] = w6; dst[7] = w7;
+        src += 8;
+        dst += 8;
+    }
+}
+
+static inline void fillBlocks(Word*& dst, Word value, size_t blocks)
+{
+    while (blocks--) {
+        dst[0] = value; dst[1] = value; dst[2] = value; dst[3] = value;
+        dst[4] = value; dst[5] = value; dst[6] = value; dst[7] = value;
+        dst += 8;
+    }
+}
+#endif
+
 extern "C" {
 
     void abort()
@@ -64,23 +144,72 @@ extern "C" {
 
     void* memset(void* dst, int value, size_t n)
     {
-        if (n == 0) {
-            return dst;
-        }
         uint8_t* p = reinterpret_cast<uint8_t*>(dst);
+        uint8_t byte = static_cast<uint8_t>(value);
+        
+        if (n >= MinWordSize) {
+            while (reinterpret_cast<uintptr_t>(p) & WordMask) {
+                *p++ = byte;
+                n--;
+            }
+            
+            Word* d = reinterpret_cast<Word*>(p);
+            Word word = static_cast<Word>(byte) * 0x01010101;
+            fillBlocks(d, word, n / BlockSize);
+            n %= BlockSize;
+            for ( ; n >= sizeof(Word); n -= sizeof(Word)) {
+                *d++ = word;
+            }
+            p = reinterpret_cast<uint8_t*>(d);
+        }
+        
         while (n--) {
-            *p++ = static_cast<uint8_t>(value);
+            *p++ = byte;
         }
         return dst;
     }
 
+    // memmove relies on this copying forward, so it is safe for
+    // overlapping areas where dst < src
     void* memcpy(void* dst, const void* src, size_t n)
     {
-        if (n == 0) {
-            return dst;
-        }
         uint8_t* d = reinterpret_cast<uint8_t*>(dst);
         const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+        
+        if (n >= MinWordSize) {
+            while (reinterpret_cast<uintptr_t>(d) & WordMask) {
+                *d++ = *s++;
+                n--;
+            }
+            
+            Word* dw = reinterpret_cast<Word*>(d);
+            uint32_t offset = reinterpret_cast<uintptr_t>(s) & WordMask;
+            if (offset == 0) {
+                const Word* sw = reinterpret_cast<const Word*>(s);
+                copyBlocks(dw, sw, n / BlockSize);
+                n %= BlockSize;
+                for ( ; n >= sizeof(Word); n -= sizeof(Word)) {
+                    *dw++ = *sw++;
+                }
+                s = reinterpret_cast<const uint8_t*>(sw);
+            } else {
+                // Source is misaligned. Read aligned words and shift them
+                // together. This reads up to 3 bytes past the last one
+                // copied, but never past the word containing it.
+                const Word* sw = reinterpret_cast<const Word*>(s - offset);
+                uint32_t rshift = offset * 8;
+                uint32_t lshift = 32 - rshift;
+                Word w0 = *sw++;
+                for ( ; n >= sizeof(Word); n -= sizeof(Word)) {
+                    Word w1 = *sw++;
+                    *dw++ = (w0 >> rshift) | (w1 << lshift);
+                    w0 = w1;
+                }
+                s = reinterpret_cast<const uint8_t*>(sw) - sizeof(Word) + offset;
+            }
+            d = reinterpret_cast<uint8_t*>(dw);
+        }
+        
         while (n--) {
             *d++ = *s++;
         }
@@ -97,33 +226,68 @@ extern "C" {
             return dst;
         }
 
-        const char* s = reinterpret_cast<const char*>(src);
-        char* d = reinterpret_cast<char*>(dst);
+        const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+        uint8_t* d = reinterpret_cast<uint8_t*>(dst);
 
-        // If the areas don't overlap, just do memcpy
-        if (s < d && d < s + n) {
-            // If the areas overlap, have to copy byte by byte
-            s += n;
-            d += n;
-            while (n-- > 0) {
+        // If the areas don't overlap, or dst is below src, just do memcpy
+        if (!(s < d && d < s + n)) {
+            return bare::memcpy(dst, src, n);
+        }
+        
+        // Overlapping with dst above src, so copy backward
+        s += n;
+        d += n;
+        if (n >= MinWordSize && ((reinterpret_cast<uintptr_t>(s) ^ reinterpret_cast<uintptr_t>(d)) & WordMask) == 0) {
+            while (reinterpret_cast<uintptr_t>(d) & WordMask) {
                 *--d = *--s;
+                n--;
             }
-            return dst;
+            
+            Word* dw = reinterpret_cast<Word*>(d);
+            const Word* sw = reinterpret_cast<const Word*>(s);
+            for ( ; n >= sizeof(Word); n -= sizeof(Word)) {
+                *--dw = *--sw;
+            }
+            d = reinterpret_cast<uint8_t*>(dw);
+            s = reinterpret_cast<const uint8_t*>(sw);
         }
         
-        // just do memcpy
-        return bare::memcpy(dst, src, n);
+        while (n--) {
+            *--d = *--s;
+        }
+        return dst;
     }
 
     int memcmp(const void* left, const void* right, size_t n)
     {
-        const char *s1 = reinterpret_cast<const char*>(left);
-        const char *s2 = reinterpret_cast<const char*>(right);
+        const uint8_t* s1 = reinterpret_cast<const uint8_t*>(left);
+        const uint8_t* s2 = reinterpret_cast<const uint8_t*>(right);
+        
+        // Skip equal words when both sides can be aligned. The bytes of
+        // the first word that differs are compared below.
+        if (n >= MinWordSize && ((reinterpret_cast<uintptr_t>(s1) ^ reinterpret_cast<uintptr_t>(s2)) & WordMask) == 0) {
+            while (reinterpret_cast<uintptr_t>(s1) & WordMask) {
+                if (*s1 != *s2) {
+                    return (*s1 < *s2) ? -1 : 1;
+                }
+                s1++;
+                s2++;
+                n--;
+            }
+            
+            const Word* w1 = reinterpret_cast<const Word*>(s1);
+            const Word* w2 = reinterpret_cast<const Word*>(s2);
+            for ( ; n >= sizeof(Word) && *w1 == *w2; n -= sizeof(Word)) {
+                w1++;
+                w2++;
+            }
+            s1 = reinterpret_cast<const uint8_t*>(w1);
+            s2 = reinterpret_cast<const uint8_t*>(w2);
+        }
+        
         while (n--) {
-            if (*s1 < *s2) {
-                return -1;
-            } else if (*s1 > *s2) {
-                return 1;
+            if (*s1 != *s2) {
+                return (*s1 < *s2) ? -1 : 1;
             }
             s1++;
             s2++;
@@ -133,9 +297,22 @@ extern "C" {
 
     size_t strlen(const char* str)
     {
-        const char* s;
-        for (s = str; *s; ++s) { }
-        return (unsigned int)(s - str);
+        const char* s = str;
+        while (reinterpret_cast<uintptr_t>(s) & WordMask) {
+            if (!*s) {
+                return s - str;
+            }
+            s++;
+        }
+        
+        // An aligned word never crosses a page, so reading the whole word
+        // holding the terminator is safe
+        const Word* w = reinterpret_cast<const Word*>(s);
+        while (!hasZeroByte(*w)) {
+            w++;
+        }
+        for (s = reinterpret_cast<const char*>(w); *s; ++s) { }
+        return s - str;
     }
 
     char* strcpy(char* dst, const char* src)
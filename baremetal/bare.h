@@ -80,6 +80,7 @@ namespace bare {
         void PUT8(uint8_t*, uint8_t);
         void BRANCHTO(uint8_t*);
         void WFE();
+        void SEV();
 
         void* memset(void* p, int value, size_t n);
         void* memcpy(void* dst, const void* src, size_t n);
@@ -106,4 +107,15 @@ namespace bare {
     static inline bool isSpace(uint8_t c)       { return c == ' ' || c == '\n' || c == '\r' || c == '\f' || c == '\t' || c == '\v'; }
     static inline uint8_t toLower(uint8_t c)    { return isUpper(c) ? (c - 'A' + 'a') : c; }
     static inline uint8_t toUpper(uint8_t c)    { return isLower(c) ? (c - 'a' + 'A') : c; }
+    
+    // 32 bit FNV-1a hash
+    static inline uint32_t hash(const void* data, size_t n)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < n; ++i) {
+            h = (h ^ p[i]) * 16777619u;
+        }
+        return h;
+    }
 }
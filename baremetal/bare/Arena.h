@@ -0,0 +1,170 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bare {
+
+    // Arena - Bump pointer region allocator
+    //
+    // Memory is handed out by advancing a pointer through a chain of blocks
+    // obtained from the heap. Individual allocations are never freed. Instead
+    // the arena is rolled back to a Mark, usually by letting an Arena::Scope
+    // go out of scope, which releases everything allocated since in one shot.
+    // Blocks are kept once allocated, so a long lived Arena that is used for
+    // one request at a time stops touching the heap after the first few
+    // requests.
+    //
+    // Anything allocated from an Arena must be gone before the Scope it was
+    // allocated in ends. Destructors are not run, so only use it for objects
+    // whose destructors don't matter (or do nothing but free memory).
+    //
+    class Arena
+    {
+        struct Block;
+        
+    public:
+        static constexpr size_t DefaultBlockSize = 2048;
+        static constexpr size_t DefaultAlignment = 8;
+        
+        Arena(size_t blockSize = DefaultBlockSize) : _blockSize(blockSize) { }
+        ~Arena();
+        
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        
+        void* alloc(size_t size, size_t alignment = DefaultAlignment);
+        
+        // Memory is only reclaimed if addr was the last allocation made.
+        // Otherwise this does nothing
+        void free(void* addr, size_t size);
+        
+        // Grow the allocation at addr from oldSize to newSize bytes without
+        // moving it. Only possible if addr was the last allocation made and
+        // there is room left in the current block.
+        bool expand(void* addr, size_t oldSize, size_t newSize);
+        
+        class Mark
+        {
+            friend class Arena;
+            
+        private:
+            Mark(Block* block, uint8_t* cur) : _block(block), _cur(cur) { }
+            
+            Block* _block;
+            uint8_t* _cur;
+        };
+        
+        Mark mark() const { return Mark(_current, _cur); }
+        void release(const Mark&);
+        void reset();
+        
+        // Bytes handed out since the last reset, including alignment padding
+        size_t used() const;
+        
+        // Bytes held in blocks, whether in use or not
+        size_t capacity() const;
+        
+        // Scope
+        //
+        // Mark the arena on construction and release it back to that mark
+        // on destruction
+        //
+        class Scope
+        {
+        public:
+            Scope(Arena& arena) : _arena(arena), _mark(arena.mark()) { }
+            ~Scope() { _arena.release(_mark); }
+            
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            
+        private:
+            Arena& _arena;
+            Mark _mark;
+        };
+        
+    private:
+        struct Block
+        {
+            Block* next;
+            size_t size;
+            
+            uint8_t* start() { return reinterpret_cast<uint8_t*>(this + 1); }
+            uint8_t* end() { return start() + size; }
+        };
+        
+        bool nextBlock(size_t size, size_t alignment);
+        
+        size_t _blockSize;
+        Block* _first = nullptr;
+        Block* _current = nullptr;
+        uint8_t* _cur = nullptr;
+        uint8_t* _end = nullptr;
+        uint8_t* _last = nullptr; // start of the most recent allocation
+    };
+    
+    // ArenaAllocator
+    //
+    // Standard library allocator so containers like std::vector can allocate
+    // from an Arena. deallocate only gives memory back when it was the most
+    // recent allocation, which is the common case for a vector growing one
+    // push_back at a time.
+    //
+    template<typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+        
+        ArenaAllocator(Arena& arena) : _arena(&arena) { }
+        template<typename U> ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.arena()) { }
+        
+        T* allocate(size_t n) { return reinterpret_cast<T*>(_arena->alloc(n * sizeof(T), alignof(T))); }
+        void deallocate(T* p, size_t n) { _arena->free(p, n * sizeof(T)); }
+        
+        Arena* arena() const { return _arena; }
+        
+        template<typename U> bool operator==(const ArenaAllocator<U>& other) const { return _arena == other.arena(); }
+        template<typename U> bool operator!=(const ArenaAllocator<U>& other) const { return _arena != other.arena(); }
+        
+    private:
+        Arena* _arena;
+    };
+
+}
@@ -0,0 +1,103 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace bare {
+
+    // FixedMath - Math kernels for Float
+    //
+    // Values are Q30, an int64_t with 30 fraction bits, which holds the
+    // raw value of both Float32 and Float64 exactly. Each function reduces
+    // its argument, looks up a small table and finishes with a short
+    // polynomial, all in integer arithmetic. Float calls these and rounds
+    // the result to its own precision. Errors are in units of the last
+    // Q30 bit (about 9.3e-10), measured against libm over the range of
+    // Float64:
+    //
+    //     sqrt    0.5 for x < 16, 2^-31 relative above
+    //     sin     3 for |x| < 8, 4 over the whole range
+    //     cos     same as sin
+    //     atan2   3
+    //     exp     3 for x <= 0, 2^-28 relative above
+    //     log     4
+    //
+    // Float32 results are within half of its 2^-10 step plus those.
+    //
+    // There's no libm on the device, so the double versions, which the IEEE
+    // Floats use, run the same kernels. They take the exponent apart and
+    // reduce the argument in floating point first, so they cover the whole
+    // range of a double with about the same error, 2^-28 relative for exp
+    // and 3e-9 for the others. Past 2^26 the error of sin and cos grows
+    // with the spacing of doubles at x. sqrt finishes with a Newton step,
+    // so it's good to the last bit. Like the libm versions, results out of
+    // range are infinity or 0, log(0) is -infinity and NaN is passed
+    // through.
+    class FixedMath
+    {
+    public:
+        static constexpr int32_t FractionBits = 30;
+        static constexpr int64_t One = static_cast<int64_t>(1) << FractionBits;
+        
+        // 0 for x <= 0
+        static int64_t sqrt(int64_t x);
+        
+        static int64_t sin(int64_t x);
+        static int64_t cos(int64_t x);
+        
+        // Angle of (x, y) in [-pi, pi]. 0 for (0, 0)
+        static int64_t atan2(int64_t y, int64_t x);
+        
+        // Results above max are max
+        static int64_t exp(int64_t x, int64_t max);
+        
+        // lowest for x <= 0
+        static int64_t log(int64_t x, int64_t lowest);
+        
+        // NaN for x < 0
+        static double sqrt(double x);
+        
+        static double sin(double x);
+        static double cos(double x);
+        static double atan2(double y, double x);
+        static double exp(double x);
+        
+        // NaN for x < 0
+        static double log(double x);
+    };
+
+}
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+namespace bare {
+
+    // FixedVector
+    //
+    // Vector with its storage inline and a fixed capacity, for small
+    // arrays which must not allocate. push_back returns false when full.
+    //
+    template<typename T, size_t Capacity>
+    class FixedVector {
+    public:
+        bool push_back(const T& value)
+        {
+            if (_size >= Capacity) {
+                return false;
+            }
+            _data[_size++] = value;
+            return true;
+        }
+        
+        void pop_back() { assert(_size > 0); --_size; }
+        void clear() { _size = 0; }
+        
+        size_t size() const { return _size; }
+        static constexpr size_t capacity() { return Capacity; }
+        bool empty() const { return _size == 0; }
+        bool full() const { return _size == Capacity; }
+        
+        const T& operator[](size_t i) const { assert(i < _size); return _data[i]; }
+        T& operator[](size_t i) { assert(i < _size); return _data[i]; }
+        const T& back() const { assert(_size > 0); return _data[_size - 1]; }
+        
+        const T* begin() const { return _data; }
+        const T* end() const { return _data + _size; }
+        T* begin() { return _data; }
+        T* end() { return _data + _size; }
+        
+    private:
+        T _data[Capacity];
+        size_t _size = 0;
+    };
+
+}
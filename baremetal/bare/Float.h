@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "FixedMath.h"
 #include "fpconv.h"
 #include <utility>
 #include <cmath>
@@ -85,6 +86,10 @@ public:
     static constexpr decompose_type DecimalMultiplier = exp(1, 10, DecimalExponent);
     static constexpr decompose_type MaxDigits = (sizeof(value_type) <= 32) ? 8 : 12;
     
+    // Fixed point types print exactly from their binary value with
+    // decompose. The others get their digits from fpconv in toString.
+    static constexpr bool IsFixedPoint = BinExp != 0;
+    
     // Constructors
     //
     _Float() { _value = 0; }
@@ -208,6 +213,18 @@ public:
 
     _Float operator%(const _Float& other) { return *this - other * (*this / other).floor(); }
     
+    // Split the magnitude into its integer part and the BinaryExponent
+    // bits of its fraction. Returns true if the value is negative. Only
+    // for fixed point types.
+    bool decompose(uint64_t& intPart, uint64_t& fracPart) const
+    {
+        bool negative = _value < 0;
+        uint64_t magnitude = negative ? -static_cast<uint64_t>(_value) : static_cast<uint64_t>(_value);
+        intPart = magnitude >> BinaryExponent;
+        fracPart = magnitude & BinaryMask;
+        return negative;
+    }
+    
     bool operator==(const _Float& other) const { return _value == other._value; }
     bool operator!=(const _Float& other) const { return _value != other._value; }
     bool operator<(const _Float& other) const { return _value < other._value; }
@@ -217,7 +234,74 @@ public:
 
     _Float operator-() const { _Float r; r._value = -_value; return r; }
 
-private:    
+    // Math functions. Fixed point types use the Q30 FixedMath kernels, so
+    // the results are those rounded to BinaryExponent bits. IEEE types use
+    // the double versions. See FixedMath.h for the error bounds. Fixed
+    // point results out of range are the largest value of the right sign.
+    _Float sqrt() const { return IsFixedPoint ? fromQ30(FixedMath::sqrt(toQ30())) : fromValue(FixedMath::sqrt(toDouble())); }
+    _Float sin() const { return IsFixedPoint ? fromQ30(FixedMath::sin(toQ30())) : fromValue(FixedMath::sin(toDouble())); }
+    _Float cos() const { return IsFixedPoint ? fromQ30(FixedMath::cos(toQ30())) : fromValue(FixedMath::cos(toDouble())); }
+    _Float exp() const { return IsFixedPoint ? fromQ30(FixedMath::exp(toQ30(), maxQ30())) : fromValue(FixedMath::exp(toDouble())); }
+    _Float log() const { return IsFixedPoint ? fromQ30(FixedMath::log(toQ30(), -maxQ30())) : fromValue(FixedMath::log(toDouble())); }
+    
+    static _Float atan2(const _Float& y, const _Float& x)
+    {
+        return IsFixedPoint ? fromQ30(FixedMath::atan2(y.toQ30(), x.toQ30())) : fromValue(FixedMath::atan2(y.toDouble(), x.toDouble()));
+    }
+    
+    // Array versions. dst can be the same as src
+    static void scale(_Float* dst, const _Float* src, size_t count, const _Float& factor)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = src[i] * factor;
+        }
+    }
+    
+    // dst += src * factor
+    static void accumulate(_Float* dst, const _Float* src, size_t count, const _Float& factor)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] += src[i] * factor;
+        }
+    }
+    
+    // 32 bit fixed point sums the full products and rounds once at the end
+    static _Float dot(const _Float* a, const _Float* b, size_t count)
+    {
+        if (IsFixedPoint && sizeof(value_type) <= sizeof(int32_t)) {
+            int64_t sum = 0;
+            for (size_t i = 0; i < count; ++i) {
+                sum += static_cast<int64_t>(a[i]._value) * static_cast<int64_t>(b[i]._value);
+            }
+            _Float r;
+            r._value = static_cast<value_type>((sum + (BinaryMultiplier >> 1)) >> BinaryExponent);
+            return r;
+        }
+        _Float sum;
+        for (size_t i = 0; i < count; ++i) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+private:
+    // FixedMath works in Q30, which holds the raw value of every fixed
+    // point type
+    static constexpr decompose_type Q30Shift = FixedMath::FractionBits - BinaryExponent;
+    
+    int64_t toQ30() const { return static_cast<int64_t>(_value) * (FixedMath::One / BinaryMultiplier); }
+    static int64_t maxQ30() { return static_cast<int64_t>(std::numeric_limits<value_type>::max()) * (FixedMath::One / BinaryMultiplier); }
+    
+    static _Float fromQ30(int64_t q)
+    {
+        _Float r;
+        r._value = static_cast<value_type>((q + ((static_cast<int64_t>(1) << Q30Shift) >> 1)) >> Q30Shift);
+        return r;
+    }
+    
+    double toDouble() const { return static_cast<double>(_value); }
+    static _Float fromValue(double v) { _Float r; r._value = static_cast<value_type>(v); return r; }
+    
     value_type _value;
 };
 
@@ -266,6 +350,12 @@ inline _Float<float, int32_t, double> _Float<float, int32_t, double>::floor() co
     return r;
 }
 
+template<>
+inline _Float<float, int32_t, double>::operator int32_t() const { return static_cast<int32_t>(_value); }
+
+template<>
+inline _Float<float, int32_t, double>::operator int64_t() const { return static_cast<int64_t>(_value); }
+
 // double specializations
 
 template<>
@@ -305,6 +395,12 @@ inline _Float<double, int64_t, double> _Float<double, int64_t, double>::floor()
     return r;
 }
 
+template<>
+inline _Float<double, int64_t, double>::operator int32_t() const { return static_cast<int32_t>(_value); }
+
+template<>
+inline _Float<double, int64_t, double>::operator int64_t() const { return static_cast<int64_t>(_value); }
+
 // int64_t specializations
 template<>
 inline _Float<int64_t, int64_t, int64_t, 30, 7> _Float<int64_t, int64_t, int64_t, 30, 7>::operator*(const _Float& other) const
@@ -0,0 +1,243 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare.h"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace bare {
+
+    // Format
+    //
+    // Compile time parsing of printf style format strings. A literal is
+    // wrapped with FMT("..."), which makes a distinct type whose str() is a
+    // constexpr function returning the literal. Print::format and the
+    // printf functions of Serial and String have overloads taking one of
+    // these. They parse the string at compile time into literal runs and
+    // conversions, check the count and types of the arguments with
+    // static_assert and emit each field with its flags, width and base as
+    // constants. Nothing is parsed at runtime.
+    //
+    // The syntax is the same as Print::vformat, except that '*' widths are
+    // not allowed. Argument types have to suit the conversion:
+    //
+    //     d i u o x X c    any integral type
+    //     s                const char*
+    //     p                any pointer
+    //     f F e E g G      Float or a floating point type
+    //
+    // Integers are printed as their own type, so length modifiers are not
+    // needed. If given, 'h' and 'hh' still truncate the value.
+    
+    class FormatString { };
+    
+    #define FMT(s) ([] { \
+        struct _Format : bare::FormatString { static constexpr const char* str() { return s; } }; \
+        return _Format(); \
+    }())
+
+    class Format {
+    public:
+        enum class Flag : uint8_t {
+            leftJustify = 0x01,
+            plus = 0x02,
+            space = 0x04,
+            alt = 0x08,
+            zeroPad = 0x10,
+        };
+        
+        enum class Length : uint8_t { None, H, HH, L, LL, J, Z, T };
+        
+        // Conversion characters. Star and Invalid are errors
+        static constexpr char End = '\0';
+        static constexpr char Star = '*';
+        static constexpr char Invalid = '?';
+        
+        // One conversion, and the run of literal text before it. The
+        // trailing literal has a conversion of End. If the literal
+        // contains "%%" escapes, hasEscapes is set and it must be
+        // written with writeEscaped.
+        struct Spec
+        {
+            uint16_t literalStart = 0;
+            uint16_t literalLength = 0;
+            bool hasEscapes = false;
+            char conversion = End;
+            uint8_t flags = 0;
+            int16_t width = -1;
+            int16_t precision = -1;
+            Length length = Length::None;
+            uint16_t next = 0;
+            
+            constexpr bool isFlag(Flag flag) const { return (flags & static_cast<uint8_t>(flag)) != 0; }
+        };
+        
+        template<typename F>
+        using EnableIfFormat = typename std::enable_if<std::is_base_of<FormatString, F>::value>::type;
+        
+        // Parse the literal run starting at pos and the conversion after it
+        static constexpr Spec parse(const char* s, uint16_t pos)
+        {
+            Spec spec;
+            spec.literalStart = pos;
+            while (s[pos] != '\0') {
+                if (s[pos] == '%') {
+                    if (s[pos + 1] != '%') {
+                        break;
+                    }
+                    spec.hasEscapes = true;
+                    ++pos;
+                }
+                ++pos;
+            }
+            spec.literalLength = pos - spec.literalStart;
+            if (s[pos] == '\0') {
+                spec.next = pos;
+                return spec;
+            }
+            
+            ++pos;
+            for (bool more = true; more; ) {
+                switch (s[pos]) {
+                case '-': spec.flags |= static_cast<uint8_t>(Flag::leftJustify); break;
+                case '+': spec.flags |= static_cast<uint8_t>(Flag::plus); break;
+                case ' ': spec.flags |= static_cast<uint8_t>(Flag::space); break;
+                case '#': spec.flags |= static_cast<uint8_t>(Flag::alt); break;
+                case '0': spec.flags |= static_cast<uint8_t>(Flag::zeroPad); break;
+                default: more = false; continue;
+                }
+                ++pos;
+            }
+            
+            bool star = false;
+            spec.width = number(s, pos, star);
+            if (s[pos] == '.') {
+                spec.precision = number(s, ++pos, star);
+            }
+            
+            if (s[pos] == 'h') {
+                spec.length = (s[pos + 1] == 'h') ? Length::HH : Length::H;
+            } else if (s[pos] == 'l') {
+                spec.length = (s[pos + 1] == 'l') ? Length::LL : Length::L;
+            } else if (s[pos] == 'j') {
+                spec.length = Length::J;
+            } else if (s[pos] == 'z') {
+                spec.length = Length::Z;
+            } else if (s[pos] == 't') {
+                spec.length = Length::T;
+            }
+            if (spec.length == Length::HH || spec.length == Length::LL) {
+                ++pos;
+            }
+            if (spec.length != Length::None) {
+                ++pos;
+            }
+            
+            spec.conversion = star ? Star : isConversion(s[pos]) ? s[pos] : Invalid;
+            spec.next = (s[pos] == '\0') ? pos : pos + 1;
+            return spec;
+        }
+        
+        static constexpr uint16_t argumentCount(const char* s)
+        {
+            uint16_t count = 0;
+            for (Spec spec = parse(s, 0); spec.conversion != End; spec = parse(s, spec.next)) {
+                ++count;
+            }
+            return count;
+        }
+        
+        static constexpr bool isValid(const char* s)
+        {
+            for (Spec spec = parse(s, 0); spec.conversion != End; spec = parse(s, spec.next)) {
+                if (spec.conversion == Star || spec.conversion == Invalid) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        static constexpr bool isIntegerConversion(char c)
+        {
+            return c == 'd' || c == 'i' || c == 'u' || c == 'o' || c == 'x' || c == 'X' || c == 'c';
+        }
+        
+        static constexpr bool isFloatConversion(char c)
+        {
+            return c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G';
+        }
+        
+        // Whether an argument of type T can be used with conversion c
+        template<typename T>
+        static constexpr bool accepts(char c)
+        {
+            using U = typename std::decay<T>::type;
+            return (isIntegerConversion(c) && std::is_integral<U>::value) ||
+                   (c == 's' && std::is_convertible<U, const char*>::value) ||
+                   (c == 'p' && std::is_pointer<U>::value) ||
+#if !defined(FLOATNONE)
+                   (isFloatConversion(c) && (std::is_same<U, Float>::value || std::is_floating_point<U>::value)) ||
+#endif
+                   false;
+        }
+        
+    private:
+        static constexpr bool isConversion(char c)
+        {
+            return isIntegerConversion(c) || isFloatConversion(c) || c == 's' || c == 'p';
+        }
+        
+        static constexpr int16_t number(const char* s, uint16_t& pos, bool& star)
+        {
+            if (s[pos] == '*') {
+                star = true;
+                ++pos;
+                return -1;
+            }
+            if (s[pos] < '0' || s[pos] > '9') {
+                return -1;
+            }
+            int16_t n = 0;
+            while (s[pos] >= '0' && s[pos] <= '9') {
+                n = n * 10 + s[pos++] - '0';
+            }
+            return n;
+        }
+    };
+    
+}
@@ -57,5 +57,43 @@ namespace bare {
 		InterruptManager(InterruptManager&) { }
 		InterruptManager& operator=(InterruptManager& other) { return other; }
 	};
+    
+    // True if IRQs are masked, as they are in a handler or an IRQGuard
+    static inline bool irqsMasked()
+    {
+#if defined(PLATFORM_RPI)
+        uint32_t cpsr;
+        __asm__ volatile("mrs %0, cpsr\n" : "=r" (cpsr));
+        return (cpsr & 0x80) != 0;
+#else
+        return false;
+#endif
+    }
+    
+    // IRQGuard - Masks IRQs for its lifetime
+    //
+    // This saves and restores the previous state rather than using
+    // disableIRQ/enableIRQ, which don't nest, so it can be used from code
+    // which also runs in interrupt handlers.
+    class IRQGuard
+    {
+    public:
+#if defined(PLATFORM_RPI)
+        IRQGuard()
+        {
+            __asm__ volatile("mrs %0, cpsr\n" "cpsid i\n" : "=r" (_cpsr) : : "memory");
+        }
+        
+        ~IRQGuard()
+        {
+            __asm__ volatile("msr cpsr_c, %0\n" : : "r" (_cpsr) : "memory");
+        }
+        
+    private:
+        uint32_t _cpsr;
+#else
+        IRQGuard() { }
+#endif
+    };
 	
 }
@@ -35,27 +35,117 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
-#include "Serial.h"
-
-static inline void ERROR_LOG(const char* format, ...)
-{
-    bare::Serial::printf("ERROR: ");
-    va_list va;
-    va_start(va, format);
-    bare::Serial::vprintf(format, va);
-    va_end(va);
-}
-#ifdef ENABLE_DEBUG_LOG
-static inline void DEBUG_LOG(const char* format, ...)
-{
-    bare::Serial::printf("log  : ");
-    va_list va;
-    va_start(va, format);
-    bare::Serial::vprintf(format, va);
-    va_end(va);
+#include "bare/Print.h"
+#include "bare/Serial.h"
+
+// Logging
+//
+// A module chooses its log level by defining LOG_LEVEL before including
+// this file. Levels above it compile to nothing, with their arguments
+// unevaluated. The default is LOG_LEVEL_ERROR. Defining ENABLE_DEBUG_LOG
+// is the same as LOG_LEVEL_DEBUG.
+//
+// ERROR_LOG writes to the serial port right away. DEBUG_LOG is deferred:
+// it stores the format pointer, a timestamp and the raw arguments in a
+// ring buffer and returns, so it is cheap enough for hot paths and
+// doesn't change their timing. The entries are formatted later by
+// Log::drain, from the shell's 'log' command or in the background when
+// the kernel is idle. Since a deferred format and its %s arguments are
+// used after the call returns, they must be string literals or otherwise
+// outlive the entry. Define LOG_IMMEDIATE to have DEBUG_LOG write right
+// away as ERROR_LOG does.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_DEBUG 2
+
+#if !defined(LOG_LEVEL)
+    #if defined(ENABLE_DEBUG_LOG)
+        #define LOG_LEVEL LOG_LEVEL_DEBUG
+    #else
+        #define LOG_LEVEL LOG_LEVEL_ERROR
+    #endif
+#endif
+
+namespace bare {
+
+    class Log {
+    public:
+        enum class Level : uint8_t { Error = LOG_LEVEL_ERROR, Debug = LOG_LEVEL_DEBUG };
+        
+        static constexpr uint32_t MaxArgs = 6;
+        static constexpr uint32_t Capacity = 128;
+        
+        template<typename... Args>
+        static void immediate(Level level, const char* format, const Args&... args)
+        {
+            Serial::printf(prefix(level));
+            Serial::printf(format, args...);
+        }
+        
+        template<typename... Args>
+        static void defer(Level level, const char* format, const Args&... args)
+        {
+            static_assert(sizeof...(Args) <= MaxArgs, "too many arguments for a deferred log entry");
+            
+            // One extra so the array is never empty
+            const uint64_t slots[sizeof...(Args) + 1] = { Print::toArgSlot(args)... };
+            record(level, format, slots, sizeof...(Args));
+        }
+        
+        // Format up to max pending entries, oldest first, one line each.
+        // Returns the number formatted
+        static uint32_t drain(Print::Sink&, uint32_t max = Capacity);
+        
+        // Entries waiting to be drained, and those overwritten before they
+        // could be
+        static uint32_t pending();
+        static uint32_t dropped();
+        static void clear();
+        
+        // When on, idle() drains some entries to the serial port and returns
+        // true if there were any. The kernel calls it while waiting for input.
+        static void setBackgroundDrain(bool on) { _backgroundDrain = on; }
+        static bool backgroundDrain() { return _backgroundDrain; }
+        static bool idle();
+        
+        static const char* prefix(Level level) { return (level == Level::Error) ? "ERROR: " : "log  : "; }
+
+    private:
+        struct Entry
+        {
+            const char* format;
+            int64_t time;
+            Level level;
+            uint8_t count;
+            uint64_t args[MaxArgs];
+        };
+        
+        static void record(Level, const char* format, const uint64_t* args, uint32_t count);
+        
+        static Entry _entries[Capacity];
+        static uint32_t _head;
+        static uint32_t _tail;
+        static uint32_t _dropped;
+        static bool _backgroundDrain;
+    };
+
 }
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+    #define ERROR_LOG(...) bare::Log::immediate(bare::Log::Level::Error, __VA_ARGS__)
+#else
+    #define ERROR_LOG(...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    #if defined(LOG_IMMEDIATE)
+        #define DEBUG_LOG(...) bare::Log::immediate(bare::Log::Level::Debug, __VA_ARGS__)
+    #else
+        #define DEBUG_LOG(...) bare::Log::defer(bare::Log::Level::Debug, __VA_ARGS__)
+    #endif
 #else
-static inline void DEBUG_LOG(const char* format, ...) { }
+    #define DEBUG_LOG(...) do { } while (0)
 #endif
 
 #undef ENABLE_DEBUG_LOG
@@ -54,16 +54,36 @@ namespace bare {
         static void* heapStart();
         static size_t heapSize();
 
+        static bool initialized() { return _kernelHeap != nullptr; }
+        
         static bool mapSegment(size_t size, void*& addr)
         {
-            return _kernelHeap->mapSegment(size, addr);
+            return _kernelHeap ? _kernelHeap->mapSegment(size, addr) : mapBootstrapSegment(size, addr);
         }
 
         static int32_t unmapSegment(void* addr, size_t size)
         {
-            return _kernelHeap->unmapSegment(addr, size);
+            return _kernelHeap ? _kernelHeap->unmapSegment(addr, size) : -1;
         }
         
+        // Bootstrap heap
+        //
+        // Static constructors run before init(), so until then segments
+        // come from a small fixed region (placed by the linker on RPi).
+        // Segments are never returned to it. Chunks allocated there stay
+        // valid after init(), only new segments come from the kernel heap.
+        static bool mapBootstrapSegment(size_t size, void*& addr);
+        static size_t bootstrapHeapSize();
+        static size_t bootstrapHeapUsed();
+        
+        // The allocator behind operator new can register a function to grow
+        // an allocation in place. expand() returns false if there is none or
+        // there isn't room, and the caller has to allocate and copy.
+        typedef bool (*ExpandFunction)(void* addr, size_t size);
+        
+        static void setExpandFunction(ExpandFunction f) { _expandFunction = f; }
+        static bool expand(void* addr, size_t size) { return _expandFunction && _expandFunction(addr, size); }
+        
         class Heap
         {
         public:
@@ -165,6 +185,7 @@ namespace bare {
         };
         
         static Heap* _kernelHeap;
+        static ExpandFunction _expandFunction;
     };
     
 }
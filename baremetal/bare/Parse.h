@@ -0,0 +1,174 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare.h"
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace bare {
+
+    // Number parsing
+    //
+    // parse() reads a number from the start of [s, end) into value and
+    // returns where it stopped, without allocating. The versions without
+    // end take a null terminated string. 
+    //
+    // Integers are read in the passed base, from 2 to 16. With base 0 a 0x,
+    // 0o or 0b prefix selects hex, octal or binary and the number is decimal
+    // otherwise. Signed types take a leading - or +. A number too big for
+    // its type is Overflow. All of its digits are consumed and the value is
+    // the largest one of the right sign.
+    //
+    // Floats are decimal with an optional sign, fraction and exponent. An
+    // e not followed by digits isn't part of the number. Digits beyond what
+    // the mantissa holds only scale it. A number beyond the range of Float
+    // is Overflow, with the largest value of the right sign.
+    
+    enum class ParseError : uint8_t { None, NoDigits, Overflow };
+    
+    struct ParseResult
+    {
+        const char* end;
+        ParseError error;
+        
+        bool ok() const { return error == ParseError::None; }
+    };
+    
+    // Value of c as a digit, or 0xff if it isn't one in any base
+    static inline uint8_t digitValue(uint8_t c)
+    {
+        return isDigit(c) ? (c - '0') : (isLCHex(c) ? (c - 'a' + 10) : (isUCHex(c) ? (c - 'A' + 10) : 0xff));
+    }
+    
+    // Where the number at s ends at the latest, for the null terminated
+    // versions. Only looks at characters that could be part of a number
+    static inline const char* numberEnd(const char* s)
+    {
+        if (*s == '-' || *s == '+') {
+            ++s;
+        }
+        for ( ; isIdOther(*s) || *s == '.'; ++s) {
+            if ((*s == 'e' || *s == 'E') && (s[1] == '-' || s[1] == '+')) {
+                ++s;
+            }
+        }
+        return s;
+    }
+    
+    template<typename T>
+    using EnableIfInteger = typename std::enable_if<std::is_integral<T>::value, ParseResult>::type;
+    
+    // Magnitude of at most limit, with no sign
+    template<typename T>
+    ParseResult parseDigits(const char* s, const char* end, T& value, uint8_t base, T limit)
+    {
+        if (base == 0) {
+            base = 10;
+            if (s + 2 < end && s[0] == '0') {
+                uint8_t prefix = toLower(s[1]);
+                uint8_t prefixBase = (prefix == 'x') ? 16 : ((prefix == 'o') ? 8 : ((prefix == 'b') ? 2 : 0));
+                if (prefixBase && digitValue(s[2]) < prefixBase) {
+                    base = prefixBase;
+                    s += 2;
+                }
+            }
+        }
+        
+        // n * base + digit fits if n is below limit / base, or equal to it
+        // and digit is at most limit % base
+        const T maxQuotient = limit / base;
+        const uint8_t maxRemainder = static_cast<uint8_t>(limit % base);
+        const char* start = s;
+        T n = 0;
+        bool overflow = false;
+        for ( ; s < end; ++s) {
+            uint8_t digit = digitValue(*s);
+            if (digit >= base) {
+                break;
+            }
+            if (n < maxQuotient || (n == maxQuotient && digit <= maxRemainder)) {
+                n = n * base + digit;
+            } else {
+                overflow = true;
+            }
+        }
+        
+        if (s == start) {
+            value = 0;
+            return { s, ParseError::NoDigits };
+        }
+        value = overflow ? limit : n;
+        return { s, overflow ? ParseError::Overflow : ParseError::None };
+    }
+    
+    template<typename T>
+    EnableIfInteger<T> parse(const char* s, const char* end, T& value, uint8_t base = 10)
+    {
+        using Unsigned = typename std::make_unsigned<T>::type;
+        
+        const char* start = s;
+        bool negative = false;
+        if (std::is_signed<T>::value && s < end && (*s == '-' || *s == '+')) {
+            negative = *s++ == '-';
+        }
+        
+        // The most negative value has one more than the most positive
+        Unsigned limit = static_cast<Unsigned>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        Unsigned magnitude;
+        ParseResult result = parseDigits(s, end, magnitude, base, limit);
+        if (result.error == ParseError::NoDigits) {
+            result.end = start;
+        }
+        value = negative ? static_cast<T>(Unsigned(0) - magnitude) : static_cast<T>(magnitude);
+        return result;
+    }
+    
+    template<typename T>
+    EnableIfInteger<T> parse(const char* s, T& value, uint8_t base = 10)
+    {
+        return parse(s, numberEnd(s), value, base);
+    }
+    
+    ParseResult parse(const char* s, const char* end, Float& value);
+    
+    static inline ParseResult parse(const char* s, Float& value)
+    {
+        return parse(s, numberEnd(s), value);
+    }
+
+}
@@ -37,6 +37,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare.h"
 
+#include "bare/Format.h"
 #include <cstdarg>
 #include <cstddef>
 #include <cstdint>
@@ -51,11 +52,74 @@ namespace bare {
     class Print {
     public:
         using Printer = std::function<void(char)>;
+        
+        // Sink
+        //
+        // Destination for formatted output. vformat buffers its output on
+        // the stack and hands the sink whole runs of literal text and
+        // converted fields, rather than making a call per character.
+        class Sink
+        {
+        public:
+            virtual ~Sink() { }
+            virtual void write(const char*, size_t) = 0;
+        };
+        
+        // Sink for a Printer, one call per character
+        class PrinterSink : public Sink
+        {
+        public:
+            PrinterSink(const Printer& printer) : _printer(printer) { }
+            
+            virtual void write(const char* s, size_t n) override
+            {
+                while (n--) {
+                    _printer(*s++);
+                }
+            }
+            
+        private:
+            const Printer& _printer;
+        };
+        
+        // Sink into a fixed char buffer, like snprintf. Output which doesn't
+        // fit is dropped, and the buffer is always null terminated.
+        class BufferSink : public Sink
+        {
+        public:
+            BufferSink(char* buf, size_t size) : _buf(buf), _size(size)
+            {
+                if (_size) {
+                    _buf[0] = '\0';
+                }
+            }
+            
+            virtual void write(const char* s, size_t n) override
+            {
+                if (_length + 1 >= _size) {
+                    return;
+                }
+                if (n > _size - _length - 1) {
+                    n = _size - _length - 1;
+                }
+                memcpy(_buf + _length, s, n);
+                _length += n;
+                _buf[_length] = '\0';
+            }
+            
+            size_t length() const { return _length; }
+            
+        private:
+            char* _buf;
+            size_t _size;
+            size_t _length = 0;
+        };
 
         enum class Capital { Yes, No };
         
-        //                                                 sign    digits  dp      'e'     dp      exp     '\0'
-        static constexpr uint32_t MaxToStringBufferSize =    1 +     20 +   1 +     1 +     1 +     3 +      1;
+        // Float precision is limited so every form fits in MaxFloatBufferSize
+        static constexpr int32_t MaxFloatPrecision = 32;
+        static constexpr uint32_t MaxFloatBufferSize = 64;
         static constexpr uint32_t MaxStringSize = 256;
         static constexpr uint32_t MaxIntegerBufferSize = 24; // Big enough for a 64 bit integer in octal
 
@@ -69,7 +133,61 @@ namespace bare {
         }
         
         static int32_t vformat(Printer, const char *format, va_list);
+        
+        static int32_t format(Sink& sink, const char* fmt, ...)
+        {
+            va_list va;
+            va_start(va, fmt);
+            int32_t result = vformat(sink, fmt, va);
+            va_end(va);
+            return result;
+        }
+        
+        static int32_t vformat(Sink&, const char *format, va_list);
+        
+        // Format with arguments stored in an array by toArgSlot, so they
+        // can be formatted some time after the call that supplied them
+        static int32_t vformat(Sink&, const char *format, const uint64_t* args, uint32_t count);
+        
+        // An argument stored as it would be passed through '...'
+        template<typename T>
+        static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint64_t>::type toArgSlot(T v)
+        {
+            return static_cast<uint64_t>(static_cast<int64_t>(v));
+        }
+        static uint64_t toArgSlot(const void* p) { return reinterpret_cast<uintptr_t>(p); }
+        static uint64_t toArgSlot(double d)
+        {
+            uint64_t slot;
+            memcpy(&slot, &d, sizeof(slot));
+            return slot;
+        }
+#if !defined(FLOATNONE)
+        static uint64_t toArgSlot(const Float& f) { return toArgSlot(f.toArg()); }
+#endif
+        
+        // Format with a string wrapped in FMT(). The string is parsed at
+        // compile time (see Format.h)
+        template<typename F, typename... Args, typename = Format::EnableIfFormat<F>>
+        static int32_t format(Sink& sink, F, const Args&... args)
+        {
+            static_assert(Format::isValid(F::str()), "invalid conversion or '*' width in format string");
+            static_assert(Format::argumentCount(F::str()) == sizeof...(Args), "wrong number of arguments for format string");
+            Output out(sink);
+            emit<F, 0>(out, args...);
+            out.flush();
+            return out.count();
+        }
+        
+        template<typename F, typename... Args, typename = Format::EnableIfFormat<F>>
+        static int32_t format(Printer printer, F f, const Args&... args)
+        {
+            PrinterSink sink(printer);
+            return format(sink, f, args...);
+        }
 
+        // Float with a precision of -1 prints the shortest form, to
+        // DecimalExponent places for fixed point types
         static uint32_t printString(Printer, Float v, int32_t precision = -1, Capital = Capital::No);
         static uint32_t printString(Printer, uint64_t v, uint8_t base = 10, Capital = Capital::No);
         
@@ -81,11 +199,11 @@ namespace bare {
         static uint32_t printString(Printer printer, int16_t v) { return printString(printer, static_cast<int32_t>(v)); }
         static uint32_t printString(Printer printer, uint16_t v, uint8_t base = 10, Capital cap = Capital::No) { return printString(printer, static_cast<uint32_t>(v), base, cap); }
 
-        static uint32_t toString(char* buf, Float v) { return printString([&buf](char c) { *buf++ = c; }, v); }
-        static uint32_t toString(char* buf, int32_t v) { return printString([&buf](char c) { *buf++ = c; }, v); }
-        static uint32_t toString(char* buf, uint32_t v, uint8_t base = 10, Capital cap = Capital::No) { return printString([&buf](char c) { *buf++ = c; }, v, base, cap); }
-        static uint32_t toString(char* buf, int64_t v) { return printString([&buf](char c) { *buf++ = c; }, v); }
-        static uint32_t toString(char* buf, uint64_t v, uint8_t base = 10, Capital cap = Capital::No) { return printString([&buf](char c) { *buf++ = c; }, v, base, cap); }
+        static uint32_t toString(char* buf, Float v) { return floatToString(buf, v, -1, 0, 'g'); }
+        static uint32_t toString(char* buf, int32_t v) { return toString(buf, static_cast<int64_t>(v)); }
+        static uint32_t toString(char* buf, uint32_t v, uint8_t base = 10, Capital cap = Capital::No) { return toString(buf, static_cast<uint64_t>(v), base, cap); }
+        static uint32_t toString(char* buf, int64_t v);
+        static uint32_t toString(char* buf, uint64_t v, uint8_t base = 10, Capital cap = Capital::No);
         static uint32_t toString(char* buf, int8_t v) { return toString(buf, static_cast<int32_t>(v)); }
         static uint32_t toString(char* buf, uint8_t v, uint8_t base = 10, Capital cap = Capital::No) { return toString(buf, static_cast<uint32_t>(v), base, cap); }
         static uint32_t toString(char* buf, int16_t v) { return toString(buf, static_cast<int32_t>(v)); }
@@ -94,6 +212,152 @@ namespace bare {
         static bool toNumber(const char*& s, uint32_t& n);
         
     private:
+        enum class Signed { Yes, No };
+        
+        // Output
+        //
+        // Collects formatted output in a stack buffer and passes it to the
+        // sink a run at a time. Runs too big for the buffer go straight
+        // through.
+        class Output
+        {
+        public:
+            Output(Sink& sink) : _sink(sink) { }
+            ~Output() { flush(); }
+            
+            void put(char c)
+            {
+                if (_size == BufferSize) {
+                    flush();
+                }
+                _buffer[_size++] = c;
+                _count++;
+            }
+            
+            void write(const char* s, size_t n)
+            {
+                _count += n;
+                if (n > BufferSize - _size) {
+                    flush();
+                    if (n >= BufferSize) {
+                        _sink.write(s, n);
+                        return;
+                    }
+                }
+                memcpy(_buffer + _size, s, n);
+                _size += n;
+            }
+            
+            void fill(char c, int32_t n)
+            {
+                while (n-- > 0) {
+                    put(c);
+                }
+            }
+            
+            // Write a literal, turning "%%" into '%'
+            void writeEscaped(const char* s, size_t n)
+            {
+                for (const char* end = s + n; s < end; ++s) {
+                    put(*s);
+                    if (*s == '%') {
+                        ++s;
+                    }
+                }
+            }
+            
+            void flush()
+            {
+                if (_size) {
+                    _sink.write(_buffer, _size);
+                    _size = 0;
+                }
+            }
+            
+            int32_t count() const { return static_cast<int32_t>(_count); }
+            
+        private:
+            static constexpr size_t BufferSize = 64;
+            
+            Sink& _sink;
+            char _buffer[BufferSize];
+            size_t _size = 0;
+            size_t _count = 0;
+        };
+        
+        // Field output, shared by vformat and the FMT() formatters
+        static void outInteger(Output&, uintmax_t value, Signed, int32_t width, int32_t precision, uint8_t flags, uint8_t base, Capital);
+        static void outFloat(Output&, Float value, int32_t width, int32_t precision, uint8_t flags, char conversion);
+        static void outString(Output&, const char* s, int32_t width, int32_t precision, uint8_t flags);
+        static void outChar(Output&, char, int32_t width, uint8_t flags);
+        
+        // prefix (a sign or 0x) and s in a field of width. Padded with spaces
+        // before, or after with leftJustify, or zeros between the two with
+        // zeroPad
+        static void outField(Output&, const char* prefix, int32_t prefixSize, const char* s, int32_t size, int32_t width, uint8_t flags);
+        
+        // Float in 'f', 'e' or 'g' form into a MaxFloatBufferSize buffer,
+        // null terminated. Returns the length. Fixed point types are
+        // converted exactly from their binary value and rounded half to
+        // even. Only FloatFloat and FloatDouble use fpconv.
+        static uint32_t floatToString(char* buf, Float v, int32_t precision, uint8_t flags, char conversion);
+        
+        // The vformat parser, for a va_list or stored arguments
+        template<typename Args> static void formatArgs(Output&, const char* format, Args&);
+        
+        template<bool Escapes> static void outLiteral(Output& out, const char* s, size_t n)
+        {
+            if (Escapes) {
+                out.writeEscaped(s, n);
+            } else if (n) {
+                out.write(s, n);
+            }
+        }
+        
+        template<typename F, uint16_t Pos>
+        static void emit(Output& out)
+        {
+            constexpr Format::Spec spec = Format::parse(F::str(), Pos);
+            outLiteral<spec.hasEscapes>(out, F::str() + spec.literalStart, spec.literalLength);
+        }
+        
+        template<typename F, uint16_t Pos, typename T, typename... Rest>
+        static void emit(Output& out, const T& value, const Rest&... rest)
+        {
+            constexpr Format::Spec spec = Format::parse(F::str(), Pos);
+            static_assert(Format::accepts<T>(spec.conversion), "argument type does not match its conversion in format string");
+            outLiteral<spec.hasEscapes>(out, F::str() + spec.literalStart, spec.literalLength);
+            Field<spec.conversion>::out(out, spec, value);
+            emit<F, spec.next>(out, rest...);
+        }
+        
+        // Truncate for the 'h' and 'hh' lengths
+        template<typename T> static T truncate(T v, Format::Length length)
+        {
+            return (length == Format::Length::HH) ? static_cast<T>(static_cast<typename std::conditional<std::is_signed<T>::value, int8_t, uint8_t>::type>(v)) :
+                   (length == Format::Length::H) ? static_cast<T>(static_cast<typename std::conditional<std::is_signed<T>::value, int16_t, uint16_t>::type>(v)) : v;
+        }
+        
+        // Signed decimal
+        template<typename T> static void outSigned(Output& out, const Format::Spec& spec, T v)
+        {
+            using P = decltype(+v);
+            P p = truncate(static_cast<P>(v), spec.length);
+            outInteger(out, static_cast<uintmax_t>(static_cast<intmax_t>(p)), std::is_signed<P>::value ? Signed::Yes : Signed::No,
+                       spec.width, spec.precision, spec.flags, 10, Capital::No);
+        }
+        
+        // Unsigned in any base. Signed values print as their unsigned
+        // equivalent of the same size, like printf.
+        template<typename T> static void outUnsigned(Output& out, const Format::Spec& spec, T v, uint8_t base, Capital cap)
+        {
+            using U = typename std::make_unsigned<decltype(+v)>::type;
+            outInteger(out, static_cast<uintmax_t>(truncate(static_cast<U>(v), spec.length)), Signed::No,
+                       spec.width, spec.precision, spec.flags, base, cap);
+        }
+        
+        template<char C> struct Field;
+        
         Print() { }
         Print(Print&) { }
         Print& operator=(Print& other) { return other; }
@@ -108,4 +372,55 @@ namespace bare {
         }
     };
     
+    template<> struct Print::Field<'d'>
+    {
+        template<typename T> static void out(Output& out, const Format::Spec& spec, T v) { outSigned(out, spec, v); }
+    };
+    
+    template<> struct Print::Field<'i'> : Print::Field<'d'> { };
+    
+    template<> struct Print::Field<'u'>
+    {
+        template<typename T> static void out(Output& out, const Format::Spec& spec, T v) { outUnsigned(out, spec, v, 10, Capital::No); }
+    };
+    
+    template<> struct Print::Field<'o'>
+    {
+        template<typename T> static void out(Output& out, const Format::Spec& spec, T v) { outUnsigned(out, spec, v, 8, Capital::No); }
+    };
+    
+    template<> struct Print::Field<'x'>
+    {
+        template<typename T> static void out(Output& out, const Format::Spec& spec, T v) { outUnsigned(out, spec, v, 16, Capital::No); }
+    };
+    
+    template<> struct Print::Field<'X'>
+    {
+        template<typename T> static void out(Output& out, const Format::Spec& spec, T v) { outUnsigned(out, spec, v, 16, Capital::Yes); }
+    };
+    
+    template<> struct Print::Field<'c'>
+    {
+        template<typename T> static void out(Output& out, const Format::Spec& spec, T v) { outChar(out, static_cast<char>(v), spec.width, spec.flags); }
+    };
+    
+    template<> struct Print::Field<'s'>
+    {
+        static void out(Output& out, const Format::Spec& spec, const char* s) { outString(out, s, spec.width, spec.precision, spec.flags); }
+    };
+    
+    template<> struct Print::Field<'p'>
+    {
+        static void out(Output& out, const Format::Spec& spec, const void* p)
+        {
+            outInteger(out, reinterpret_cast<uintptr_t>(p), Signed::No, spec.width, spec.precision, spec.flags, 16, Capital::No);
+        }
+    };
+    
+    template<char C> struct Print::Field
+    {
+        // f F e E g G
+        static void out(Output& out, const Format::Spec& spec, Float v) { outFloat(out, v, spec.width, spec.precision, spec.flags, C); }
+    };
+
 }
@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "bare/Print.h"
 #include <stdarg.h>
 #include <stdint.h>
 
@@ -64,11 +65,27 @@ namespace bare {
 		
         static int32_t printf(const char* format, ...);
         static int32_t vprintf(const char* format, va_list);
+        
+        // printf with a format string wrapped in FMT(), parsed at compile time
+        template<typename F, typename... Args, typename = Format::EnableIfFormat<F>>
+        static int32_t printf(F format, const Args&... args)
+        {
+            PrintSink sink;
+            return Print::format(sink, format, args...);
+        }
+        
+        // Formatted output is written a run at a time
+        class PrintSink : public Print::Sink
+        {
+        public:
+            virtual void write(const char* s, size_t n) override { Serial::write(s, static_cast<uint32_t>(n)); }
+        };
 
 		// Blocking API
 		static Error read(uint8_t&);
         static bool rxReady();
 		static Error write(uint8_t);
+		static Error write(const char*, uint32_t size);
 		static Error puts(const char*, uint32_t size = 0);
         
         static void clearInput() { rxhead = rxtail = 0; }
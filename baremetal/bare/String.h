@@ -37,6 +37,9 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare.h"
 
+#include "bare/Arena.h"
+#include "bare/Memory.h"
+#include "bare/Print.h"
 #include <cstdint>
 #include <cstring>
 #include <cassert>
@@ -45,12 +48,23 @@ POSSIBILITY OF SUCH DAMAGE.
 
 namespace bare {
 
+    // String
+    //
+    // Strings of up to InlineCapacity - 1 chars are kept in the String
+    // itself. Longer ones normally allocate from the heap. A String
+    // constructed with an Arena allocates from it instead, as do Strings
+    // derived from it with slice() and trim(). Such a String must not
+    // outlive the Arena::Scope it was made in. A copy or a move allocates
+    // from the heap unless it is given an Arena, so it is safe to keep.
+    //
     class String {
     public:
         static constexpr size_t npos = std::numeric_limits<size_t>::max();
+        static constexpr size_t InlineCapacity = 16;
         
-        String() : _size(1), _capacity(0), _data(nullptr) { }
-        String(const char* s, int32_t len = -1) : _size(1), _capacity(0), _data(nullptr)
+        String() { }
+        String(Arena* arena) : _arena(arena) { }
+        String(const char* s, int32_t len = -1, Arena* arena = nullptr) : _arena(arena)
         {
             if (!s) {
                 return;
@@ -66,33 +80,58 @@ namespace bare {
             _data[_size - 1] = '\0';
         }
         
-        String(const String& other) : _data(nullptr)
+        String(const String& other, Arena* arena = nullptr) : _arena(arena)
         {
             *this = other;
         };
         
-        ~String() { delete [ ] _data; };
+        String(String&& other, Arena* arena = nullptr) noexcept : _arena(arena)
+        {
+            *this = std::move(other);
+        }
+        
+        ~String() { freeData(); };
 
+        // Reuses the existing buffer if it is big enough
         String& operator=(const String& other)
         {
-            if (_data) {
-                delete [ ] _data;
+            if (this == &other) {
+                return *this;
+            }
+            if (_capacity < other._size) {
+                freeData();
+                _data = _inline;
+                _capacity = InlineCapacity;
+                _size = 1;
+                ensureCapacity(other._size);
+                if (_capacity < other._size) {
+                    return *this;
+                }
             }
+            memcpy(_data, other._data, other._size);
             _size = other._size;
-            _capacity = other._capacity;
-            if (!other._data) {
-                _data = nullptr;
+            return *this;
+        }
+        
+        // Takes other's buffer if it is allocated the same way as ours.
+        // other is left empty.
+        String& operator=(String&& other) noexcept
+        {
+            if (this == &other) {
                 return *this;
             }
-            
-            _data = new char[_capacity];
-            assert(_data);
-            if (_data) {
-                memcpy(_data, other._data, _size);
+            if (other.isInline() || other._arena != _arena) {
+                *this = static_cast<const String&>(other);
             } else {
-                _capacity = 0;
-                _size = 1;
+                freeData();
+                _data = other._data;
+                _capacity = other._capacity;
+                _size = other._size;
+                other._data = other._inline;
+                other._capacity = InlineCapacity;
             }
+            other._size = 1;
+            other._data[0] = '\0';
             return *this;
         }
         
@@ -102,7 +141,8 @@ namespace bare {
         char& operator[](size_t i) { assert(i >= 0 && i < _size - 1); return _data[i]; };
         size_t size() const { return _size ? (_size - 1) : 0; }
         bool empty() const { return _size <= 1; }
-        void clear() { _size = 1; if (_data) _data[0] = '\0'; }
+        void clear() { _size = 1; _data[0] = '\0'; }
+        void reserve(size_t size) { ensureCapacity(size + 1); }
         String& operator+=(uint8_t c)
         {
             ensureCapacity(_size + 1);
@@ -120,26 +160,31 @@ namespace bare {
             return *this;
         }
         
-        String& operator+=(const char* s)
+        String& operator+=(const char* s) { return append(s, strlen(s)); }
+        
+        // Append len chars of s, which need not be null terminated
+        String& append(const char* s, size_t len)
         {
-            size_t len = strlen(s);
             ensureCapacity(_size + len);
-            memcpy(_data + _size - 1, s, len + 1);
+            memcpy(_data + _size - 1, s, len);
             _size += len;
+            _data[_size - 1] = '\0';
             return *this;
         }
         
         String& operator+=(const String& s) { return *this += s.c_str(); }
         
-        friend String operator +(const String& s1 , const String& s2) { String s = s1; s += s2; return s; }
-        friend String operator +(const String& s1 , const char* s2) { String s = s1; s += s2; return s; }
-        friend String operator +(const char* s1 , const String& s2) { String s = s1; s += s2; return s; }
+        friend String operator +(const String& s1 , const String& s2) { return concat(s1, s1.c_str(), s1.size(), s2.c_str(), s2.size()); }
+        friend String operator +(const String& s1 , const char* s2) { return concat(s1, s1.c_str(), s1.size(), s2, strlen(s2)); }
+        friend String operator +(const char* s1 , const String& s2) { return concat(s2, s1, strlen(s1), s2.c_str(), s2.size()); }
+        friend String operator +(String&& s1 , const String& s2) { s1 += s2; return std::move(s1); }
+        friend String operator +(String&& s1 , const char* s2) { s1 += s2; return std::move(s1); }
         
         bool operator<(const String& other) const { return strcmp(c_str(), other.c_str()) < 0; }
         bool operator==(const String& other) const { return strcmp(c_str(), other.c_str()) == 0; }
         bool operator!=(const String& other) const { return strcmp(c_str(), other.c_str()) != 0; }
 
-        const char* c_str() const { return _data ? _data : ""; }
+        const char* c_str() const { return _data; }
         String& erase(size_t pos, size_t len)
         {
             if (pos >= _size - 1) {
@@ -156,6 +201,26 @@ namespace bare {
         String& printf(const char* format, ...);
         String& vprintf(const char* format, va_list);
         
+        // printf with a format string wrapped in FMT(), parsed at compile time
+        template<typename F, typename... Args, typename = Format::EnableIfFormat<F>>
+        String& printf(F format, const Args&... args)
+        {
+            PrintSink sink(*this);
+            Print::format(sink, format, args...);
+            return *this;
+        }
+        
+        // Formatted output is appended a run at a time
+        class PrintSink : public Print::Sink
+        {
+        public:
+            PrintSink(String& string) : _string(string) { }
+            virtual void write(const char* s, size_t n) override { _string.append(s, n); }
+            
+        private:
+            String& _string;
+        };
+        
         String& erase(size_t pos = 0)
         {
             return erase(pos, _size - pos);
@@ -204,7 +269,7 @@ namespace bare {
             if (start >= end) {
                 return String();
             }
-            return String(_data + start, end - start);
+            return String(_data + start, end - start, _arena);
         }
         
         String slice(int32_t start) const
@@ -214,7 +279,7 @@ namespace bare {
         
         String trim() const
         {
-            if (_size < 2 || !_data) {
+            if (_size < 2) {
                 return String();
             }
             size_t l = _size - 1;
@@ -226,7 +291,7 @@ namespace bare {
                 ++s;
                 --l;
             }
-            return String(s, static_cast<int32_t>(l));
+            return String(s, static_cast<int32_t>(l), _arena);
         }
         
         // If skipEmpty is true, substrings of zero length are not added to the array
@@ -257,33 +322,71 @@ namespace bare {
         bool isMarked() const { return _marked; }
         void setMarked(bool b) { _marked = b; }
         
+        Arena* arena() const { return _arena; }
+        
     private:
+        // Result has the allocator of like, and one allocation
+        static String concat(const String& like, const char* s1, size_t len1, const char* s2, size_t len2)
+        {
+            String s(like._arena);
+            s.ensureCapacity(len1 + len2 + 1);
+            s.append(s1, len1);
+            s.append(s2, len2);
+            return s;
+        }
+        
+        bool isInline() const { return _data == _inline; }
+        
+        char* allocData(size_t size)
+        {
+            return _arena ? reinterpret_cast<char*>(_arena->alloc(size, 1)) : new char[size];
+        }
+        
+        void freeData()
+        {
+            if (isInline()) {
+                return;
+            }
+            if (_arena) {
+                _arena->free(_data, _capacity);
+            } else {
+                delete [ ] _data;
+            }
+        }
+        
         void ensureCapacity(size_t size)
         {
             if (_capacity >= size) {
                 return;
             }
-            _capacity = _capacity ? _capacity * 2 : 1;
-            if (_capacity < size) {
-                _capacity = size;
+            size_t capacity = _capacity * 2;
+            if (capacity < size) {
+                capacity = size;
             }
-            char *newData = new char[_capacity];
+            
+            // An arena string which was the last thing allocated can just
+            // grow. Otherwise the heap may be able to grow it in place.
+            if (!isInline() && (_arena ? _arena->expand(_data, _capacity, capacity) : Memory::expand(_data, capacity))) {
+                _capacity = capacity;
+                return;
+            }
+            
+            char *newData = allocData(capacity);
             assert(newData);
-            if (_data) {
-                if (newData) {
-                    memcpy(newData, _data, _size);
-                } else {
-                    _capacity = 0;
-                    _size = 1;
-                }
-                delete _data;
+            if (!newData) {
+                return;
             }
+            memcpy(newData, _data, _size);
+            freeData();
+            _capacity = capacity;
             _data = newData;
         };
 
-        size_t _size;
-        size_t _capacity;
-        char *_data;
+        size_t _size = 1;
+        size_t _capacity = InlineCapacity;
+        char *_data = _inline;
+        char _inline[InlineCapacity] = { '\0' };
+        Arena* _arena = nullptr;
         bool _marked = true;
     };
 
@@ -291,7 +394,7 @@ namespace bare {
     {
         String s;
         bool first = true;
-        for (auto it : array) {
+        for (const auto& it : array) {
             if (first) {
                 first = false;
             } else {
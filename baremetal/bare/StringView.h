@@ -0,0 +1,191 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare.h"
+
+#include "bare/FixedVector.h"
+#include "bare/Parse.h"
+#include "bare/String.h"
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+namespace bare {
+
+    // StringView
+    //
+    // A run of chars owned by someone else, which need not be null
+    // terminated. Slicing, trimming and splitting make new views into the
+    // same chars without allocating. A view must not outlive the chars it
+    // refers to.
+    //
+    class StringView {
+    public:
+        static constexpr size_t npos = String::npos;
+        
+        constexpr StringView() { }
+        constexpr StringView(const char* s, size_t size) : _data(s), _size(size) { }
+        StringView(const char* s) : _data(s), _size(s ? strlen(s) : 0) { }
+        StringView(const String& s) : _data(s.c_str()), _size(s.size()) { }
+        
+        const char* data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        
+        char operator[](size_t i) const { assert(i < _size); return _data[i]; }
+        const char* begin() const { return _data; }
+        const char* end() const { return _data + _size; }
+        
+        bool operator==(const StringView& other) const
+        {
+            return _size == other._size && memcmp(_data, other._data, _size) == 0;
+        }
+        bool operator!=(const StringView& other) const { return !(*this == other); }
+        bool operator==(const char* s) const { return *this == StringView(s); }
+        bool operator!=(const char* s) const { return !(*this == StringView(s)); }
+        
+        // Decimal value of the leading digits, 0 if there are none. Clamps
+        // on overflow
+        explicit operator uint32_t() const
+        {
+            uint32_t n;
+            parse(_data, _data + _size, n);
+            return n;
+        }
+        
+        String toString(Arena* arena = nullptr) const { return String(_data, static_cast<int32_t>(_size), arena); }
+        
+        size_t find(char c, size_t pos = 0) const
+        {
+            for (size_t i = pos; i < _size; ++i) {
+                if (_data[i] == c) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+        
+        size_t find(const StringView& s, size_t pos = 0) const
+        {
+            if (s._size == 1) {
+                return find(s._data[0], pos);
+            }
+            for (size_t i = pos; i + s._size <= _size; ++i) {
+                if (memcmp(_data + i, s._data, s._size) == 0) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+        
+        // Same rules as String::slice
+        StringView slice(int32_t start, int32_t end) const
+        {
+            int32_t sz = static_cast<int32_t>(_size);
+            if (start < 0) {
+                start = sz + start;
+            }
+            if (end < 0) {
+                end = sz + end;
+            }
+            if (end > sz) {
+                end = sz;
+            }
+            if (start >= end) {
+                return StringView();
+            }
+            return StringView(_data + start, end - start);
+        }
+        
+        StringView slice(int32_t start) const { return slice(start, static_cast<int32_t>(_size)); }
+        
+        StringView trim() const
+        {
+            const char* s = _data;
+            const char* e = _data + _size;
+            while (s < e && isSpace(*s)) {
+                ++s;
+            }
+            while (e > s && isSpace(e[-1])) {
+                --e;
+            }
+            return StringView(s, e - s);
+        }
+        
+        // Add views of the pieces between separators to array, which can be
+        // a FixedVector or a std::vector. If skipEmpty is true, pieces of
+        // zero length are not added. Returns false if a FixedVector filled
+        // before all the pieces were added.
+        template<typename Array>
+        bool split(Array& array, const StringView& separator, bool skipEmpty = false) const
+        {
+            if (!_size) {
+                return true;
+            }
+            
+            size_t offset = 0;
+            while (1) {
+                size_t n = separator.empty() ? npos : find(separator, offset);
+                bool found = n != npos;
+                size_t length = (found ? n : _size) - offset;
+                if ((length || !skipEmpty) && !push(array, StringView(_data + offset, length))) {
+                    return false;
+                }
+                
+                if (!found) {
+                    return true;
+                }
+                offset = n + separator.size();
+            }
+        }
+        
+    private:
+        template<typename Array>
+        static bool push(Array& array, const StringView& s)
+        {
+            array.push_back(s);
+            return true;
+        }
+        
+        template<typename T, size_t Capacity>
+        static bool push(FixedVector<T, Capacity>& array, const StringView& s) { return array.push_back(s); }
+        
+        const char* _data = "";
+        size_t _size = 0;
+    };
+
+}
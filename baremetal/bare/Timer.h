@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "bare/FixedVector.h"
 #include <stdint.h>
 
 namespace bare {
@@ -45,8 +46,14 @@ namespace bare {
 	//
 	//		https://github.com/dwelch67/raspberrypi
 	//
-	// This is a static class and cannot be instantiated. Starting a new
-	// timer will cancel the current one
+	// Subclass it and start() an instance to have handleTimerEvent called
+	// from the interrupt handler after a delay. Running timers are kept in
+	// a min-heap of absolute deadlines in systemTime() microseconds. The
+	// hardware timer is programmed as a one-shot for the nearest one, and
+	// again whenever that changes or it fires. A repeating timer's next
+	// deadline is its last one plus the period, so it doesn't drift however
+	// late the interrupt is handled. If it falls a whole period behind, the
+	// missed events are skipped.
 	//
  
     // Calendar date/time
@@ -76,18 +83,48 @@ namespace bare {
     };
     
 	class Timer {
-	public:        
+	public:
+        static constexpr uint32_t MaxTimers = 16;
+        
         Timer() { }
-        virtual ~Timer() { }
+        virtual ~Timer() { stop(this); }
         
         virtual void handleTimerEvent() = 0;
         
         static void init();
 
-        // FIXME: repeat is currently not implemented 
-        static void start(Timer*, uint32_t us, bool repeat);
+        // Calls handleTimerEvent in us, and every us after that if repeat.
+        // Starting a running timer restarts it. Returns false if MaxTimers
+        // are running or there are no interrupts
+        static bool start(Timer*, uint32_t us, bool repeat);
         static void stop(Timer*);
+        
+        bool running() const { return _index != NotRunning; }
+        
+        // What the timers run on instead of the hardware, for testing. clock
+        // replaces systemTime() for deadlines and usleep, interrupts replaces
+        // interruptsSupported() and idle replaces the WFE in usleep. While
+        // Hooks are set the hardware timer is off, and whoever advances the
+        // clock calls fireDue(). Pass nullptr to go back to the hardware
+        struct Hooks
+        {
+            int64_t (*clock)();
+            bool interrupts;
+            void (*idle)();
+        };
+        
+        static void setHooks(const Hooks*);
+        
+        // Calls handleTimerEvent for each timer which is due, as the timer
+        // interrupt does
+        static void fireDue();
 
+        // Sleeps shorter than this spin rather than wait for an interrupt
+        static constexpr uint32_t MinIdleSleep = 100;
+        
+        // Waits with WFE for a one-shot timer at the deadline, so timers
+        // and other interrupts are handled meanwhile. Spins when the sleep
+        // is short, in an interrupt handler or there are no interrupts
         static void usleep(uint32_t us);
         static int64_t systemTime();
         static RealTime currentTime();
@@ -96,14 +133,35 @@ namespace bare {
         static void handleInterrupt();
 
 	private:
+        static constexpr uint32_t NotRunning = 0xffffffff;
+        
+        // systemTime(), interruptsSupported() and WFE(), or the hooks
+        static int64_t now();
+        static bool interrupts();
+        static void idle();
+        
+        // Program the hardware for the deadline at the top of the heap, or
+        // turn it off if there isn't one. Called with IRQs masked
         static void updateTimers();
         
-        Timer* _next = nullptr;
-        uint32_t _timeout = 0;
-        bool _repeat = false;
+        // Call handleTimerEvent for each timer due at now, rescheduling the
+        // repeating ones. Called from handleInterrupt and fireDue
+        static void fireTimers(int64_t now);
+        
+        // Heap operations
+        static void insert(Timer*);
+        static void remove(uint32_t index);
+        static void siftUp(uint32_t index);
+        static void siftDown(uint32_t index);
+        static void place(Timer*, uint32_t index);
+        
+        int64_t _deadline = 0;
+        uint32_t _period = 0;
+        uint32_t _index = NotRunning;
 
         static int64_t _epochOffset;
-        static Timer* _head;
+        static FixedVector<Timer*, MaxTimers> _heap;
+        static const Hooks* _hooks;
 	};
 	
 }
@@ -0,0 +1,139 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare/Print.h"
+#include "bare/Timer.h"
+
+// Scoped trace events
+//
+// TRACE_SCOPE("fat.find") at the top of a block records when the block
+// was entered and left. Events go into a fixed ring which keeps the most
+// recent Capacity of them, and Trace::dump writes the ring as Chrome trace
+// JSON, which chrome://tracing or Perfetto will load. Names must be string
+// literals, since only the pointer is stored, and don't need escaping.
+//
+// Recording is on from boot. Defining DISABLE_TRACE compiles the scopes
+// out, as the FLOATNONE (bootloader) build does, since it has no room for
+// the ring. Scopes aren't meant for interrupt handlers.
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+#if defined(DISABLE_TRACE)
+    #define TRACE_SCOPE(name) do { } while (0)
+#else
+    #define TRACE_SCOPE(name) bare::TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+#endif
+
+namespace bare {
+
+    class Trace
+    {
+    public:
+        static constexpr uint32_t Capacity = 512;
+        
+        // begin is in microseconds from the base, which clear() sets, so
+        // it wraps about 71 minutes after that
+        struct Event
+        {
+            const char* name;
+            uint32_t begin;
+            uint32_t duration;
+        };
+        
+        static void start() { _recording = true; }
+        static void stop() { _recording = false; }
+        static bool recording() { return _recording; }
+        
+        static void clear()
+        {
+            _count = 0;
+            _base = Timer::systemTime();
+        }
+        
+        // Events in the ring, and those overwritten by newer ones
+        static uint32_t count() { return (_count < Capacity) ? _count : Capacity; }
+        static uint32_t dropped() { return (_count < Capacity) ? 0 : _count - Capacity; }
+        
+        static void record(const char* name, int64_t begin, int64_t end)
+        {
+            // A scope which began before clear() has no place in the ring
+            if (!_recording || begin < _base) {
+                return;
+            }
+            Event& event = _events[_count++ % Capacity];
+            event.name = name;
+            event.begin = static_cast<uint32_t>(begin - _base);
+            event.duration = static_cast<uint32_t>(end - begin);
+        }
+        
+        // Write the events, oldest first, as a Chrome trace JSON object
+        static void dump(Print::Sink&);
+        
+    private:
+        static bool _recording;
+        static uint32_t _count;
+        static int64_t _base;
+        static Event _events[Capacity];
+    };
+    
+    // TraceScope
+    //
+    // Records an event covering its lifetime. Use TRACE_SCOPE
+    class TraceScope
+    {
+    public:
+        TraceScope(const char* name)
+            : _name(name)
+            , _begin(Timer::systemTime())
+        {
+        }
+        
+        ~TraceScope()
+        {
+            Trace::record(_name, _begin, Timer::systemTime());
+        }
+        
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+        
+    private:
+        const char* _name;
+        int64_t _begin;
+    };
+    
+}
@@ -0,0 +1,328 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "AllocTrace.h"
+
+#include "Allocator.h"
+#include "DLMalloc.h"
+#include "FileSystem.h"
+#include "bare/Memory.h"
+#include "bare/Timer.h"
+
+using namespace placid;
+
+bool AllocTrace::_recording = false;
+bool AllocTrace::_overflowed = false;
+AllocTrace::Event* AllocTrace::_events = nullptr;
+uint32_t AllocTrace::_capacity = 0;
+uint32_t AllocTrace::_count = 0;
+
+// Trace files are a header followed by count Events, all little endian
+struct TraceHeader
+{
+    static constexpr uint32_t Magic = 0x52544150; // "PATR"
+    static constexpr uint32_t Version = 1;
+    
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+};
+
+bool AllocTrace::start(uint32_t capacity)
+{
+    _recording = false;
+    if (capacity != _capacity) {
+        delete [ ] _events;
+        _events = new Event[capacity];
+        _capacity = _events ? capacity : 0;
+    }
+    _count = 0;
+    _overflowed = false;
+    _recording = _events != nullptr;
+    return _recording;
+}
+
+bare::Volume::Error AllocTrace::save(const char* filename)
+{
+    stop();
+    
+    File* fp = FileSystem::sharedFileSystem()->open(filename, FileSystem::OpenMode::Write);
+    bare::Volume::Error error = fp->error();
+    if (fp->valid()) {
+        TraceHeader header = { TraceHeader::Magic, TraceHeader::Version, _count };
+        uint32_t eventBytes = _count * sizeof(Event);
+        if (fp->write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) ||
+                fp->write(reinterpret_cast<const char*>(_events), eventBytes) != static_cast<int32_t>(eventBytes)) {
+            error = bare::Volume::Error::Failed;
+        }
+    }
+    delete fp;
+    return error;
+}
+
+// RegionHeap
+//
+// Hands out pages from a fixed region so the placid Allocator replays
+// under the same memory limit as dlmalloc, without touching the kernel heap
+class RegionHeap : public bare::Memory::Heap
+{
+public:
+    RegionHeap(uint8_t* base, size_t size) : _base(base), _size(size) { }
+    
+    virtual bool mapSegment(size_t size, void*& addr) override
+    {
+        size = (size + bare::Memory::DefaultPageSize - 1) & ~static_cast<size_t>(bare::Memory::DefaultPageSize - 1);
+        if (_used + size > _size) {
+            return false;
+        }
+        addr = _base + _used;
+        _used += size;
+        return true;
+    }
+    
+    virtual int32_t unmapSegment(void* addr, size_t size) override
+    {
+        // Only the most recent segment can be given back
+        if (reinterpret_cast<uint8_t*>(addr) + size == _base + _used) {
+            _used -= size;
+        }
+        return 0;
+    }
+
+private:
+    uint8_t* _base;
+    size_t _size;
+    size_t _used = 0;
+};
+
+class ReplayBackend
+{
+public:
+    virtual ~ReplayBackend() { }
+    virtual void* alloc(size_t) = 0;
+    virtual void free(void*) = 0;
+    virtual size_t footprint() const = 0;
+};
+
+class PlacidBackend : public ReplayBackend
+{
+public:
+    PlacidBackend(uint8_t* base, size_t size) : _heap(base, size), _allocator(&_heap) { }
+    
+    virtual void* alloc(size_t size) override
+    {
+        void* mem;
+        return _allocator.alloc(size, mem) ? mem : nullptr;
+    }
+    
+    virtual void free(void* p) override { _allocator.free(p); }
+    virtual size_t footprint() const override { return _allocator.footprint(); }
+
+private:
+    RegionHeap _heap;
+    Allocator _allocator;
+};
+
+// The mspace is laid over the whole region and may not map more, neither
+// to grow nor for large chunks, since that would come from the kernel heap.
+// It has the region from the start, so its footprint is the part below its
+// top chunk rather than what it has mapped
+class DLMallocBackend : public ReplayBackend
+{
+public:
+    DLMallocBackend(uint8_t* base, size_t size)
+        : _space(create_mspace_with_base(base, size, 0))
+    {
+        if (_space) {
+            mspace_track_large_chunks(_space, 1);
+            mspace_set_footprint_limit(_space, mspace_footprint(_space));
+        }
+    }
+    
+    virtual ~DLMallocBackend()
+    {
+        if (_space) {
+            destroy_mspace(_space);
+        }
+    }
+    
+    virtual void* alloc(size_t size) override { return _space ? mspace_malloc(_space, size) : nullptr; }
+    virtual void free(void* p) override { mspace_free(_space, p); }
+    virtual size_t footprint() const override { return _space ? mspaceExtent(_space) : 0; }
+
+private:
+    void* _space;
+};
+
+// A replay step refers to its allocation by slot rather than address, so
+// the replay loop does no searching
+struct Step
+{
+    uint32_t slot : 31;
+    uint32_t alloc : 1;
+    uint32_t size;
+};
+
+static void toSteps(const std::vector<AllocTrace::Event>& events, std::vector<Step>& steps, uint32_t& slotCount)
+{
+    struct Live { uint32_t addr; uint32_t slot; };
+    std::vector<Live> live;
+    slotCount = 0;
+    
+    for (const auto& event : events) {
+        if (event.op == static_cast<uint32_t>(AllocTrace::Op::Alloc)) {
+            live.push_back({ event.addr, slotCount });
+            steps.push_back({ slotCount++, 1, event.size });
+            continue;
+        }
+        
+        // Frees are usually of recent allocations, so search from the back.
+        // Frees of memory allocated before recording started are dropped.
+        for (auto it = live.end(); it != live.begin(); ) {
+            --it;
+            if (it->addr == event.addr) {
+                steps.push_back({ it->slot, 0, 0 });
+                live.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+// Returns false if the backend failed an allocation, leaving the number of
+// events replayed in result.events. If measure is true, footprint is sampled
+// after each alloc, which is too slow for timing
+static bool run(ReplayBackend& backend, const std::vector<Step>& steps, std::vector<void*>& slots, 
+                bool measure, AllocTrace::Result& result)
+{
+    uint32_t live = 0;
+    std::vector<uint32_t> sizes(measure ? slots.size() : 0);
+    for (const auto& step : steps) {
+        if (step.alloc) {
+            void* mem = backend.alloc(step.size);
+            if (!mem) {
+                result.events = static_cast<uint32_t>(&step - steps.data());
+                return false;
+            }
+            slots[step.slot] = mem;
+            if (measure) {
+                sizes[step.slot] = step.size;
+                live += step.size;
+                if (live > result.peakLive) {
+                    result.peakLive = live;
+                }
+                uint32_t footprint = static_cast<uint32_t>(backend.footprint());
+                if (footprint > result.peakFootprint) {
+                    result.peakFootprint = footprint;
+                }
+            }
+        } else {
+            backend.free(slots[step.slot]);
+            if (measure) {
+                live -= sizes[step.slot];
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Backend>
+static void replayOn(const char* name, const std::vector<Step>& steps, uint32_t slotCount,
+                     const std::function<void(const AllocTrace::Result&)>& handler)
+{
+    AllocTrace::Result result = { name, true, static_cast<uint32_t>(steps.size()), 0, 0, 0 };
+    std::vector<void*> slots(slotCount);
+    uint8_t* region = new uint8_t[AllocTrace::ReplayHeapSize];
+    if (!region) {
+        result.completed = false;
+        handler(result);
+        return;
+    }
+    
+    // Timed pass
+    {
+        Backend backend(region, AllocTrace::ReplayHeapSize);
+        int64_t start = bare::Timer::systemTime();
+        result.completed = run(backend, steps, slots, false, result);
+        result.us = static_cast<uint32_t>(bare::Timer::systemTime() - start);
+    }
+    
+    // Measured pass, on a fresh backend
+    {
+        Backend backend(region, AllocTrace::ReplayHeapSize);
+        run(backend, steps, slots, true, result);
+    }
+    
+    delete [ ] region;
+    handler(result);
+}
+
+bare::Volume::Error AllocTrace::replay(const char* filename, const std::function<void(const Result&)>& handler)
+{
+    stop();
+    
+    File* fp = FileSystem::sharedFileSystem()->open(filename, FileSystem::OpenMode::Read);
+    if (!fp->valid()) {
+        bare::Volume::Error error = fp->error();
+        delete fp;
+        return error;
+    }
+    
+    TraceHeader header;
+    std::vector<Event> events;
+    bool ok = fp->read(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header) &&
+              header.magic == TraceHeader::Magic && header.version == TraceHeader::Version;
+    if (ok) {
+        events.resize(header.count);
+        uint32_t eventBytes = header.count * sizeof(Event);
+        ok = fp->read(reinterpret_cast<char*>(events.data()), eventBytes) == static_cast<int32_t>(eventBytes);
+    }
+    delete fp;
+    if (!ok) {
+        return bare::Volume::Error::Failed;
+    }
+    
+    std::vector<Step> steps;
+    uint32_t slotCount;
+    toSteps(events, steps, slotCount);
+    events.clear();
+    events.shrink_to_fit();
+    
+    replayOn<PlacidBackend>("placid", steps, slotCount, handler);
+    replayOn<DLMallocBackend>("dlmalloc", steps, slotCount, handler);
+    return bare::Volume::Error::OK;
+}
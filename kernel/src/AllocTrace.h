@@ -0,0 +1,122 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare/Volume.h"
+#include <functional>
+#include <vector>
+
+namespace placid {
+
+    // AllocTrace - Record and replay kernel heap traffic
+    //
+    // While recording, operator new and delete append an event to a buffer
+    // allocated by start(). Recording stops when the buffer fills. A trace
+    // can be saved to the SD card and replayed later, on the device or in
+    // the host build, against each heap backend. Replay maps every backend
+    // onto a private region of the same size, so the results are comparable:
+    //
+    //      ops/s           events replayed per second
+    //      peak live       most bytes the trace had allocated at once
+    //      peak footprint  most bytes of its region the backend had reached
+    //      fragmentation   share of peak footprint not holding live data
+    //
+    // Addresses are stored as 32 bits so a trace recorded on the device
+    // replays on a 64 bit host. They are only used to pair frees with allocs.
+    class AllocTrace
+    {
+    public:
+        static constexpr uint32_t DefaultCapacity = 4096;
+        static constexpr uint32_t ReplayHeapSize = 128 * 1024;
+        
+        enum class Op : uint8_t { Alloc = 'a', Free = 'f' };
+        
+        struct Event
+        {
+            uint32_t op;
+            uint32_t addr;
+            uint32_t size;
+        };
+        
+        struct Result
+        {
+            const char* backend;
+            bool completed; // false if the backend ran out of region
+            uint32_t events; // replayed, up to the failure if not completed
+            uint32_t us;
+            uint32_t peakLive;
+            uint32_t peakFootprint;
+        };
+        
+        static bool start(uint32_t capacity = DefaultCapacity);
+        static void stop() { _recording = false; }
+        
+        static bool recording() { return _recording; }
+        static uint32_t count() { return _count; }
+        static bool overflowed() { return _overflowed; }
+        
+        static void record(Op op, void* addr, size_t size)
+        {
+            if (!addr) {
+                return;
+            }
+            if (_count >= _capacity) {
+                _overflowed = true;
+                _recording = false;
+                return;
+            }
+            Event& event = _events[_count++];
+            event.op = static_cast<uint32_t>(op);
+            event.addr = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(addr));
+            event.size = static_cast<uint32_t>(size);
+        }
+        
+        // Stops recording and writes the trace to a new file
+        static bare::Volume::Error save(const char* filename);
+        
+        // Replays the trace in filename against each backend, calling the
+        // passed function with the result for each one
+        static bare::Volume::Error replay(const char* filename, const std::function<void(const Result&)>&);
+        
+    private:
+        static bool _recording;
+        static bool _overflowed;
+        static Event* _events;
+        static uint32_t _capacity;
+        static uint32_t _count;
+    };
+    
+}
@@ -37,6 +37,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "Allocator.h"
 
+#include "AllocTrace.h"
+#include "DLMalloc.h"
 #include "bare/Memory.h"
 
 //#define ENABLE_DEBUG_LOG
@@ -61,8 +63,13 @@ static inline bool checkFreeList(Allocator::FreeChunk* list)
 
 Allocator Allocator::_kernelAllocator;
 
-Allocator::Allocator()
+bool Allocator::mapSegment(size_t size, void*& segment)
 {
+    if (!(_heap ? _heap->mapSegment(size, segment) : bare::Memory::mapSegment(size, segment))) {
+        return false;
+    }
+    _footprint += size;
+    return true;
 }
 
 void Allocator::removeFromFreeList(FreeChunk* chunk)
@@ -109,13 +116,8 @@ void Allocator::addToFreeList(void* mem, size_t size)
 
 bool Allocator::alloc(size_t size, void*& mem)
 {
-    if (!bare::SystemIsInited) {
-        mem = ::malloc(size);
-        return mem;
-    }
-
     DEBUG_LOG("Allocator::alloc: enter, size=%d, SystemIsInited=%s\n", static_cast<uint32_t>(size), bare::SystemIsInited ? "true" : "false");
-    size = (size + sizeof(Chunk) + MinAllocSize - 1) / MinAllocSize * MinAllocSize;
+    size = chunkSize(size);
     
     // Try to find a block in the free list
     FreeChunk* entry = _freeList;
@@ -132,6 +134,7 @@ bool Allocator::alloc(size_t size, void*& mem)
         if (size + MinSplitSize > entry->size()) {
             DEBUG_LOG("Allocator::alloc: using entire free chunk\n");
             removeFromFreeList(entry);
+            size = entry->size();
         } else {
             DEBUG_LOG("Allocator::alloc: splitting free chunk\n");
             splitFreeBlock(entry, size);
@@ -141,21 +144,28 @@ bool Allocator::alloc(size_t size, void*& mem)
 
         // No free entry found, alloc a new block
         // Allocate as much as needed, in multiples of BlockSize
-        size_t sizeToAlloc = (size + BlockSize - 1) / BlockSize * BlockSize;
+        size_t sizeToAlloc = (size + sizeof(Chunk) + BlockSize - 1) / BlockSize * BlockSize;
         void* newSegment;
-        if (!bare::Memory::mapSegment(sizeToAlloc, newSegment)) {
+        if (!mapSegment(sizeToAlloc, newSegment)) {
             ERROR_LOG("Allocator::alloc: failed to allocate segment of size %d\n", sizeToAlloc);
             return false;
         }
         
+        // The last word of the segment is a zero sized, in use fencepost
+        // chunk. So there is always a valid header after any chunk, which
+        // tryExpand relies on.
+        size_t segmentSize = sizeToAlloc - sizeof(Chunk);
+        Chunk* fencepost = reinterpret_cast<Chunk*>(reinterpret_cast<uint8_t*>(newSegment) + segmentSize);
+        fencepost->setSize(0);
+        fencepost->setStatus(Chunk::Status::InUse);
+        
         entry = reinterpret_cast<FreeChunk*>(newSegment);
-        size_t newSize = BlockSize;
-        if (size + MinSplitSize < BlockSize) {
+        if (size + MinSplitSize < segmentSize) {
             DEBUG_LOG("Allocator::alloc: splitting newly allocated segment\n");
-            addToFreeList(reinterpret_cast<uint8_t*>(entry) + size, sizeToAlloc - size);
+            addToFreeList(reinterpret_cast<uint8_t*>(entry) + size, segmentSize - size);
         } else {
             DEBUG_LOG("Allocator::alloc: using entire newly allocated segment\n");
-            size = newSize;
+            size = segmentSize;
         }
     }
            
@@ -171,11 +181,10 @@ bool Allocator::alloc(size_t size, void*& mem)
 
 void Allocator::free(void *addr)
 {
-    if (!bare::SystemIsInited) {
-        ::free(addr);
+    if (!addr) {
         return;
     }
-
+    
     DEBUG_LOG("Allocator::free: enter, addr=0x%08p\n", addr);
     Chunk* chunk = reinterpret_cast<Chunk*>(addr) - 1;
     addToFreeList(chunk, chunk->size());
@@ -183,35 +192,205 @@ void Allocator::free(void *addr)
     DEBUG_LOG("Allocator::free: exit, size=%d\n", chunk->size());
 }
 
-void *operator new(size_t size)
+bool Allocator::allocAligned(size_t size, size_t alignment, void*& mem)
 {
-    void* mem;
-    void* result = Allocator::kernelAllocator().alloc(size, mem) ? mem : nullptr;
-    return result;
+    assert((alignment & (alignment - 1)) == 0);
+    if (alignment <= sizeof(Chunk)) {
+        return alloc(size, mem);
+    }
+    
+    // Allocate enough extra that the part before the aligned address can
+    // always be made into a free chunk
+    void* raw;
+    if (!alloc(size + alignment + MinSplitSize, raw)) {
+        return false;
+    }
+    
+    uintptr_t addr = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (addr + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    while (aligned != addr && aligned - addr < MinSplitSize) {
+        aligned += alignment;
+    }
+    
+    Chunk* chunk = reinterpret_cast<Chunk*>(raw) - 1;
+    if (aligned != addr) {
+        size_t lead = aligned - addr;
+        Chunk* alignedChunk = reinterpret_cast<Chunk*>(aligned) - 1;
+        alignedChunk->setStatus(Chunk::Status::InUse);
+        alignedChunk->setSize(chunk->size() - lead);
+        addToFreeList(chunk, lead);
+        _size -= lead;
+        chunk = alignedChunk;
+    }
+    
+    size_t needed = chunkSize(size);
+    if (needed + MinSplitSize <= chunk->size()) {
+        addToFreeList(reinterpret_cast<uint8_t*>(chunk) + needed, chunk->size() - needed);
+        _size -= chunk->size() - needed;
+        chunk->setSize(needed);
+    }
+    
+    mem = reinterpret_cast<void*>(aligned);
+    return true;
 }
 
-void *operator new[] (size_t size)
+bool Allocator::tryExpand(void* addr, size_t size)
+{
+    if (!addr) {
+        return false;
+    }
+    
+    Chunk* chunk = reinterpret_cast<Chunk*>(addr) - 1;
+    size = chunkSize(size);
+    size_t available = chunk->size();
+    if (available >= size) {
+        return true;
+    }
+    
+    // Free chunks are not coalesced, so there may be several in a row
+    // after this one. The fencepost stops us at the end of the segment.
+    uint8_t* end = reinterpret_cast<uint8_t*>(chunk) + available;
+    for (Chunk* next = reinterpret_cast<Chunk*>(end); available < size; next = reinterpret_cast<Chunk*>(end)) {
+        if (next->status() != Chunk::Status::Free) {
+            return false;
+        }
+        available += next->size();
+        end += next->size();
+    }
+    
+    DEBUG_LOG("Allocator::tryExpand: expanding chunk from %d to %d\n", chunk->size(), size);
+    for (uint8_t* p = reinterpret_cast<uint8_t*>(chunk) + chunk->size(); p < end; ) {
+        FreeChunk* next = reinterpret_cast<FreeChunk*>(p);
+        p += next->size();
+        removeFromFreeList(next);
+    }
+    
+    _size -= chunk->size();
+    if (size + MinSplitSize <= available) {
+        addToFreeList(reinterpret_cast<uint8_t*>(chunk) + size, available - size);
+    } else {
+        size = available;
+    }
+    chunk->setSize(size);
+    _size += size;
+    return true;
+}
+
+bool Allocator::realloc(void* addr, size_t size, void*& mem)
+{
+    if (!addr) {
+        return alloc(size, mem);
+    }
+    
+    if (tryExpand(addr, size)) {
+        mem = addr;
+        return true;
+    }
+    
+    if (!alloc(size, mem)) {
+        return false;
+    }
+    
+    size_t oldSize = (reinterpret_cast<Chunk*>(addr) - 1)->size() - sizeof(Chunk);
+    bare::memcpy(mem, addr, oldSize < size ? oldSize : size);
+    free(addr);
+    return true;
+}
+
+#if defined(ALLOCATOR_DLMALLOC)
+static inline void* kernelAlloc(size_t size)
+{
+    return dlmalloc(size);
+}
+
+static inline void kernelFree(void* p)
+{
+    dlfree(p);
+}
+
+const char* placid::kernelHeapName() { return "dlmalloc"; }
+size_t placid::kernelHeapFootprint() { return dlmalloc_footprint(); }
+bool placid::kernelHeapExpand(void* addr, size_t size) { return dlrealloc_in_place(addr, size); }
+
+static inline void* kernelAllocAligned(size_t size, size_t alignment)
+{
+    return dlmemalign(alignment, size);
+}
+#else
+static inline void* kernelAlloc(size_t size)
 {
     void* mem;
     return Allocator::kernelAllocator().alloc(size, mem) ? mem : nullptr;
 }
 
-void operator delete(void *p) noexcept
+static inline void kernelFree(void* p)
 {
     Allocator::kernelAllocator().free(p);
 }
 
+const char* placid::kernelHeapName() { return "placid"; }
+size_t placid::kernelHeapFootprint() { return Allocator::kernelAllocator().footprint(); }
+bool placid::kernelHeapExpand(void* addr, size_t size) { return Allocator::kernelAllocator().tryExpand(addr, size); }
+
+static inline void* kernelAllocAligned(size_t size, size_t alignment)
+{
+    void* mem;
+    return Allocator::kernelAllocator().allocAligned(size, alignment, mem) ? mem : nullptr;
+}
+#endif
+
+static inline void* tracedAlloc(size_t size)
+{
+    void* mem = kernelAlloc(size);
+    if (AllocTrace::recording()) {
+        AllocTrace::record(AllocTrace::Op::Alloc, mem, size);
+    }
+    return mem;
+}
+
+void* placid::kernelHeapAllocAligned(size_t size, size_t alignment)
+{
+    void* mem = kernelAllocAligned(size, alignment);
+    if (AllocTrace::recording()) {
+        AllocTrace::record(AllocTrace::Op::Alloc, mem, size);
+    }
+    return mem;
+}
+
+static inline void tracedFree(void* p)
+{
+    if (AllocTrace::recording()) {
+        AllocTrace::record(AllocTrace::Op::Free, p, 0);
+    }
+    kernelFree(p);
+}
+
+void *operator new(size_t size)
+{
+    return tracedAlloc(size);
+}
+
+void *operator new[] (size_t size)
+{
+    return tracedAlloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    tracedFree(p);
+}
+
 void operator delete [ ](void *p) noexcept
 {
-    Allocator::kernelAllocator().free(p);
+    tracedFree(p);
 }
 
 void operator delete(void *p, size_t size) noexcept
 {
-    Allocator::kernelAllocator().free(p);
+    tracedFree(p);
 }
 
 void operator delete [ ](void *p, size_t size) noexcept
 {
-    Allocator::kernelAllocator().free(p);
+    tracedFree(p);
 }
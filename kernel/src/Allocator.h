@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "bare/Memory.h"
 #include <cassert>
 
 namespace placid {
@@ -84,12 +85,31 @@ namespace placid {
     class Allocator
     {
     public:
-        Allocator();
+        // Segments are mapped from the given heap, or from the kernel heap
+        // if it is nullptr. This is constexpr so the kernel allocator is
+        // ready before any static constructor can call operator new.
+        constexpr Allocator(bare::Memory::Heap* heap = nullptr) : _heap(heap) { }
         
         bool alloc(size_t size, void*&);
         void free(void *);
         
+        // Allocate with the returned address a multiple of alignment, which
+        // must be a power of 2. The slack before and after the aligned chunk
+        // goes back on the free list, and free() works as usual.
+        bool allocAligned(size_t size, size_t alignment, void*&);
+        
+        // Grow the allocation at addr to at least size bytes without moving
+        // it, by absorbing free chunks that follow it. Returns false if there
+        // isn't room, in which case the allocation is unchanged.
+        bool tryExpand(void* addr, size_t size);
+        
+        // Resize the allocation at addr, in place if possible, otherwise by
+        // allocating, copying and freeing. On failure addr is still valid.
+        bool realloc(void* addr, size_t size, void*&);
+        
+        // Bytes in use and bytes mapped from the heap
         uint32_t size() const { return _size; }
+        uint32_t footprint() const { return _footprint; }
         
         static Allocator& kernelAllocator() { return _kernelAllocator; }
 
@@ -123,15 +143,95 @@ namespace placid {
         static_assert(sizeof(FreeChunk) < MinSplitSize, "MinSplitSize too small");
 
     private:
+        static size_t chunkSize(size_t size)
+        {
+            return (size + sizeof(Chunk) + MinAllocSize - 1) / MinAllocSize * MinAllocSize;
+        }
+        
+        bool mapSegment(size_t size, void*&);
         void removeFromFreeList(FreeChunk*);
         void splitFreeBlock(FreeChunk*, size_t size);
         void addToFreeList(void*, size_t size);
         
         FreeChunk* _freeList = nullptr;
+        bare::Memory::Heap* _heap = nullptr;
         
         static Allocator _kernelAllocator;
         
         uint32_t _size = 0;
+        uint32_t _footprint = 0;
+    };
+    
+    // Kernel heap
+    //
+    // operator new and delete are served by the kernel Allocator, or by
+    // dlmalloc if the kernel is built with ALLOCATOR=dlmalloc (see
+    // kernel/Makefile). These describe whichever one is in use.
+    const char* kernelHeapName();
+    size_t kernelHeapFootprint();
+    bool kernelHeapExpand(void* addr, size_t size);
+    
+    // Aligned allocation from the kernel heap. Free with operator delete.
+    void* kernelHeapAllocAligned(size_t size, size_t alignment);
+    
+    // AlignedBuffer
+    //
+    // A buffer from kernelHeapAllocAligned, freed when it goes out of
+    // scope. For block and DMA buffers which would otherwise have to be
+    // aligned members or statics.
+    class AlignedBuffer
+    {
+    public:
+        static constexpr size_t CacheLineSize = 32;
+        
+        AlignedBuffer() { }
+        AlignedBuffer(size_t size, size_t alignment = CacheLineSize) { allocate(size, alignment); }
+        AlignedBuffer(const AlignedBuffer&) = delete;
+        AlignedBuffer(AlignedBuffer&& other) : _data(other._data), _size(other._size)
+        {
+            other._data = nullptr;
+            other._size = 0;
+        }
+        
+        ~AlignedBuffer() { release(); }
+        
+        AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+        AlignedBuffer& operator=(AlignedBuffer&& other)
+        {
+            if (this != &other) {
+                release();
+                _data = other._data;
+                _size = other._size;
+                other._data = nullptr;
+                other._size = 0;
+            }
+            return *this;
+        }
+        
+        // Replaces any current contents. Returns false if out of memory.
+        bool allocate(size_t size, size_t alignment = CacheLineSize)
+        {
+            release();
+            _data = reinterpret_cast<uint8_t*>(kernelHeapAllocAligned(size, alignment));
+            _size = _data ? size : 0;
+            return _data;
+        }
+        
+        void release()
+        {
+            ::operator delete(_data);
+            _data = nullptr;
+            _size = 0;
+        }
+        
+        uint8_t* data() { return _data; }
+        const uint8_t* data() const { return _data; }
+        size_t size() const { return _size; }
+        bool valid() const { return _data; }
+        
+    private:
+        uint8_t* _data = nullptr;
+        size_t _size = 0;
     };
     
 }
@@ -0,0 +1,119 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "AtomTable.h"
+
+using namespace placid;
+
+constexpr uint32_t AtomTable::EmptySlot;
+
+uint32_t AtomTable::probe(const char* s, uint32_t length, uint32_t h) const
+{
+    uint32_t mask = static_cast<uint32_t>(_slots.size()) - 1;
+    for (uint32_t i = h & mask; ; i = (i + 1) & mask) {
+        uint32_t slot = _slots[i];
+        if (slot == EmptySlot) {
+            return i;
+        }
+        const Entry& entry = _entries[slot - 1];
+        if (entry.hash == h && entry.length == length && bare::memcmp(entry.name, s, length) == 0) {
+            return i;
+        }
+    }
+}
+
+Atom AtomTable::find(const char* s, uint32_t length) const
+{
+    if (_slots.empty()) {
+        return NoAtom;
+    }
+    uint32_t slot = _slots[probe(s, length, bare::hash(s, length))];
+    return (slot == EmptySlot) ? NoAtom : slot - 1;
+}
+
+Atom AtomTable::find(const char* s) const
+{
+    return find(s, static_cast<uint32_t>(bare::strlen(s)));
+}
+
+Atom AtomTable::intern(const char* s, uint32_t length)
+{
+    if ((_entries.size() + 1) * 4 > _slots.size() * 3) {
+        grow();
+    }
+    
+    uint32_t h = bare::hash(s, length);
+    uint32_t index = probe(s, length, h);
+    if (_slots[index] != EmptySlot) {
+        return _slots[index] - 1;
+    }
+    
+    char* name = reinterpret_cast<char*>(_text.alloc(length + 1, 1));
+    bare::memcpy(name, s, length);
+    name[length] = '\0';
+    _entries.push_back({ name, length, h });
+    _slots[index] = static_cast<uint32_t>(_entries.size());
+    return static_cast<Atom>(_entries.size() - 1);
+}
+
+Atom AtomTable::intern(const char* s)
+{
+    return intern(s, static_cast<uint32_t>(bare::strlen(s)));
+}
+
+void AtomTable::clear()
+{
+    _entries.clear();
+    _slots.clear();
+    _text.reset();
+}
+
+// Double the slots and put the atoms back, using the hashes saved in the
+// entries
+void AtomTable::grow()
+{
+    uint32_t size = _slots.empty() ? InitialSlots : static_cast<uint32_t>(_slots.size()) * 2;
+    _slots.assign(size, EmptySlot);
+    uint32_t mask = size - 1;
+    for (uint32_t atom = 0; atom < _entries.size(); ++atom) {
+        uint32_t i = _entries[atom].hash & mask;
+        while (_slots[i] != EmptySlot) {
+            i = (i + 1) & mask;
+        }
+        _slots[i] = atom + 1;
+    }
+}
@@ -0,0 +1,98 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare/Arena.h"
+#include <cstdint>
+#include <vector>
+
+namespace placid {
+
+    // An interned string. Atoms are numbered from 0 in the order they are
+    // interned, so a consumer can keep a side table indexed by atom
+    using Atom = uint32_t;
+    static constexpr Atom NoAtom = 0xffffffff;
+
+    // AtomTable - Hash-consed strings
+    //
+    // Each distinct string is stored once, so two atoms are the same string
+    // exactly when they are the same number. The text lives in an arena and
+    // never moves, so name() stays valid as long as the table. Lookup is an
+    // open addressed FNV-1a hash table of atoms, kept at most 3/4 full.
+    class AtomTable
+    {
+    public:
+        AtomTable() { }
+        
+        AtomTable(const AtomTable&) = delete;
+        AtomTable& operator=(const AtomTable&) = delete;
+        
+        // Returns the atom for s, adding it if it isn't already present
+        Atom intern(const char* s, uint32_t length);
+        Atom intern(const char* s);
+        
+        // Returns the atom for s, or NoAtom if it has never been interned
+        Atom find(const char* s, uint32_t length) const;
+        Atom find(const char* s) const;
+        
+        // Null terminated, but the string may also contain nulls
+        const char* name(Atom atom) const { return _entries[atom].name; }
+        uint32_t length(Atom atom) const { return _entries[atom].length; }
+        
+        uint32_t size() const { return static_cast<uint32_t>(_entries.size()); }
+        void clear();
+        
+    private:
+        static constexpr uint32_t InitialSlots = 64;
+        static constexpr uint32_t EmptySlot = 0;
+        
+        struct Entry
+        {
+            const char* name;
+            uint32_t length;
+            uint32_t hash;
+        };
+        
+        // Index in _slots where s is, or the empty slot where it would go
+        uint32_t probe(const char* s, uint32_t length, uint32_t hash) const;
+        void grow();
+        
+        bare::Arena _text;
+        std::vector<Entry> _entries;
+        std::vector<uint32_t> _slots; // atom + 1, or EmptySlot
+    };
+
+}
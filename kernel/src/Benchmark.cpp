@@ -0,0 +1,735 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "Benchmark.h"
+
+#include "Allocator.h"
+#include "Compiler.h"
+#include "FileSystem.h"
+#include "MStream.h"
+#include "Scanner.h"
+#include "TreeWalker.h"
+#include "VM.h"
+#include "bare/Parse.h"
+#include "bare/Print.h"
+#include "bare/String.h"
+
+using namespace placid;
+
+Benchmark::Registration* Benchmark::_first = nullptr;
+
+Benchmark::Registration::Registration(const char* name, Function function)
+    : name(name)
+    , function(function)
+{
+    Registration** p = &_first;
+    while (*p) {
+        p = &(*p)->next;
+    }
+    *p = this;
+}
+
+uint32_t Benchmark::run(const bare::StringView& pattern, const Reporter& reporter)
+{
+    uint32_t count = 0;
+    for (Registration* r = _first; r; r = r->next) {
+        if (bare::StringView(r->name).find(pattern) == bare::StringView::npos) {
+            continue;
+        }
+        Benchmark benchmark(r->name, reporter);
+        r->function(benchmark);
+        ++count;
+    }
+    return count;
+}
+
+void Benchmark::note(const char* message)
+{
+    bare::String line;
+    line.printf(FMT("%-8s %s"), _name, message);
+    _reporter(line.c_str());
+}
+
+uint32_t Benchmark::report(const char* label, uint64_t bytes, uint32_t* samples)
+{
+    // Few enough to insertion sort
+    for (uint32_t i = 1; i < Samples; ++i) {
+        uint32_t sample = samples[i];
+        uint32_t j = i;
+        for ( ; j > 0 && samples[j - 1] > sample; --j) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = sample;
+    }
+    uint32_t median = samples[Samples / 2];
+    
+    bare::String line;
+    line.printf(FMT("%-8s %-24s min %8dus   median %8dus   max %8dus"), _name, label, samples[0], median, samples[Samples - 1]);
+    if (bytes && median) {
+        // Bytes per microsecond is MB/s
+        uint32_t rate = static_cast<uint32_t>(bytes * 100 / median);
+        line.printf(FMT("   %d.%02d MB/s"), rate / 100, rate % 100);
+    }
+    _reporter(line.c_str());
+    return median;
+}
+
+// The byte at a time versions of the bare.cpp functions, for comparison
+__attribute__((noinline)) static void* byteMemset(void* dst, int value, size_t n)
+{
+    uint8_t* p = reinterpret_cast<uint8_t*>(dst);
+    while (n--) {
+        *p++ = static_cast<uint8_t>(value);
+    }
+    return dst;
+}
+
+__attribute__((noinline)) static void* byteMemcpy(void* dst, const void* src, size_t n)
+{
+    uint8_t* d = reinterpret_cast<uint8_t*>(dst);
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+__attribute__((noinline)) static void* byteMemmove(void* dst, const void* src, size_t n)
+{
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+    uint8_t* d = reinterpret_cast<uint8_t*>(dst);
+    if (s < d && d < s + n) {
+        s += n;
+        d += n;
+        while (n--) {
+            *--d = *--s;
+        }
+        return dst;
+    }
+    return byteMemcpy(dst, src, n);
+}
+
+__attribute__((noinline)) static int byteMemcmp(const void* left, const void* right, size_t n)
+{
+    const uint8_t* s1 = reinterpret_cast<const uint8_t*>(left);
+    const uint8_t* s2 = reinterpret_cast<const uint8_t*>(right);
+    while (n--) {
+        if (*s1 != *s2) {
+            return (*s1 < *s2) ? -1 : 1;
+        }
+        s1++;
+        s2++;
+    }
+    return 0;
+}
+
+__attribute__((noinline)) static size_t byteStrlen(const char* str)
+{
+    const char* s;
+    for (s = str; *s; ++s) { }
+    return s - str;
+}
+
+// Each measurement moves about this many bytes, whatever the size
+static constexpr uint32_t BytesPerRun = 32 * 1024;
+static constexpr uint32_t MaxSize = 4096;
+static constexpr uint32_t Sizes[] = { 8, 32, 128, 512, MaxSize };
+
+// dst and src offsets from a cache line boundary
+static constexpr uint32_t Offsets[][2] = { { 0, 0 }, { 1, 1 }, { 0, 1 }, { 3, 2 } };
+
+// Times the byte loop and the bare.cpp version of a memory function at
+// each size and alignment. The passed function makes the pair of calls
+// for a dst, src and size, given which one to use
+template<typename Func>
+static void memoryBenchmark(Benchmark& benchmark, Func func)
+{
+    // Room for the largest size, its offset and a memmove overlap
+    AlignedBuffer srcBuffer(MaxSize * 2, AlignedBuffer::CacheLineSize);
+    AlignedBuffer dstBuffer(MaxSize * 2, AlignedBuffer::CacheLineSize);
+    if (!srcBuffer.valid() || !dstBuffer.valid()) {
+        benchmark.note("out of memory");
+        return;
+    }
+    
+    for (uint32_t size : Sizes) {
+        for (const auto& offsets : Offsets) {
+            bare::memset(srcBuffer.data(), 'a', srcBuffer.size());
+            bare::memset(dstBuffer.data(), 'a', dstBuffer.size());
+            uint8_t* d = dstBuffer.data() + offsets[0];
+            uint8_t* s = srcBuffer.data() + offsets[1];
+            
+            for (bool word : { false, true }) {
+                bare::String label;
+                label.printf(FMT("%s %d d+%d s+%d"), word ? "word" : "byte", size, offsets[0], offsets[1]);
+                benchmark.measure(label.c_str(), BytesPerRun / size, size, [&] { func(word, d, s, size); });
+            }
+        }
+    }
+}
+
+static void memcpyBenchmark(Benchmark& benchmark)
+{
+    memoryBenchmark(benchmark, [](bool word, uint8_t* d, uint8_t* s, uint32_t size)
+    {
+        word ? bare::memcpy(d, s, size) : byteMemcpy(d, s, size);
+    });
+}
+
+static void memsetBenchmark(Benchmark& benchmark)
+{
+    memoryBenchmark(benchmark, [](bool word, uint8_t* d, uint8_t*, uint32_t size)
+    {
+        word ? bare::memset(d, 'a', size) : byteMemset(d, 'a', size);
+    });
+}
+
+static void memmoveBenchmark(Benchmark& benchmark)
+{
+    // Overlapping, dst above src, which copies backward
+    memoryBenchmark(benchmark, [](bool word, uint8_t*, uint8_t* s, uint32_t size)
+    {
+        uint8_t* overlap = s + size / 2;
+        word ? bare::memmove(overlap, s, size) : byteMemmove(overlap, s, size);
+    });
+}
+
+static void memcmpBenchmark(Benchmark& benchmark)
+{
+    // Equal, so the whole size is compared
+    memoryBenchmark(benchmark, [](bool word, uint8_t* d, uint8_t* s, uint32_t size)
+    {
+        volatile int result = word ? bare::memcmp(d, s, size) : byteMemcmp(d, s, size);
+        (void) result;
+    });
+}
+
+static void strlenBenchmark(Benchmark& benchmark)
+{
+    memoryBenchmark(benchmark, [](bool word, uint8_t*, uint8_t* s, uint32_t size)
+    {
+        s[size - 1] = '\0';
+        const char* string = reinterpret_cast<const char*>(s);
+        volatile size_t result = word ? bare::strlen(string) : byteStrlen(string);
+        (void) result;
+    });
+}
+
+BENCHMARK("memcpy", memcpyBenchmark);
+BENCHMARK("memset", memsetBenchmark);
+BENCHMARK("memmove", memmoveBenchmark);
+BENCHMARK("memcmp", memcmpBenchmark);
+BENCHMARK("strlen", strlenBenchmark);
+
+// A plain register loop, as a baseline for the processor and cache setup
+static void loopBenchmark(Benchmark& benchmark)
+{
+    benchmark.measure("1M adds", 1, 0, []
+    {
+        volatile uint32_t n = 0;
+        for (int i = 0; i < 1000000; ++i) {
+            n += i + 234;
+        }
+    });
+}
+
+BENCHMARK("loop", loopBenchmark);
+
+// The divide per digit conversion Print used to do, for comparison
+__attribute__((noinline)) static uint32_t divideToString(char* buf, uint64_t value, uint8_t base)
+{
+    char digits[bare::Print::MaxIntegerBufferSize];
+    char* p = digits + sizeof(digits);
+    do {
+        uint8_t digit = value % base;
+        *--p = (digit > 9) ? (digit - 10 + 'a') : (digit + '0');
+        value /= base;
+    } while (value);
+    
+    uint32_t size = static_cast<uint32_t>(digits + sizeof(digits) - p);
+    bare::memcpy(buf, p, size);
+    buf[size] = '\0';
+    return size;
+}
+
+static constexpr uint32_t IntegersPerRun = 100000;
+
+static void integersBenchmark(Benchmark& benchmark)
+{
+    static constexpr uint32_t Bits[] = { 32, 64 };
+    static constexpr uint8_t Bases[] = { 10, 16 };
+    
+    char buf[bare::Print::MaxIntegerBufferSize];
+    volatile uint32_t result;
+    
+    for (uint32_t bits : Bits) {
+        for (uint8_t base : Bases) {
+            // Values spread over all the digit counts, so short numbers are
+            // covered as well as long ones
+            uint64_t seed = 0x2545f4914f6cdd1d;
+            uint32_t i = 0;
+            auto next = [&]
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                return seed >> (64 - bits + (i++ % bits));
+            };
+            
+            bare::String label;
+            label.printf(FMT("divide %d bit base %d"), bits, base);
+            benchmark.measure(label.c_str(), IntegersPerRun, 0, [&] { result = divideToString(buf, next(), base); });
+            
+            label.clear();
+            label.printf(FMT("fast %d bit base %d"), bits, base);
+            if (bits == 32) {
+                benchmark.measure(label.c_str(), IntegersPerRun, 0, [&] { result = bare::Print::toString(buf, static_cast<uint32_t>(next()), base); });
+            } else {
+                benchmark.measure(label.c_str(), IntegersPerRun, 0, [&] { result = bare::Print::toString(buf, next(), base); });
+            }
+        }
+    }
+}
+
+BENCHMARK("integers", integersBenchmark);
+
+static void formatBenchmark(Benchmark& benchmark)
+{
+    static constexpr uint32_t Calls = 10000;
+    
+    char buf[128];
+    
+    // There's no float output without floats
+#if !defined(FLOATNONE)
+    bare::Float f = 1234.5078;
+    
+    benchmark.measure("runtime", Calls, 0, [&]
+    {
+        bare::Print::BufferSink sink(buf, sizeof(buf));
+        bare::Print::format(sink, "%s %d %08x %-6u %g\n", "count", -12345, 0xbeef, 42u, f.toArg());
+    });
+    benchmark.measure("FMT", Calls, 0, [&]
+    {
+        bare::Print::BufferSink sink(buf, sizeof(buf));
+        bare::Print::format(sink, FMT("%s %d %08x %-6u %g\n"), "count", -12345, 0xbeef, 42u, f);
+    });
+#else
+    benchmark.measure("runtime", Calls, 0, [&]
+    {
+        bare::Print::BufferSink sink(buf, sizeof(buf));
+        bare::Print::format(sink, "%s %d %08x %-6u\n", "count", -12345, 0xbeef, 42u);
+    });
+    benchmark.measure("FMT", Calls, 0, [&]
+    {
+        bare::Print::BufferSink sink(buf, sizeof(buf));
+        bare::Print::format(sink, FMT("%s %d %08x %-6u\n"), "count", -12345, 0xbeef, 42u);
+    });
+#endif
+}
+
+BENCHMARK("format", formatBenchmark);
+
+static void mathBenchmark(Benchmark& benchmark)
+{
+    static constexpr uint32_t Count = 256;
+    static constexpr uint32_t Passes = 40;
+    
+    bare::Float values[Count];
+    bare::Float other[Count];
+    for (uint32_t i = 0; i < Count; ++i) {
+        values[i] = bare::Float(0.05 + i * 0.03);
+        other[i] = bare::Float(1.0 - i * 0.002);
+    }
+    bare::Float result;
+    
+    static const struct { const char* name; bare::Float (bare::Float::*function)() const; } Functions[] = {
+        { "sqrt", &bare::Float::sqrt },
+        { "sin", &bare::Float::sin },
+        { "cos", &bare::Float::cos },
+        { "exp", &bare::Float::exp },
+        { "log", &bare::Float::log },
+    };
+    
+    for (const auto& function : Functions) {
+        uint32_t us = benchmark.measure(function.name, Passes, 0, [&]
+        {
+            for (const bare::Float& value : values) {
+                result += (value.*function.function)();
+            }
+        });
+        bare::String line;
+        line.printf(FMT("%s: %d calls/s"), function.name, us ? static_cast<uint32_t>(static_cast<uint64_t>(Passes) * Count * 1000000 / us) : 0);
+        benchmark.note(line.c_str());
+    }
+    benchmark.measure("atan2", Passes, 0, [&]
+    {
+        for (uint32_t i = 0; i < Count; ++i) {
+            result += bare::Float::atan2(values[i], other[i]);
+        }
+    });
+    
+    // The array versions against the same loop written out with Float
+    // operators
+    bare::Float scaled[Count];
+    benchmark.measure("scale", Passes, 0, [&] { bare::Float::scale(scaled, values, Count, other[1]); });
+    benchmark.measure("accumulate", Passes, 0, [&] { bare::Float::accumulate(scaled, values, Count, other[1]); });
+    benchmark.measure("dot", Passes, 0, [&] { result += bare::Float::dot(values, other, Count); });
+    benchmark.measure("dot with operators", Passes, 0, [&]
+    {
+        bare::Float sum;
+        for (uint32_t i = 0; i < Count; ++i) {
+            sum += values[i] * other[i];
+        }
+        result += sum;
+    });
+    
+    if (!result) {
+        benchmark.note("no results, timings are not valid");
+    }
+}
+
+BENCHMARK("math", mathBenchmark);
+
+static void allocatorBenchmark(Benchmark& benchmark)
+{
+    static constexpr uint32_t Pairs = 1000;
+    static constexpr size_t AllocSizes[] = { 16, 64, 256, 1024 };
+    
+    Allocator& allocator = Allocator::kernelAllocator();
+    
+    // Alloc then free of one size, which is the free list's best case
+    for (size_t size : AllocSizes) {
+        bare::String label;
+        label.printf(FMT("alloc/free %d"), static_cast<uint32_t>(size));
+        benchmark.measure(label.c_str(), Pairs, 0, [&]
+        {
+            void* mem;
+            if (allocator.alloc(size, mem)) {
+                allocator.free(mem);
+            }
+        });
+    }
+    
+    // A batch of mixed sizes allocated, then freed in a different order
+    static constexpr uint32_t Batch = 64;
+    void* mems[Batch];
+    benchmark.measure("mixed batch", 10, 0, [&]
+    {
+        for (uint32_t i = 0; i < Batch; ++i) {
+            if (!allocator.alloc(AllocSizes[i % 4] + i, mems[i])) {
+                mems[i] = nullptr;
+            }
+        }
+        for (uint32_t i = 0; i < Batch; ++i) {
+            void* mem = mems[(i * 7) % Batch];
+            if (mem) {
+                allocator.free(mem);
+            }
+        }
+    });
+}
+
+BENCHMARK("allocator", allocatorBenchmark);
+
+static constexpr const char* BenchFile = "bench.tmp";
+static constexpr uint32_t FileSize = 64 * 1024;
+static constexpr uint32_t FileChunkSize = 512;
+
+static void fatBenchmark(Benchmark& benchmark)
+{
+    FileSystem* fs = FileSystem::sharedFileSystem();
+    
+    // Directory lookup of a name that's there and one that isn't
+    if (fs->create(BenchFile) != bare::Volume::Error::OK && !fs->exists(BenchFile)) {
+        benchmark.note("could not create test file");
+        return;
+    }
+    benchmark.measure("find existing", 10, 0, [&] { volatile bool result = fs->exists(BenchFile); (void) result; });
+    benchmark.measure("find missing", 10, 0, [&] { volatile bool result = fs->exists("nothere.tmp"); (void) result; });
+    fs->remove(BenchFile);
+}
+
+BENCHMARK("fat", fatBenchmark);
+
+static void fileBenchmark(Benchmark& benchmark)
+{
+    FileSystem* fs = FileSystem::sharedFileSystem();
+    
+    AlignedBuffer buffer(FileChunkSize);
+    if (!buffer.valid()) {
+        benchmark.note("out of memory");
+        return;
+    }
+    bare::memset(buffer.data(), 'a', buffer.size());
+    char* data = reinterpret_cast<char*>(buffer.data());
+    bool failed = false;
+    
+    // Each write sample creates the file, so it includes allocating clusters
+    benchmark.measure("sequential write", 1, FileSize, [&]
+    {
+        fs->remove(BenchFile);
+        File* fp = fs->open(BenchFile, FileSystem::OpenMode::Write);
+        for (uint32_t offset = 0; fp->valid() && offset < FileSize; offset += FileChunkSize) {
+            failed |= fp->write(data, FileChunkSize) != static_cast<int32_t>(FileChunkSize);
+        }
+        failed |= fp->close() != bare::Volume::Error::OK;
+        delete fp;
+    });
+    benchmark.measure("sequential read", 1, FileSize, [&]
+    {
+        File* fp = fs->open(BenchFile);
+        for (uint32_t offset = 0; fp->valid() && offset < FileSize; offset += FileChunkSize) {
+            failed |= fp->read(data, FileChunkSize) != static_cast<int32_t>(FileChunkSize);
+        }
+        delete fp;
+    });
+    
+    // The same file through the cluster buffer a FileStream reads into
+    benchmark.measure("stream read", 1, FileSize, [&]
+    {
+        FileStream stream(BenchFile);
+        uint32_t size = 0;
+        for (Stream::Span span = stream.fill(); !span.empty(); span = stream.fill()) {
+            size += static_cast<uint32_t>(span.end - span.cursor);
+        }
+        failed |= !stream.loaded() || size != FileSize;
+    });
+    
+    fs->remove(BenchFile);
+    if (failed) {
+        benchmark.note("file I/O failed, results are not valid");
+    }
+}
+
+BENCHMARK("file", fileBenchmark);
+
+static void scannerBenchmark(Benchmark& benchmark)
+{
+    static const char* Source =
+        "function fib(n) {\n"
+        "    // Recursive, for the function calls\n"
+        "    if (n <= 1) return n;\n"
+        "    return fib(n - 1) + fib(n - 2);\n"
+        "}\n"
+        "var total = 0, i;\n"
+        "for (i = 0; i < 0x20; ++i) { total += fib(i) * 1.5e2; }\n"
+        "var s = \"a string with some length to it\";\n"
+        "while (total >= 100 && s != null) { total >>= 1; }\n"
+        "class Point { constructor(x, y) { this.x = x; this.y = y; } }\n"
+        "switch (total) { case 1: break; default: delete s; }\n";
+    
+    // A script of about 32KB, mostly identifiers and keywords
+    static constexpr uint32_t Copies = 64;
+    bare::String script;
+    script.reserve(bare::strlen(Source) * Copies);
+    for (uint32_t i = 0; i < Copies; ++i) {
+        script += Source;
+    }
+    
+    uint32_t tokens = 0;
+    uint32_t us = benchmark.measure("tokenize", 1, static_cast<uint32_t>(script.size()), [&]
+    {
+        StringStream stream(script);
+        Scanner scanner(&stream);
+        Scanner::TokenType value;
+        tokens = 0;
+        for (Token token = scanner.getToken(value); token != Token::EndOfFile && token != Token::Error; token = scanner.getToken(value)) {
+            ++tokens;
+        }
+    });
+    
+    bare::String line;
+    line.printf(FMT("%d tokens, %d tokens/s"), tokens, us ? static_cast<uint32_t>(static_cast<uint64_t>(tokens) * 1000000 / us) : 0);
+    benchmark.note(line.c_str());
+}
+
+BENCHMARK("scanner", scannerBenchmark);
+
+static void parseBenchmark(Benchmark& benchmark)
+{
+    static constexpr uint32_t Passes = 1000;
+    static const struct { const char* name; const char* numbers[8]; } Sets[] = {
+        { "decimal", { "0", "7", "42", "1234", "65535", "1000000", "123456789", "4294967295" } },
+        { "hex", { "0x0", "0x7f", "0xff", "0xbeef", "0x10000", "0xfffff", "0xdeadbeef", "0xffffffff" } },
+        { "float", { "0.5", "1.5", "3.14159", "2.5e-2", "1e3", "12345.678", "6.02e23", "0.000001" } },
+    };
+    static constexpr uint32_t Numbers = sizeof(Sets[0].numbers) / sizeof(Sets[0].numbers[0]);
+    
+    volatile uint32_t sink;
+    for (const auto& set : Sets) {
+        bool isFloat = set.name[0] == 'f';
+        
+        // The old way, a Scanner over a StringStream for each number
+        bare::String label;
+        label.printf(FMT("%s scanner"), set.name);
+        uint32_t scannerUs = benchmark.measure(label.c_str(), Passes, 0, [&]
+        {
+            for (const char* number : set.numbers) {
+                StringStream stream(number);
+                Scanner scanner(&stream);
+                Scanner::TokenType value;
+                sink = static_cast<uint32_t>(scanner.getToken(value));
+            }
+        });
+        
+        label.clear();
+        label.printf(FMT("%s parse"), set.name);
+        uint32_t parseUs = benchmark.measure(label.c_str(), Passes, 0, [&]
+        {
+            for (const char* number : set.numbers) {
+                if (isFloat) {
+                    bare::Float value;
+                    sink = static_cast<uint32_t>(bare::parse(number, value).error);
+                } else {
+                    uint32_t value;
+                    bare::parse(number, value, 0);
+                    sink = value;
+                }
+            }
+        });
+        
+        label.clear();
+        label.printf(FMT("%s: %d numbers/s, %d with the scanner"), set.name,
+                     parseUs ? static_cast<uint32_t>(static_cast<uint64_t>(Passes) * Numbers * 1000000 / parseUs) : 0,
+                     scannerUs ? static_cast<uint32_t>(static_cast<uint64_t>(Passes) * Numbers * 1000000 / scannerUs) : 0);
+        benchmark.note(label.c_str());
+    }
+}
+
+BENCHMARK("parse", parseBenchmark);
+
+// Scripts run by both the VM and the tree walker. Each does its work in a
+// function, so the VM keeps its variables in registers
+static const struct { const char* name; const char* source; } VMScripts[] = {
+    { "fib", "function fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+             "fib(15);\n" },
+    { "loop", "function loop() { var s = 0; for (var i = 0; i < 10000; i++) { s = s + i; } return s; }\n"
+              "loop();\n" },
+    { "nested", "function nested() {\n"
+                "    var t = 0;\n"
+                "    for (var i = 0; i < 100; i++) { for (var j = 0; j < 100; j++) { t += (i * j) & 7; } }\n"
+                "    return t;\n"
+                "}\n"
+                "nested();\n" },
+};
+
+class NullSink : public bare::Print::Sink
+{
+public:
+    virtual void write(const char*, size_t) override { }
+};
+
+static void vmBenchmark(Benchmark& benchmark)
+{
+    NullSink sink;
+    
+    for (const auto& script : VMScripts) {
+        StringStream compilerStream(script.source);
+        Compiler compiler(&compilerStream);
+        Program program;
+        StringStream walkerStream(script.source);
+        TreeWalker walker(&walkerStream, sink);
+        if (!compiler.compile(program) || !walker.parse()) {
+            benchmark.note("script did not compile");
+            continue;
+        }
+        
+        bare::String label;
+        bool ok = true;
+        label.printf(FMT("%s vm"), script.name);
+        VM vm(program, sink);
+        uint32_t vmUs = benchmark.measure(label.c_str(), 1, 0, [&] { ok = vm.run() && ok; });
+        label.clear();
+        label.printf(FMT("%s tree walker"), script.name);
+        uint32_t walkerUs = benchmark.measure(label.c_str(), 1, 0, [&] { ok = walker.run() && ok; });
+        
+        if (!ok) {
+            benchmark.note("script failed, results are not valid");
+        }
+        label.clear();
+        label.printf(FMT("%s: vm is %d.%02dx the speed of the tree walker"), script.name,
+                     vmUs ? walkerUs / vmUs : 0, vmUs ? (walkerUs % vmUs) * 100 / vmUs : 0);
+        benchmark.note(label.c_str());
+    }
+}
+
+BENCHMARK("vm", vmBenchmark);
+
+// Does nothing when it fires, which none of them do here
+class IdleTimer : public bare::Timer
+{
+public:
+    virtual void handleTimerEvent() override { }
+};
+
+// Starts and stops a heap's worth at scattered deadlines, far enough off
+// that none fire. The kernel may have some running, so leave room for them
+static void timerBenchmark(Benchmark& benchmark)
+{
+    static constexpr uint32_t Count = bare::Timer::MaxTimers / 2;
+    static constexpr uint32_t Delay = 1000000;
+    
+    IdleTimer timers[Count];
+    if (!bare::Timer::start(&timers[0], Delay, false)) {
+        benchmark.note("no timer interrupts");
+        return;
+    }
+    bare::Timer::stop(&timers[0]);
+    
+    bare::String label;
+    label.printf(FMT("start and stop %d"), Count);
+    uint32_t seed = 1;
+    benchmark.measure(label.c_str(), 100, 0, [&]
+    {
+        for (IdleTimer& timer : timers) {
+            seed = seed * 1103515245 + 12345;
+            bare::Timer::start(&timer, Delay + ((seed >> 16) & 0xfff), false);
+        }
+        for (IdleTimer& timer : timers) {
+            bare::Timer::stop(&timer);
+        }
+    });
+}
+
+BENCHMARK("timer", timerBenchmark);
+
+static void sleepBenchmark(Benchmark& benchmark)
+{
+    benchmark.measure("usleep 1ms", 10, 0, [] { bare::Timer::usleep(1000); });
+}
+
+BENCHMARK("sleep", sleepBenchmark);
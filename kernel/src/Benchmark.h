@@ -0,0 +1,111 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare/StringView.h"
+#include "bare/Timer.h"
+#include <cstdint>
+#include <functional>
+
+// Adds a benchmark to the registry. function is a void(Benchmark&), which
+// does any setup and then calls measure() for each thing it times
+#define BENCHMARK(name, function) \
+    static placid::Benchmark::Registration _benchmark_##function(name, function)
+
+namespace placid {
+
+    // Benchmark - Timing runs for the shell's bench command
+    //
+    // Each registered benchmark is run by name, or all of them whose name
+    // contains a pattern. A measurement repeats its work Samples times and
+    // reports the fastest, median and slowest sample in microseconds, and
+    // throughput from the median when the work has a size in bytes. Results
+    // are reported a line at a time through the passed function. The same
+    // benchmarks run on the device and in the host build.
+    class Benchmark
+    {
+    public:
+        using Reporter = std::function<void(const char*)>;
+        using Function = void (*)(Benchmark&);
+        
+        static constexpr uint32_t Samples = 5;
+        
+        struct Registration
+        {
+            Registration(const char* name, Function);
+            
+            const char* name;
+            Function function;
+            Registration* next = nullptr;
+        };
+        
+        // Runs the benchmarks whose names contain pattern, or all of them if
+        // it is empty, in the order they were registered. Returns the number
+        // run
+        static uint32_t run(const bare::StringView& pattern, const Reporter&);
+        
+        // Times iterations calls of func, Samples times. bytes is the amount
+        // of data one call processes, or 0 if throughput doesn't apply.
+        // Returns the median sample
+        template<typename Func>
+        uint32_t measure(const char* label, uint32_t iterations, uint32_t bytes, Func func)
+        {
+            uint32_t samples[Samples];
+            for (uint32_t& sample : samples) {
+                int64_t start = bare::Timer::systemTime();
+                for (uint32_t i = 0; i < iterations; ++i) {
+                    func();
+                }
+                sample = static_cast<uint32_t>(bare::Timer::systemTime() - start);
+            }
+            return report(label, static_cast<uint64_t>(iterations) * bytes, samples);
+        }
+        
+        // Reports a line which isn't a measurement, like a failure to set up
+        void note(const char* message);
+        
+    private:
+        Benchmark(const char* name, const Reporter& reporter) : _name(name), _reporter(reporter) { }
+        
+        uint32_t report(const char* label, uint64_t bytes, uint32_t* samples);
+        
+        const char* _name;
+        const Reporter& _reporter;
+        
+        static Registration* _first;
+    };
+
+}
@@ -37,13 +37,20 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "BootShell.h"
 
+#include "bare/Log.h"
 #include "bare/Print.h"
 #include "bare/Serial.h"
 #include "bare/WiFiSpi.h"
 #include "bare/Timer.h"
+#include "bare/Trace.h"
 #include "bare/XYModem.h"
 #include "Allocator.h"
+#include "AllocTrace.h"
+#include "Benchmark.h"
 #include "FileSystem.h"
+#include "ProgramImage.h"
+#include "SelfTest.h"
+#include "VM.h"
 
 using namespace placid;
 
@@ -58,23 +65,23 @@ static void testSPI()
     // check for the presence of the ESP module:
     bare::WiFiSpi::Status status = wifi.status();
     if (status == bare::WiFiSpi::Status::NoShield) {
-        bare::Serial::printf("WiFi module not present");
+        bare::Serial::printf(FMT("WiFi module not present"));
     } else {
-        bare::Serial::printf("WiFiSpi status=%#04x\n", static_cast<uint8_t>(status));
+        bare::Serial::printf(FMT("WiFiSpi status=%#04x\n"), static_cast<uint8_t>(status));
         
         bare::String fv = wifi.firmwareVersion();
         if (fv != "0.1.2") {
-            bare::Serial::printf("WiFiSpi firmware version='%s', expected 0.1.2\n", fv.c_str());
+            bare::Serial::printf(FMT("WiFiSpi firmware version='%s', expected 0.1.2\n"), fv.c_str());
         } else {
             bare::WiFiSpi::Status status = bare::WiFiSpi::Status::Idle;
             while (status != bare::WiFiSpi::Status::Connected) {
-                bare::Serial::printf("Wifi status: %d\n", status);
+                bare::Serial::printf(FMT("Wifi status: %d\n"), static_cast<uint8_t>(status));
                 bare::Timer::usleep(1000000);
                 status = wifi.status();
             }
 
             // you're connected now, so print out the data:
-            bare::Serial::printf("You're connected to '%s'\n", wifi.SSID().c_str());
+            bare::Serial::printf(FMT("You're connected to '%s'\n"), wifi.SSID().c_str());
         }
     }
 }
@@ -94,16 +101,22 @@ const char* BootShell::welcomeString() const
 const char* BootShell::helpString() const
 {
 	return
+            "    bench [<pattern>]  : run benchmarks matching pattern\n"
             "    date [<time/date>] : set/get time/date\n"
             "    debug [on/off]     : turn debugging on/off\n"
             "    heap               : show heap status\n"
+            "    heap trace <op>    : start, stop or save <file> heap trace\n"
+            "    heap replay <file> : replay heap trace on each allocator\n"
+            "    log [on/off/clear] : show deferred log, or drain it when idle\n"
             "    put <file>         : put file (X/YModem send)\n"
             "    ls                 : list files\n"
             "    mv <src> <dst>     : rename file\n"
             "    reset              : restart kernel\n"
             "    rm <file>          : remove file\n"
             "    run <file>         : run user program\n"
-            "    stop <pid>         : stop user program\n"
+            "    stop               : stop user program (^C while it runs)\n"
+            "    test [<pattern>]   : run self tests matching pattern\n"
+            "    trace [<op>]       : dump Chrome trace JSON, or on, off, clear\n"
     ;
 }
 
@@ -118,30 +131,55 @@ void BootShell::shellSend(const char* data, uint32_t size, bool raw)
     // puts converts control characters to printable, so if we want
     // to send control we have to send raw
     if (raw) {
-        while (size--) {
-            bare::Serial::write(*data++);
-        }
+        bare::Serial::write(data, size);
     } else {
 	    bare::Serial::puts(data, size);
      }   
 }
 
+// Ctrl-C stops a running program. Other input while it runs is dropped.
+// Without interrupts there is no input buffer to poll, and on the host a
+// read would block, so there is nothing to check
+static bool serialBreak()
+{
+    static constexpr uint8_t CtrlC = 0x03;
+    
+    uint8_t c;
+    while (bare::interruptsSupported() && bare::Serial::rxReady()) {
+        if (bare::Serial::read(c) == bare::Serial::Error::OK && c == CtrlC) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sends formatted output through the shell
+class ShellSink : public bare::Print::Sink
+{
+public:
+    ShellSink(BootShell* shell) : _shell(shell) { }
+    
+    virtual void write(const char* s, size_t n) override { _shell->shellSend(s, static_cast<uint32_t>(n)); }
+
+private:
+    BootShell* _shell;
+};
+
 static bare::String timeString()
 {
     static const char* days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
     
     bare::RealTime currentTime = bare::Timer::currentTime();
     char buf[50];
-    char* p = buf;
-    uint32_t count = 49;
-    bare::Print::format([&p, &count](char c) { if (count--) *p++ = c; }, "%s %d/%d/%d %d:%02d:%02d",
+    bare::Print::BufferSink sink(buf, sizeof(buf));
+    bare::Print::format(sink, FMT("%s %d/%d/%d %d:%02d:%02d"),
         days[currentTime.dayOfWeek()],
         currentTime.month(), currentTime.day(), currentTime.year(),
         currentTime.hours(), currentTime.minutes(), currentTime.seconds());
     return bare::String(buf);
 }
 
-bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
+bool BootShell::executeShellCommand(const ArgList& array)
 {
     if (array[0] == "ls") {
         bare::DirectoryIterator* it = FileSystem::sharedFileSystem()->directoryIterator("/");
@@ -155,12 +193,12 @@ bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
             return true;
         }
         
-        File* fp = FileSystem::sharedFileSystem()->open(array[1].c_str(), FileSystem::OpenMode::Write);
+        File* fp = FileSystem::sharedFileSystem()->open(array[1].data(), FileSystem::OpenMode::Write);
         if (!fp->valid()) {
             if (fp->error() == bare::Volume::Error::FileExists) {
-                showMessage(MessageType::Error, "'%s' exists. Please select a new file name\n", array[1].c_str());
+                showMessage(MessageType::Error, "'%s' exists. Please select a new file name\n", array[1].data());
             } else {
-                showMessage(MessageType::Error, "open of '%s' failed: %s\n", array[1].c_str(), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+                showMessage(MessageType::Error, "open of '%s' failed: %s\n", array[1].data(), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
             }
             delete fp;
             return true;
@@ -182,14 +220,14 @@ bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
             bare::Timer::usleep(100000);
             showMessage(MessageType::Error, "X/YModem upload failed\n");
             delete fp;
-            bare::Volume::Error error = FileSystem::sharedFileSystem()->remove(array[1].c_str());
+            bare::Volume::Error error = FileSystem::sharedFileSystem()->remove(array[1].data());
             if (error != bare::Volume::Error::OK) {
                 showMessage(MessageType::Error, "deletion of '%s' failed: %s\n",
-                    array[1].c_str(), FileSystem::sharedFileSystem()->errorDetail(error));
+                    array[1].data(), FileSystem::sharedFileSystem()->errorDetail(error));
             }
         } else {
             bare::Timer::usleep(100000);
-            showMessage(MessageType::Info, "'%s' uploaded, size=%d\n", array[1].c_str(), fp->size());
+            showMessage(MessageType::Info, "'%s' uploaded, size=%d\n", array[1].data(), fp->size());
             delete fp;
         }
     } else if (array[0] == "reset") {
@@ -199,11 +237,11 @@ bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
             showMessage(MessageType::Error, "rm requires one file name\n");
             return true;
         }
-        bare::Volume::Error error = FileSystem::sharedFileSystem()->remove(array[1].c_str());
+        bare::Volume::Error error = FileSystem::sharedFileSystem()->remove(array[1].data());
         if (error != bare::Volume::Error::OK) {
             showMessage(MessageType::Error, "attempting to rm: %s\n", FileSystem::sharedFileSystem()->errorDetail(error));
         } else {
-            showMessage(MessageType::Info, "'%s' removed\n", array[1].c_str());
+            showMessage(MessageType::Info, "'%s' removed\n", array[1].data());
         }
         return true;
     } else if (array[0] == "mv") {
@@ -212,24 +250,24 @@ bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
             return true;
         }
         
-        File* fp = FileSystem::sharedFileSystem()->open(array[1].c_str(), FileSystem::OpenMode::Read);
+        File* fp = FileSystem::sharedFileSystem()->open(array[1].data(), FileSystem::OpenMode::Read);
         if (!fp->valid()) {
             if (fp->error() == bare::Volume::Error::FileNotFound) {
-                showMessage(MessageType::Error, "from filename '%s' does not exist\n", array[1].c_str());
+                showMessage(MessageType::Error, "from filename '%s' does not exist\n", array[1].data());
             } else {
-                showMessage(MessageType::Error, "open of '%s' failed: %s\n", array[1].c_str(), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+                showMessage(MessageType::Error, "open of '%s' failed: %s\n", array[1].data(), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
             }
             delete fp;
             return true;
         }
 
-        bare::Volume::Error error = fp->rename(array[2].c_str());
+        bare::Volume::Error error = fp->rename(array[2].data());
         if (error == bare::Volume::Error::FileExists) {
-            showMessage(MessageType::Error, "to filename '%s' exists. Please select a new file name\n", array[2].c_str());
+            showMessage(MessageType::Error, "to filename '%s' exists. Please select a new file name\n", array[2].data());
         } else if (fp->error() != bare::Volume::Error::OK) {
-            showMessage(MessageType::Error, "rename of '%s' to '%s' failed: %s\n", array[1].c_str(), array[2].c_str(), FileSystem::sharedFileSystem()->errorDetail(error));
+            showMessage(MessageType::Error, "rename of '%s' to '%s' failed: %s\n", array[1].data(), array[2].data(), FileSystem::sharedFileSystem()->errorDetail(error));
         } else {
-            showMessage(MessageType::Info, "'%s' renamed to '%s'\n", array[1].c_str(), array[2].c_str());
+            showMessage(MessageType::Info, "'%s' renamed to '%s'\n", array[1].data(), array[2].data());
         }
         
         delete fp;
@@ -242,8 +280,13 @@ bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
             //      date "+%Y/%m/%d %T"
             //
             //      e.g., 2018/10/05 23:57:39
-            std::vector<bare::String> dateArray = array[1].split("/");
-            std::vector<bare::String> timeArray = array[2].split(":");
+            bare::FixedVector<bare::StringView, 3> dateArray;
+            bare::FixedVector<bare::StringView, 3> timeArray;
+            if (array.size() != 3 || !array[1].split(dateArray, "/") || !array[2].split(timeArray, ":") ||
+                    !dateArray.full() || !timeArray.full()) {
+                showMessage(MessageType::Error, "wrong format, use yyyy/mm/dd hh:mm:ss\n");
+                return true;
+            }
             bare::RealTime t(
                     static_cast<uint32_t>(dateArray[0]),
                     static_cast<uint32_t>(dateArray[1]),
@@ -255,16 +298,145 @@ bool BootShell::executeShellCommand(const std::vector<bare::String>& array)
             showMessage(MessageType::Info, "set current time to: %s\n", timeString().c_str());
         }
     } else if (array[0] == "heap") {
-        uint32_t size = Allocator::kernelAllocator().size();
-        showMessage(MessageType::Info, "heap size: %d\n", size);
+        if (array.size() == 1) {
+            uint32_t size = Allocator::kernelAllocator().size();
+            showMessage(MessageType::Info, "heap size: %d\n", size);
+            showMessage(MessageType::Info, "%s heap footprint: %d\n", kernelHeapName(), kernelHeapFootprint());
+            showMessage(MessageType::Info, "bootstrap heap: %d of %d\n", bare::Memory::bootstrapHeapUsed(), bare::Memory::bootstrapHeapSize());
+            if (AllocTrace::recording() || AllocTrace::count()) {
+                showMessage(MessageType::Info, "trace: %d events%s%s\n", AllocTrace::count(),
+                    AllocTrace::recording() ? ", recording" : "", AllocTrace::overflowed() ? ", full" : "");
+            }
+        } else if (array[1] == "trace" && array.size() == 3 && array[2] == "start") {
+            if (!AllocTrace::start()) {
+                showMessage(MessageType::Error, "could not allocate trace buffer\n");
+            } else {
+                showMessage(MessageType::Info, "heap trace started\n");
+            }
+        } else if (array[1] == "trace" && array.size() == 3 && array[2] == "stop") {
+            AllocTrace::stop();
+            showMessage(MessageType::Info, "heap trace stopped, %d events\n", AllocTrace::count());
+        } else if (array[1] == "trace" && array.size() == 4 && array[2] == "save") {
+            bare::Volume::Error error = AllocTrace::save(array[3].data());
+            if (error != bare::Volume::Error::OK) {
+                showMessage(MessageType::Error, "save of '%s' failed: %s\n", array[3].data(), FileSystem::sharedFileSystem()->errorDetail(error));
+            } else {
+                showMessage(MessageType::Info, "%d events saved to '%s'\n", AllocTrace::count(), array[3].data());
+            }
+        } else if (array[1] == "replay" && array.size() == 3) {
+            bare::Volume::Error error = AllocTrace::replay(array[2].data(), [this](const AllocTrace::Result& result)
+            {
+                if (!result.completed) {
+                    showMessage(MessageType::Error, "%-9s out of memory after %d events, peak live %d, peak footprint %d\n",
+                        result.backend, result.events, result.peakLive, result.peakFootprint);
+                    return;
+                }
+                uint32_t opsPerSecond = result.us ? static_cast<uint32_t>(static_cast<uint64_t>(result.events) * 1000000 / result.us) : 0;
+                uint32_t fragmentation = result.peakFootprint ? (result.peakFootprint - result.peakLive) * 100 / result.peakFootprint : 0;
+                showMessage(MessageType::Info, "%-9s %6d events %8dus %8d ops/s, peak live %d, peak footprint %d, fragmentation %d%c\n",
+                    result.backend, result.events, result.us, opsPerSecond, result.peakLive, result.peakFootprint, fragmentation, '%');
+            });
+            if (error != bare::Volume::Error::OK) {
+                showMessage(MessageType::Error, "replay of '%s' failed: %s\n", array[2].data(), FileSystem::sharedFileSystem()->errorDetail(error));
+            }
+        } else {
+            showMessage(MessageType::Error, "unrecognized heap command\n");
+        }
+    } else if (array[0] == "log") {
+        if (array.size() == 1) {
+            uint32_t dropped = bare::Log::dropped();
+            ShellSink sink(this);
+            uint32_t count = bare::Log::drain(sink);
+            showMessage(MessageType::Info, "%d entries, %d dropped\n", count, dropped);
+        } else if (array[1] == "on") {
+            bare::Log::setBackgroundDrain(true);
+            showMessage(MessageType::Info, "log drained when idle\n");
+        } else if (array[1] == "off") {
+            bare::Log::setBackgroundDrain(false);
+            showMessage(MessageType::Info, "log drained by 'log' command\n");
+        } else if (array[1] == "clear") {
+            bare::Log::clear();
+            showMessage(MessageType::Info, "log cleared\n");
+        } else {
+            showMessage(MessageType::Error, "unrecognized log command\n");
+        }
+    } else if (array[0] == "trace") {
+        if (array.size() == 1) {
+            // Stop while dumping so the dump doesn't trace itself
+            bool recording = bare::Trace::recording();
+            bare::Trace::stop();
+            ShellSink sink(this);
+            bare::Trace::dump(sink);
+            showMessage(MessageType::Info, "%d events, %d dropped\n", bare::Trace::count(), bare::Trace::dropped());
+            if (recording) {
+                bare::Trace::start();
+            }
+        } else if (array[1] == "on") {
+            bare::Trace::start();
+            showMessage(MessageType::Info, "trace recording\n");
+        } else if (array[1] == "off") {
+            bare::Trace::stop();
+            showMessage(MessageType::Info, "trace stopped\n");
+        } else if (array[1] == "clear") {
+            bare::Trace::clear();
+            showMessage(MessageType::Info, "trace cleared\n");
+        } else {
+            showMessage(MessageType::Error, "unrecognized trace command\n");
+        }
+    } else if (array[0] == "bench") {
+        Benchmark::Reporter reporter = [this](const char* line) { showMessage(MessageType::Info, "%s\n", line); };
+        bare::StringView pattern = (array.size() > 1) ? array[1] : bare::StringView();
+        if (Benchmark::run(pattern, reporter) == 0) {
+            showMessage(MessageType::Error, "no benchmark matches '%s'\n", pattern.data());
+        }
+    } else if (array[0] == "test") {
+        SelfTest::Reporter reporter = [this](const char* line) { showMessage(MessageType::Info, "%s\n", line); };
+        bare::StringView pattern = (array.size() > 1) ? array[1] : bare::StringView();
+        uint32_t failed;
+        uint32_t count = SelfTest::run(pattern, reporter, failed);
+        if (count == 0) {
+            showMessage(MessageType::Error, "no test matches '%s'\n", pattern.data());
+        } else if (failed) {
+            showMessage(MessageType::Error, "%d of %d tests failed\n", failed, count);
+        } else {
+            showMessage(MessageType::Info, "%d tests passed\n", count);
+        }
     } else if (array[0] == "run") {
-        showMessage(MessageType::Info, "Program started...\n");
+        if (array.size() != 2) {
+            showMessage(MessageType::Error, "run requires a file name\n");
+            return true;
+        }
+        
+        // Compiled from the source only if its image is missing or stale
+        Program program;
+        ProgramImage image(array[1].data());
+        ProgramImage::Status status = image.load(program);
+        if (status == ProgramImage::Status::NotFound) {
+            showMessage(MessageType::Error, "could not open '%s'\n", array[1].data());
+            return true;
+        }
+        if (status == ProgramImage::Status::Error) {
+            showMessage(MessageType::Error, "%s:%d: %s\n", array[1].data(), image.line(), image.error());
+            return true;
+        }
+        
+        // Runs to completion, or until a Ctrl-C, before the shell takes
+        // another command
+        ShellSink sink(this);
+        VM vm(program, sink);
+        vm.setStopCheck(serialBreak);
+        if (!vm.run()) {
+            showMessage(MessageType::Error, "%s:%d: %s\n", array[1].data(), vm.line(), vm.error());
+        }
     } else if (array[0] == "stop") {
-        showMessage(MessageType::Info, "Program stopped\n");
+        // Programs run synchronously from the shell, so by the time this
+        // command is read there is nothing to stop. A running program is
+        // stopped with Ctrl-C instead
+        showMessage(MessageType::Info, "no program is running, ^C stops one while it runs\n");
     } else if (array[0] == "debug") {
         showMessage(MessageType::Info, "Debug true\n");
     } else if (array[0] == "spi") {
-        bare::Serial::printf("SPI test\n");
+        bare::Serial::printf(FMT("SPI test\n"));
         testSPI();
     } else {
         return false;
@@ -49,7 +49,7 @@ namespace placid {
 		virtual const char* helpString() const override;
         virtual const char* promptString() const override;
 	    virtual void shellSend(const char* data, uint32_t size = 0, bool raw = false) override;
-		virtual bool executeShellCommand(const std::vector<bare::String>&) override;
+		virtual bool executeShellCommand(const ArgList&) override;
 	};
 	
 }
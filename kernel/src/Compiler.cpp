@@ -0,0 +1,921 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "Compiler.h"
+
+using namespace placid;
+
+constexpr uint16_t Compiler::NoSlot;
+
+uint8_t Compiler::precedence(Token token)
+{
+    switch (token) {
+        case Token::LOR: return 1;
+        case Token::LAND: return 2;
+        case Token::OR: return 3;
+        case Token::XOR: return 4;
+        case Token::Ampersand: return 5;
+        case Token::EQ:
+        case Token::NE: return 6;
+        case Token::LT:
+        case Token::GT:
+        case Token::LE:
+        case Token::GE: return 7;
+        case Token::SHL:
+        case Token::SHR:
+        case Token::SAR: return 8;
+        case Token::Plus:
+        case Token::Minus: return 9;
+        case Token::Star:
+        case Token::Slash:
+        case Token::Percent: return 10;
+        default: return 0;
+    }
+}
+
+// The Scanner calls >> SHR and >>> SAR
+static Op binaryOp(Token token)
+{
+    switch (token) {
+        case Token::OR: return Op::BitOr;
+        case Token::XOR: return Op::BitXor;
+        case Token::Ampersand: return Op::BitAnd;
+        case Token::EQ: return Op::Eq;
+        case Token::NE: return Op::Ne;
+        case Token::LT: return Op::Lt;
+        case Token::GT: return Op::Gt;
+        case Token::LE: return Op::Le;
+        case Token::GE: return Op::Ge;
+        case Token::SHL: return Op::Shl;
+        case Token::SHR: return Op::Shr;
+        case Token::SAR: return Op::UShr;
+        case Token::Plus: return Op::Add;
+        case Token::Minus: return Op::Sub;
+        case Token::Star: return Op::Mul;
+        case Token::Slash: return Op::Div;
+        default: return Op::Mod;
+    }
+}
+
+// The operator of a compound assignment, or Op::Count if token isn't one
+static Op compoundOp(Token token)
+{
+    switch (token) {
+        case Token::ADDSTO: return Op::Add;
+        case Token::SUBSTO: return Op::Sub;
+        case Token::MULSTO: return Op::Mul;
+        case Token::DIVSTO: return Op::Div;
+        case Token::MODSTO: return Op::Mod;
+        case Token::ANDSTO: return Op::BitAnd;
+        case Token::ORSTO: return Op::BitOr;
+        case Token::XORSTO: return Op::BitXor;
+        case Token::SHLSTO: return Op::Shl;
+        case Token::SHRSTO: return Op::Shr;
+        case Token::SARSTO: return Op::UShr;
+        default: return Op::Count;
+    }
+}
+
+bool Compiler::compile(Program& program)
+{
+    program = Program();
+    _program = &program;
+    _error.clear();
+    _globalSlots.clear();
+    _stringSlots.clear();
+    
+    bare::Arena::Scope scope(_arena);
+    
+    // Natives are the first globals, so the VM knows where they are
+    for (uint8_t i = 0; i < static_cast<uint8_t>(Native::Count); ++i) {
+        global(atoms().intern(nativeName(static_cast<Native>(i))));
+    }
+    
+    _program->_functions.emplace_back();
+    _program->_functions.back().name = "main";
+    
+    FunctionState state(_arena);
+    state.index = 0;
+    state.topLevel = true;
+    _fs = &state;
+    
+    while (!failed() && token() != Token::EndOfFile) {
+        statement();
+    }
+    emit(Instruction::abc(Op::ReturnNull, 0));
+    
+    _fs = nullptr;
+    return !failed();
+}
+
+void Compiler::statement()
+{
+    switch (token()) {
+        case Token::Var:
+            next();
+            varStatement();
+            break;
+        case Token::Function:
+            if (!_fs->topLevel) {
+                fail("functions must be declared at the top level");
+                break;
+            }
+            next();
+            functionDeclaration();
+            break;
+        case Token::If:
+            next();
+            ifStatement();
+            break;
+        case Token::While:
+            next();
+            whileStatement();
+            break;
+        case Token::For:
+            next();
+            forStatement();
+            break;
+        case Token::Break:
+        case Token::Continue: {
+            bool isBreak = token() == Token::Break;
+            next();
+            jumpStatement(isBreak);
+            break;
+        }
+        case Token::Return:
+            next();
+            returnStatement();
+            break;
+        case Token::LBrace:
+            next();
+            block();
+            break;
+        case Token::Semicolon:
+            next();
+            break;
+        default: {
+            uint32_t start = static_cast<uint32_t>(function().code.size());
+            expression();
+            discardResult(start);
+            endStatement();
+            break;
+        }
+    }
+    
+    // Temporaries only live for a statement
+    _fs->top = static_cast<uint32_t>(_fs->locals.size());
+}
+
+void Compiler::block()
+{
+    while (!failed() && token() != Token::RBrace && token() != Token::EndOfFile) {
+        statement();
+    }
+    expect(Token::RBrace, "'}'");
+}
+
+void Compiler::varStatement()
+{
+    do {
+        Atom name = identifier("variable name");
+        if (failed()) {
+            return;
+        }
+        
+        if (_fs->topLevel) {
+            uint16_t slot = global(name);
+            if (accept(Token::STO)) {
+                uint8_t reg = expression();
+                emit(Instruction::abx(Op::SetGlobal, reg, slot));
+            }
+        } else {
+            Variable variable = resolve(name);
+            if (variable.local) {
+                // Declared again, which is only an assignment
+                if (accept(Token::STO)) {
+                    expression(variable.index);
+                }
+            } else {
+                // A new local takes the first free register, which is
+                // above the others since this is the start of a statement
+                uint8_t reg = allocRegister();
+                if (accept(Token::STO)) {
+                    expression(reg);
+                } else {
+                    emit(Instruction::abc(Op::LoadNull, reg));
+                }
+                _fs->locals.push_back(name);
+            }
+        }
+        _fs->top = static_cast<uint32_t>(_fs->locals.size());
+    } while (!failed() && accept(Token::Comma));
+    
+    endStatement();
+}
+
+void Compiler::functionDeclaration()
+{
+    Atom name = identifier("function name");
+    if (failed()) {
+        return;
+    }
+    
+    // Functions are stored in their global before the program runs, so
+    // they can be called above their declaration
+    uint32_t index = static_cast<uint32_t>(_program->_functions.size());
+    _program->_functions.emplace_back();
+    _program->_functions.back().name = atoms().name(name);
+    _program->_functions.back().global = global(name);
+    
+    FunctionState state(_arena);
+    state.index = index;
+    FunctionState* outer = _fs;
+    _fs = &state;
+    
+    expect(Token::LParen, "'(' after function name");
+    if (!accept(Token::RParen)) {
+        do {
+            Atom param = identifier("parameter name");
+            state.locals.push_back(param);
+        } while (!failed() && accept(Token::Comma));
+        expect(Token::RParen, "')' after parameters");
+    }
+    state.top = static_cast<uint32_t>(state.locals.size());
+    function().params = static_cast<uint8_t>(state.locals.size());
+    if (function().registers < state.top) {
+        function().registers = static_cast<uint8_t>(state.top);
+    }
+    
+    if (expect(Token::LBrace, "'{' before function body")) {
+        block();
+    }
+    emit(Instruction::abc(Op::ReturnNull, 0));
+    
+    _fs = outer;
+}
+
+void Compiler::ifStatement()
+{
+    expect(Token::LParen, "'(' after if");
+    uint8_t condition = expression();
+    expect(Token::RParen, "')' after condition");
+    uint32_t elseJump = emitJump(Op::JumpIfFalse, condition);
+    _fs->top = static_cast<uint32_t>(_fs->locals.size());
+    
+    statement();
+    
+    if (accept(Token::Else)) {
+        uint32_t endJump = emitJump(Op::Jump);
+        patchJump(elseJump);
+        statement();
+        patchJump(endJump);
+    } else {
+        patchJump(elseJump);
+    }
+}
+
+void Compiler::whileStatement()
+{
+    uint32_t loopStart = static_cast<uint32_t>(function().code.size());
+    
+    expect(Token::LParen, "'(' after while");
+    uint8_t condition = expression();
+    expect(Token::RParen, "')' after condition");
+    uint32_t exitJump = emitJump(Op::JumpIfFalse, condition);
+    _fs->top = static_cast<uint32_t>(_fs->locals.size());
+    
+    _fs->loops.emplace_back(_arena);
+    statement();
+    
+    endLoop(loopStart);
+    emitLoop(loopStart);
+    patchJump(exitJump);
+    patchBreaks();
+}
+
+void Compiler::forStatement()
+{
+    expect(Token::LParen, "'(' after for");
+    
+    if (accept(Token::Var)) {
+        varStatement();
+    } else if (!accept(Token::Semicolon)) {
+        uint32_t start = static_cast<uint32_t>(function().code.size());
+        expression();
+        discardResult(start);
+        expect(Token::Semicolon, "';' after loop initializer");
+    }
+    _fs->top = static_cast<uint32_t>(_fs->locals.size());
+    
+    uint32_t loopStart = static_cast<uint32_t>(function().code.size());
+    int32_t exitJump = -1;
+    if (!accept(Token::Semicolon)) {
+        uint8_t condition = expression();
+        exitJump = static_cast<int32_t>(emitJump(Op::JumpIfFalse, condition));
+        expect(Token::Semicolon, "';' after loop condition");
+    }
+    _fs->top = static_cast<uint32_t>(_fs->locals.size());
+    
+    // The increment comes before the body in the source but runs after
+    // it. It's compiled here, then moved to the end of the loop. Jumps are
+    // relative, so any inside it still work.
+    Function& fn = function();
+    uint32_t stepStart = static_cast<uint32_t>(fn.code.size());
+    if (token() != Token::RParen) {
+        expression();
+        discardResult(stepStart);
+    }
+    expect(Token::RParen, "')' after for clauses");
+    _fs->top = static_cast<uint32_t>(_fs->locals.size());
+    
+    ScratchVector<Instruction> stepCode(function().code.begin() + stepStart, function().code.end(), _arena);
+    ScratchVector<uint16_t> stepLines(function().lines.begin() + stepStart, function().lines.end(), _arena);
+    function().code.resize(stepStart);
+    function().lines.resize(stepStart);
+    
+    _fs->loops.emplace_back(_arena);
+    statement();
+    
+    endLoop(static_cast<uint32_t>(function().code.size()));
+    function().code.insert(function().code.end(), stepCode.begin(), stepCode.end());
+    function().lines.insert(function().lines.end(), stepLines.begin(), stepLines.end());
+    emitLoop(loopStart);
+    if (exitJump >= 0) {
+        patchJump(static_cast<uint32_t>(exitJump));
+    }
+    patchBreaks();
+}
+
+void Compiler::jumpStatement(bool isBreak)
+{
+    if (_fs->loops.empty()) {
+        fail(isBreak ? "break outside of a loop" : "continue outside of a loop");
+        return;
+    }
+    uint32_t jump = emitJump(Op::Jump);
+    if (isBreak) {
+        _fs->loops.back().breaks.push_back(jump);
+    } else {
+        _fs->loops.back().continues.push_back(jump);
+    }
+    endStatement();
+}
+
+void Compiler::returnStatement()
+{
+    if (token() == Token::Semicolon || token() == Token::RBrace || token() == Token::EndOfFile) {
+        emit(Instruction::abc(Op::ReturnNull, 0));
+    } else {
+        emit(Instruction::abc(Op::Return, expression()));
+    }
+    endStatement();
+}
+
+void Compiler::endStatement()
+{
+    if (accept(Token::Semicolon) || token() == Token::RBrace || token() == Token::EndOfFile) {
+        return;
+    }
+    fail("expected ';'");
+}
+
+void Compiler::endLoop(uint32_t continueTarget)
+{
+    for (uint32_t jump : _fs->loops.back().continues) {
+        patchJump(jump, continueTarget);
+    }
+}
+
+void Compiler::patchBreaks()
+{
+    for (uint32_t jump : _fs->loops.back().breaks) {
+        patchJump(jump);
+    }
+    _fs->loops.pop_back();
+}
+
+// An expression statement of just i++ or i-- on a local compiles to a
+// Move of the old value to a temporary and an Inc. Nothing uses the old
+// value, so drop the Move
+void Compiler::discardResult(uint32_t start)
+{
+    std::vector<Instruction>& code = function().code;
+    if (code.size() != start + 2) {
+        return;
+    }
+    Instruction move = code[start];
+    Instruction inc = code[start + 1];
+    if (move.op() == Op::Move && (inc.op() == Op::Inc || inc.op() == Op::Dec) &&
+            move.b() == inc.a() && inc.a() == inc.b() && move.a() >= _fs->locals.size()) {
+        code.erase(code.begin() + start);
+        function().lines.erase(function().lines.begin() + start);
+    }
+}
+
+uint8_t Compiler::expression(int16_t dst)
+{
+    return conditional(dst, true);
+}
+
+uint8_t Compiler::conditional(int16_t dst, bool canAssign)
+{
+    uint32_t saved = _fs->top;
+    uint8_t condition = binary(1, NoRegister, canAssign);
+    if (!accept(Token::Question)) {
+        return moveTo(condition, dst);
+    }
+    
+    _fs->top = saved;
+    uint8_t result = target(dst);
+    uint32_t elseJump = emitJump(Op::JumpIfFalse, condition);
+    expression(result);
+    release(saved, result);
+    uint32_t endJump = emitJump(Op::Jump);
+    expect(Token::Colon, "':' in conditional expression");
+    patchJump(elseJump);
+    expression(result);
+    release(saved, result);
+    patchJump(endJump);
+    return moveTo(result, dst);
+}
+
+uint8_t Compiler::binary(uint8_t minPrecedence, int16_t dst, bool canAssign)
+{
+    uint32_t saved = _fs->top;
+    uint8_t left = unary(NoRegister, canAssign);
+    
+    for ( ; ; ) {
+        Token op = token();
+        uint8_t opPrecedence = precedence(op);
+        if (failed() || opPrecedence == 0 || opPrecedence < minPrecedence) {
+            break;
+        }
+        next();
+        
+        _fs->top = saved;
+        if (op == Token::LAND || op == Token::LOR) {
+            // The value is the left side if it decides the result,
+            // otherwise the right side
+            uint8_t result = target(dst);
+            if (left != result) {
+                emit(Instruction::abc(Op::Move, result, left));
+            }
+            uint32_t jump = emitJump((op == Token::LAND) ? Op::JumpIfFalse : Op::JumpIfTrue, result);
+            binary(opPrecedence + 1, result, false);
+            patchJump(jump);
+            release(saved, result);
+            left = result;
+            continue;
+        }
+        
+        // The left side may be in the register the result gets, which is
+        // fine since operands are read before the result is written. A
+        // local on the left gets a spare register, in case the right side
+        // assigns it
+        _fs->top = (left >= saved) ? left + 1 : saved;
+        uint8_t spare = (left < _fs->locals.size()) ? allocRegister() : left;
+        uint32_t start = static_cast<uint32_t>(function().code.size());
+        uint8_t right = binary(opPrecedence + 1, NoRegister, false);
+        left = preserve(left, spare, start);
+        _fs->top = saved;
+        uint8_t result = target(dst);
+        emit(Instruction::abc(binaryOp(op), result, left, right));
+        left = result;
+    }
+    
+    uint8_t result = moveTo(left, dst);
+    release(saved, result);
+    return result;
+}
+
+uint8_t Compiler::unary(int16_t dst, bool canAssign)
+{
+    Token op = token();
+    if (op == Token::Minus || op == Token::Bang || op == Token::Twiddle) {
+        next();
+        
+        // Fold negative constants
+        if (op == Token::Minus && (token() == Token::Integer || token() == Token::Float)) {
+            bare::Float number = (token() == Token::Integer) ? bare::Float(static_cast<double>(value().integer)) : value().number;
+            next();
+            uint8_t result = target(dst);
+            emit(Instruction::abx(Op::LoadK, result, constant(-number)));
+            return result;
+        }
+        
+        uint32_t saved = _fs->top;
+        uint8_t operand = unary(NoRegister, false);
+        _fs->top = saved;
+        uint8_t result = target(dst);
+        emit(Instruction::abc((op == Token::Minus) ? Op::Neg : ((op == Token::Bang) ? Op::Not : Op::BitNot), result, operand));
+        return result;
+    }
+    
+    if (op == Token::INC || op == Token::DEC) {
+        next();
+        Atom name = identifier("variable after ++ or --");
+        if (failed()) {
+            return 0;
+        }
+        Op incOp = (op == Token::INC) ? Op::Inc : Op::Dec;
+        Variable variable = resolve(name);
+        if (variable.local) {
+            emit(Instruction::abc(incOp, variable.index, variable.index));
+            return moveTo(variable.index, dst);
+        }
+        uint8_t result = target(dst);
+        emit(Instruction::abx(Op::GetGlobal, result, variable.index));
+        emit(Instruction::abc(incOp, result, result));
+        emit(Instruction::abx(Op::SetGlobal, result, variable.index));
+        return result;
+    }
+    
+    return postfix(dst, canAssign);
+}
+
+uint8_t Compiler::postfix(int16_t dst, bool canAssign)
+{
+    uint8_t reg = primary(dst, canAssign);
+    while (!failed() && token() == Token::LParen) {
+        reg = call(reg, dst);
+    }
+    return reg;
+}
+
+uint8_t Compiler::primary(int16_t dst, bool canAssign)
+{
+    switch (token()) {
+        case Token::Integer:
+        case Token::Float: {
+            bare::Float number = (token() == Token::Integer) ? bare::Float(static_cast<double>(value().integer)) : value().number;
+            next();
+            uint8_t result = target(dst);
+            emit(Instruction::abx(Op::LoadK, result, constant(number)));
+            return result;
+        }
+        case Token::String: {
+            uint16_t index = string(value().atom);
+            next();
+            uint8_t result = target(dst);
+            emit(Instruction::abx(Op::LoadS, result, index));
+            return result;
+        }
+        case Token::True:
+        case Token::False:
+        case Token::Null: {
+            Op op = (token() == Token::True) ? Op::LoadTrue : ((token() == Token::False) ? Op::LoadFalse : Op::LoadNull);
+            next();
+            uint8_t result = target(dst);
+            emit(Instruction::abc(op, result));
+            return result;
+        }
+        case Token::LParen: {
+            next();
+            uint8_t result = expression(dst);
+            expect(Token::RParen, "')'");
+            return result;
+        }
+        case Token::Identifier: {
+            Atom name = value().atom;
+            next();
+            return variable(name, dst, canAssign);
+        }
+        default:
+            fail("expected an expression");
+            return 0;
+    }
+}
+
+uint8_t Compiler::variable(Atom name, int16_t dst, bool canAssign)
+{
+    Variable resolved = resolve(name);
+    Token op = token();
+    uint32_t saved = _fs->top;
+    
+    if (canAssign && op == Token::STO) {
+        next();
+        if (resolved.local) {
+            expression(resolved.index);
+            return moveTo(resolved.index, dst);
+        }
+        uint8_t reg = expression(dst);
+        emit(Instruction::abx(Op::SetGlobal, reg, resolved.index));
+        return reg;
+    }
+    
+    Op assignOp = compoundOp(op);
+    if (canAssign && assignOp != Op::Count) {
+        next();
+        if (resolved.local) {
+            uint8_t spare = allocRegister();
+            uint32_t start = static_cast<uint32_t>(function().code.size());
+            uint8_t operand = expression();
+            uint8_t current = preserve(static_cast<uint8_t>(resolved.index), spare, start);
+            emit(Instruction::abc(assignOp, resolved.index, current, operand));
+            _fs->top = saved;
+            return moveTo(resolved.index, dst);
+        }
+        uint8_t result = target(dst);
+        emit(Instruction::abx(Op::GetGlobal, result, resolved.index));
+        uint8_t operand = expression();
+        emit(Instruction::abc(assignOp, result, result, operand));
+        emit(Instruction::abx(Op::SetGlobal, result, resolved.index));
+        release(saved, result);
+        return result;
+    }
+    
+    if (op == Token::INC || op == Token::DEC) {
+        // The value is the one before the increment
+        next();
+        Op incOp = (op == Token::INC) ? Op::Inc : Op::Dec;
+        uint8_t result = target(dst);
+        if (resolved.local) {
+            emit(Instruction::abc(Op::Move, result, resolved.index));
+            emit(Instruction::abc(incOp, resolved.index, resolved.index));
+            return result;
+        }
+        emit(Instruction::abx(Op::GetGlobal, result, resolved.index));
+        uint8_t temp = allocRegister();
+        emit(Instruction::abc(incOp, temp, result));
+        emit(Instruction::abx(Op::SetGlobal, temp, resolved.index));
+        release(saved, result);
+        return result;
+    }
+    
+    if (resolved.local) {
+        return moveTo(resolved.index, dst);
+    }
+    uint8_t result = target(dst);
+    emit(Instruction::abx(Op::GetGlobal, result, resolved.index));
+    return result;
+}
+
+uint8_t Compiler::call(uint8_t callee, int16_t dst)
+{
+    next();
+    
+    // The function and its arguments go in consecutive registers, at the
+    // top so the callee's frame can start right after them
+    uint8_t base = callee;
+    if (callee + 1u != _fs->top || callee < _fs->locals.size()) {
+        base = allocRegister();
+        emit(Instruction::abc(Op::Move, base, callee));
+    }
+    
+    uint32_t args = 0;
+    if (!accept(Token::RParen)) {
+        do {
+            uint8_t arg = allocRegister();
+            expression(arg);
+            _fs->top = arg + 1u;
+            ++args;
+        } while (!failed() && accept(Token::Comma));
+        expect(Token::RParen, "')' after arguments");
+    }
+    if (args > 255) {
+        fail("too many arguments");
+    }
+    
+    emit(Instruction::abc(Op::Call, base, static_cast<uint8_t>(args)));
+    _fs->top = base + 1u;
+    return moveTo(base, dst);
+}
+
+uint32_t Compiler::emit(Instruction instruction)
+{
+    Function& fn = function();
+    fn.code.push_back(instruction);
+    fn.lines.push_back(static_cast<uint16_t>(_scanner.lineno()));
+    return static_cast<uint32_t>(fn.code.size() - 1);
+}
+
+uint32_t Compiler::emitJump(Op op, uint8_t a)
+{
+    return emit(Instruction::asbx(op, a, 0));
+}
+
+void Compiler::patchJump(uint32_t jump)
+{
+    patchJump(jump, static_cast<uint32_t>(function().code.size()));
+}
+
+void Compiler::patchJump(uint32_t jump, uint32_t target)
+{
+    int32_t offset = static_cast<int32_t>(target) - static_cast<int32_t>(jump + 1);
+    if (offset < -32768 || offset > 32767) {
+        fail("jump too far");
+        return;
+    }
+    Instruction& instruction = function().code[jump];
+    instruction = Instruction::asbx(instruction.op(), instruction.a(), static_cast<int16_t>(offset));
+}
+
+void Compiler::emitLoop(uint32_t target)
+{
+    patchJump(emitJump(Op::Jump), target);
+}
+
+uint8_t Compiler::allocRegister()
+{
+    if (_fs->top >= MaxRegisters) {
+        fail("expression too complex");
+        return 0;
+    }
+    uint8_t reg = static_cast<uint8_t>(_fs->top++);
+    if (function().registers < _fs->top) {
+        function().registers = static_cast<uint8_t>(_fs->top);
+    }
+    return reg;
+}
+
+// Where an expression should put a new value: dst if it's a temporary,
+// otherwise a new temporary. A named local can't be written until the
+// whole expression is done, in case the expression reads it later.
+uint8_t Compiler::target(int16_t dst)
+{
+    if (dst != NoRegister && static_cast<uint32_t>(dst) >= _fs->locals.size()) {
+        return static_cast<uint8_t>(dst);
+    }
+    return allocRegister();
+}
+
+uint8_t Compiler::moveTo(uint8_t reg, int16_t dst)
+{
+    if (dst == NoRegister || reg == dst) {
+        return reg;
+    }
+    emit(Instruction::abc(Op::Move, static_cast<uint8_t>(dst), reg));
+    return static_cast<uint8_t>(dst);
+}
+
+// local was read before the code from start on, which may assign it, as
+// in a + a++ or c += (c = 10). If it does, the value from before is copied
+// to spare ahead of that code, and spare is returned instead. Any
+// instruction with local as its a operand is taken to write it, so
+// sometimes the copy isn't needed.
+uint8_t Compiler::preserve(uint8_t local, uint8_t spare, uint32_t start)
+{
+    if (spare == local) {
+        return local;
+    }
+    Function& fn = function();
+    for (size_t i = start; i < fn.code.size(); ++i) {
+        if (fn.code[i].a() == local) {
+            // Jumps are relative, so inserting ahead of the whole of the
+            // code leaves any inside it correct
+            fn.code.insert(fn.code.begin() + start, Instruction::abc(Op::Move, spare, local));
+            fn.lines.insert(fn.lines.begin() + start, fn.lines[start]);
+            return spare;
+        }
+    }
+    return local;
+}
+
+// Free the temporaries above saved, except the one holding the result
+void Compiler::release(uint32_t saved, uint8_t result)
+{
+    _fs->top = (result + 1u > saved) ? result + 1u : saved;
+}
+
+Compiler::Variable Compiler::resolve(Atom name)
+{
+    if (!_fs->topLevel) {
+        for (size_t i = _fs->locals.size(); i > 0; --i) {
+            if (_fs->locals[i - 1] == name) {
+                return { true, static_cast<uint16_t>(i - 1) };
+            }
+        }
+    }
+    return { false, global(name) };
+}
+
+// Atoms are dense, so the slot of each is kept in a table indexed by atom
+uint16_t Compiler::global(Atom name)
+{
+    if (name >= _globalSlots.size()) {
+        _globalSlots.resize(atoms().size(), NoSlot);
+    }
+    if (_globalSlots[name] != NoSlot) {
+        return _globalSlots[name];
+    }
+    
+    std::vector<bare::String>& globals = _program->_globals;
+    if (globals.size() >= NoSlot) {
+        fail("too many globals");
+        return 0;
+    }
+    globals.push_back(atoms().name(name));
+    _globalSlots[name] = static_cast<uint16_t>(globals.size() - 1);
+    return _globalSlots[name];
+}
+
+uint16_t Compiler::constant(bare::Float number)
+{
+    std::vector<bare::Float>& constants = _program->_constants;
+    for (size_t i = 0; i < constants.size(); ++i) {
+        if (constants[i] == number) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+    if (constants.size() >= 0xffff) {
+        fail("too many constants");
+        return 0;
+    }
+    constants.push_back(number);
+    return static_cast<uint16_t>(constants.size() - 1);
+}
+
+uint16_t Compiler::string(Atom s)
+{
+    if (s >= _stringSlots.size()) {
+        _stringSlots.resize(atoms().size(), NoSlot);
+    }
+    if (_stringSlots[s] != NoSlot) {
+        return _stringSlots[s];
+    }
+    
+    std::vector<bare::String>& strings = _program->_strings;
+    if (strings.size() >= NoSlot) {
+        fail("too many strings");
+        return 0;
+    }
+    strings.push_back(bare::String(atoms().name(s), static_cast<int32_t>(atoms().length(s))));
+    _stringSlots[s] = static_cast<uint16_t>(strings.size() - 1);
+    return _stringSlots[s];
+}
+
+bool Compiler::accept(Token expected)
+{
+    if (token() != expected) {
+        return false;
+    }
+    next();
+    return true;
+}
+
+bool Compiler::expect(Token expected, const char* what)
+{
+    if (accept(expected)) {
+        return true;
+    }
+    bare::String message = "expected ";
+    message += what;
+    fail(message.c_str());
+    return false;
+}
+
+Atom Compiler::identifier(const char* what)
+{
+    if (token() != Token::Identifier) {
+        bare::String message = "expected ";
+        message += what;
+        fail(message.c_str());
+        return NoAtom;
+    }
+    Atom name = value().atom;
+    next();
+    return name;
+}
+
+void Compiler::fail(const char* message)
+{
+    if (failed()) {
+        return;
+    }
+    _error = message;
+    _errorLine = _scanner.lineno();
+}
@@ -0,0 +1,173 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Program.h"
+#include "Scanner.h"
+#include "bare/Arena.h"
+
+namespace placid {
+
+    // Compiler - Single pass compiler from script source to bytecode
+    //
+    // Code is generated as the tokens are parsed, with no syntax tree. The
+    // language is a subset of JavaScript: var, function (at the top level),
+    // if, else, while, for, break, continue and return; numbers, strings,
+    // true, false and null; assignment and compound assignment, ?:, || and
+    // &&, the comparison, arithmetic and bitwise operators, ++ and --, and
+    // calls. Top level vars are globals, vars in functions are registers.
+    //
+    // Each expression leaves its value in a register. A local variable is
+    // its own register, so reading one costs nothing. Temporaries are taken
+    // from above the locals and released at the end of each statement.
+    //
+    // The bookkeeping for functions and loops being compiled comes from an
+    // Arena, released in one shot at the end of compile().
+    class Compiler
+    {
+    public:
+        Compiler(Stream* stream) : _scanner(stream) { }
+        
+        // Returns false on a syntax error, described by error() and line()
+        bool compile(Program&);
+        
+        const char* error() const { return _error.c_str(); }
+        uint32_t line() const { return _errorLine; }
+        
+        // Binding strength of the binary operators, 0 for other tokens
+        static uint8_t precedence(Token);
+        
+    private:
+        static constexpr uint32_t MaxRegisters = 250;
+        static constexpr int16_t NoRegister = -1;
+        static constexpr uint16_t NoSlot = 0xffff;
+        
+        template<typename T> using ScratchVector = std::vector<T, bare::ArenaAllocator<T>>;
+        
+        struct Loop
+        {
+            Loop(bare::Arena& arena) : breaks(arena), continues(arena) { }
+            
+            ScratchVector<uint32_t> breaks;
+            ScratchVector<uint32_t> continues;
+        };
+        
+        // A variable, resolved at compile time
+        struct Variable
+        {
+            bool local;
+            uint16_t index; // register or global slot
+        };
+        
+        // Compile state of the function being compiled
+        struct FunctionState
+        {
+            FunctionState(bare::Arena& arena) : locals(arena), loops(arena) { }
+            
+            uint32_t index; // in Program::_functions, which may move as it grows
+            ScratchVector<Atom> locals; // names of registers 0 to n - 1
+            uint32_t top = 0; // first free register
+            bool topLevel = false;
+            ScratchVector<Loop> loops;
+        };
+        
+        // Statements
+        void statement();
+        void block();
+        void varStatement();
+        void functionDeclaration();
+        void ifStatement();
+        void whileStatement();
+        void forStatement();
+        void jumpStatement(bool isBreak);
+        void returnStatement();
+        void endStatement();
+        void endLoop(uint32_t continueTarget);
+        void patchBreaks();
+        void discardResult(uint32_t start);
+        
+        // Expressions. Each returns the register holding the value. If dst
+        // is a register the value ends up there
+        uint8_t expression(int16_t dst = NoRegister);
+        uint8_t conditional(int16_t dst, bool canAssign);
+        uint8_t binary(uint8_t minPrecedence, int16_t dst, bool canAssign);
+        uint8_t unary(int16_t dst, bool canAssign);
+        uint8_t postfix(int16_t dst, bool canAssign);
+        uint8_t primary(int16_t dst, bool canAssign);
+        uint8_t variable(Atom name, int16_t dst, bool canAssign);
+        uint8_t call(uint8_t callee, int16_t dst);
+        
+        // Code generation
+        uint32_t emit(Instruction);
+        uint32_t emitJump(Op, uint8_t a = 0);
+        void patchJump(uint32_t jump);
+        void patchJump(uint32_t jump, uint32_t target);
+        void emitLoop(uint32_t target);
+        uint8_t allocRegister();
+        uint8_t target(int16_t dst);
+        uint8_t moveTo(uint8_t reg, int16_t dst);
+        uint8_t preserve(uint8_t local, uint8_t spare, uint32_t start);
+        void release(uint32_t saved, uint8_t result);
+        Function& function() { return _program->_functions[_fs->index]; }
+        
+        Variable resolve(Atom name);
+        uint16_t global(Atom name);
+        uint16_t constant(bare::Float);
+        uint16_t string(Atom);
+        
+        // Tokens
+        AtomTable& atoms() { return _scanner.atoms(); }
+        Token token() { return _scanner.getToken(); }
+        const Scanner::TokenType& value() { return _scanner.getTokenValue(); }
+        void next() { _scanner.retireToken(); }
+        bool accept(Token);
+        bool expect(Token, const char* what);
+        Atom identifier(const char* what);
+        
+        void fail(const char* message);
+        bool failed() const { return !_error.empty(); }
+        
+        Scanner _scanner;
+        bare::Arena _arena;
+        Program* _program = nullptr;
+        FunctionState* _fs = nullptr;
+        std::vector<uint16_t> _globalSlots; // by atom
+        std::vector<uint16_t> _stringSlots; // by atom
+        bare::String _error;
+        uint32_t _errorLine = 0;
+    };
+
+}
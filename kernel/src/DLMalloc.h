@@ -0,0 +1,67 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare/Memory.h"
+#include <cstddef>
+
+// The parts of dlmalloc.cpp the kernel uses. It is built with USE_DL_PREFIX
+// and MSPACES, so none of these collide with malloc and free.
+
+extern "C" {
+    void* dlmalloc(size_t);
+    void dlfree(void*);
+    void* dlrealloc_in_place(void*, size_t);
+    void* dlmemalign(size_t alignment, size_t);
+    size_t dlmalloc_footprint();
+    
+    void* create_mspace(size_t capacity, int locked);
+    void* create_mspace_with_base(void* base, size_t capacity, int locked);
+    size_t destroy_mspace(void* msp);
+    int mspace_track_large_chunks(void* msp, int enable);
+    size_t mspace_set_footprint_limit(void* msp, size_t bytes);
+    void* mspace_malloc(void* msp, size_t bytes);
+    void mspace_free(void* msp, void* mem);
+    size_t mspace_footprint(void* msp);
+}
+
+namespace placid {
+
+    // Bytes of msp below its top chunk, which is as far into its memory
+    // as it has ever handed out
+    size_t mspaceExtent(void* msp);
+
+}
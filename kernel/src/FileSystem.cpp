@@ -38,6 +38,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "FileSystem.h"
 
 #include "bare/Serial.h"
+#include "bare/Trace.h"
 
 using namespace placid;
 
@@ -58,7 +59,7 @@ FileSystem::FileSystem()
     // partition 0 of the SD card
     bare::Volume::Error e = _fatFS.mount();
     if (e != bare::Volume::Error::OK) {
-        bare::Serial::printf("*** error mounting:%s\n", _fatFS.errorDetail(e));
+        bare::Serial::printf(FMT("*** error mounting:%s\n"), _fatFS.errorDetail(e));
         return;
     }
 }
@@ -95,6 +96,7 @@ File* FileSystem::open(const char* name, OpenMode mode, OpenOption option)
         return fp;
     }
 
+    fp->_blocksPerCluster = _fatFS.blocksPerCluster();
     fp->_canRead = mode == OpenMode::Read;
     fp->_canWrite = mode != OpenMode::Read;
     fp->_appendOnly = mode == OpenMode::Append;
@@ -135,6 +137,7 @@ bool File::prepareBuffer(uint32_t offset)
 
 int32_t File::io(char* buf, uint32_t size, bool write)
 {
+    TRACE_SCOPE("file.io");
     if (!prepareBuffer(_offset)) {
         return -1;
     }
@@ -156,6 +159,32 @@ int32_t File::io(char* buf, uint32_t size, bool write)
     }
 
     while (1) {
+        // Whole blocks read into an aligned destination skip the buffer,
+        // as many at a time as the current cluster holds
+        if (!write && !_bufferValid && !_bufferNeedsWriting && bufferOffset == 0 &&
+                sizeRemaining >= bare::BlockSize && (reinterpret_cast<uintptr_t>(buf) & 0x03) == 0) {
+            uint32_t blocks = sizeRemaining / bare::BlockSize;
+            uint32_t blocksInCluster = _blocksPerCluster - bufferAddr % _blocksPerCluster;
+            if (blocks > blocksInCluster) {
+                blocks = blocksInCluster;
+            }
+            
+            _error = _rawFile->read(buf, bufferAddr, blocks);
+            if (_error != bare::Volume::Error::OK) {
+                return -1;
+            }
+            
+            uint32_t amount = blocks * bare::BlockSize;
+            bufferAddr += blocks;
+            _offset += amount;
+            buf += amount;
+            sizeRemaining -= amount;
+            if (sizeRemaining == 0) {
+                return size;
+            }
+            continue;
+        }
+        
         if (!_bufferValid) {
             bare::Volume::Error error = write ? 
                 _rawFile->write(_buffer, bufferAddr, 1) :
@@ -74,6 +74,7 @@ namespace placid {
         
         bare::Volume::Error create(const char* name);
         bare::Volume::Error remove(const char* name);
+        bool exists(const char* name) { return _fatFS.exists(name); }
 
         const char* errorDetail(bare::Volume::Error error) const { return _fatFS.errorDetail(error); }
         
@@ -102,6 +103,7 @@ namespace placid {
         int32_t write(const char* buf, uint32_t size);
         
         uint32_t size() const { return _rawFile->size(); }
+        uint32_t clusterSize() const { return _blocksPerCluster * bare::BlockSize; }
         
         bare::Volume::Error rename(const char* to) { return _rawFile->rename(to); }
     
@@ -128,6 +130,7 @@ namespace placid {
         bool _appendOnly;
         bool _needsSizeUpate = false;
         uint32_t _bufferAddr = 0; // Block addr of the contents of the buffer, if any
+        uint32_t _blocksPerCluster = 1;
 
         // RawFile has a requirement for 4 byte alignment
         char _buffer[bare::BlockSize] __attribute__((aligned(4)));
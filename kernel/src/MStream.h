@@ -35,6 +35,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "Allocator.h"
+#include "FileSystem.h"
 #include "bare/String.h"
 #include <cstdint>
 
@@ -50,12 +52,46 @@ namespace placid {
 
     class Stream {
     public:
+        // A run of input from the current position. Empty at end of input
+        struct Span
+        {
+            const uint8_t* cursor;
+            const uint8_t* end;
+            
+            bool empty() const { return cursor == end; }
+        };
+        
+        virtual ~Stream() { }
+        
         virtual bool eof() const = 0;
         virtual int read() const = 0;
         virtual int write(uint8_t) = 0;
         virtual void flush() = 0;
         
+        // Chunked input, for readers which would otherwise make a pair of
+        // virtual calls per character. fill() hands over the next run of
+        // input, which stays valid until the next call, and moves past it.
+        // The reader walks the span itself and calls fill() again when it
+        // reaches the end. A reader uses either this or read(), not both.
+        // This version gathers a chunk with read(). Streams over memory
+        // return all of their remaining contents at once.
+        virtual Span fill()
+        {
+            uint32_t size = 0;
+            while (size < ChunkSize && !eof()) {
+                int c = read();
+                if (c < 0) {
+                    break;
+                }
+                _chunk[size++] = static_cast<uint8_t>(c);
+            }
+            return { _chunk, _chunk + size };
+        }
+        
     private:
+        static constexpr uint32_t ChunkSize = 32;
+        
+        uint8_t _chunk[ChunkSize];
     };
 
     //////////////////////////////////////////////////////////////////////////////
@@ -67,52 +103,85 @@ namespace placid {
     //////////////////////////////////////////////////////////////////////////////
 
     class FileStream : public Stream {
-    //public:
-    //    FileStream(FS* fs, const char* file, const char* mode = "r")
-    //    {
-    //        _file = fs->open(file, mode);
-    //    }
-    //
-    //    ~FileStream()
-    //    {
-    //        if (_file) {
-    //            delete _file;
-    //        }
-    //    }
-    //    
-    //    bool loaded()
-    //    {
-    //        return _file && _file->valid();
-    //    }
-    //    virtual bool eof() const override
-    //    {
-    //        return !_file || _file->eof();
-    //    }
-    //    virtual int read() const override
-    //    {
-    //        if (!_file) {
-    //            return -1;
-    //        }
-    //        char c;
-    //        if (_file->read(&c, 1) != 1) {
-    //            return -1;
-    //        }
-    //        return static_cast<uint8_t>(c);
-    //    }
-    //    virtual int write(uint8_t c) override
-    //    {
-    //        if (!_file) {
-    //            return -1;
-    //        }
-    //        if (_file->write(reinterpret_cast<char*>(&c), 1) != 1) {
-    //            return -1;
-    //        }
-    //        return c;
-    //    }
-    //    virtual void flush() override { }
-    //    
-    //private:
-    //    File* _file = nullptr;
+    public:
+        // In Read mode, reads go through a buffer the size of a cluster,
+        // which the file system fills straight from the card. In the other
+        // modes there is no buffer and writes go to the File unbuffered
+        FileStream(const char* name, FileSystem::OpenMode mode = FileSystem::OpenMode::Read)
+            : _file(FileSystem::sharedFileSystem()->open(name, mode))
+            , _reading(mode == FileSystem::OpenMode::Read)
+        {
+            if (_reading && _file->valid()) {
+                _buffer.allocate(_file->clusterSize());
+            }
+        }
+        
+        virtual ~FileStream()
+        {
+            delete _file;
+        }
+        
+        bool loaded() const
+        {
+            return _file->valid() && (!_reading || _buffer.valid());
+        }
+        virtual bool eof() const override
+        {
+            return _cursor == _end && (!readable() || _file->eof());
+        }
+        virtual int read() const override
+        {
+            if (_cursor == _end && !load()) {
+                return -1;
+            }
+            return *_cursor++;
+        }
+        virtual int write(uint8_t c) override
+        {
+            if (_file->write(reinterpret_cast<char*>(&c), 1) != 1) {
+                return -1;
+            }
+            return c;
+        }
+        virtual void flush() override { _file->flush(); }
+        
+        virtual Span fill() override
+        {
+            if (_cursor == _end) {
+                load();
+            }
+            Span span = { _cursor, _end };
+            _cursor = _end;
+            return span;
+        }
+        
+    private:
+        bool readable() const { return _file->valid() && _buffer.valid(); }
+        
+        // Refill the buffer from the file position. False at end of file
+        // or on error
+        bool load() const
+        {
+            _cursor = _end = nullptr;
+            if (!readable() || _file->eof()) {
+                return false;
+            }
+            uint32_t remaining = _file->size() - static_cast<uint32_t>(_file->tell());
+            uint32_t size = (remaining < _buffer.size()) ? remaining : static_cast<uint32_t>(_buffer.size());
+            int32_t result = _file->read(reinterpret_cast<char*>(_buffer.data()), size);
+            if (result <= 0) {
+                return false;
+            }
+            _cursor = _buffer.data();
+            _end = _cursor + result;
+            return true;
+        }
+        
+        File* _file;
+        bool _reading;
+        mutable AlignedBuffer _buffer;
+        mutable const uint8_t* _cursor = nullptr;
+        mutable const uint8_t* _end = nullptr;
     };
 
     //////////////////////////////////////////////////////////////////////////////
@@ -140,6 +209,13 @@ namespace placid {
         {
             return (_index < _string.size()) ? _string[_index++] : -1;
         }
+        virtual Span fill() override
+        {
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(_string.c_str());
+            Span span = { data + _index, data + _string.size() };
+            _index = static_cast<uint32_t>(_string.size());
+            return span;
+        }
         virtual int write(uint8_t c) override
         {
             // Only allow writing to the end of the string
@@ -181,6 +257,12 @@ namespace placid {
         {
             return (_index < _vector.size()) ? _vector[_index++] : -1;
         }
+        virtual Span fill() override
+        {
+            Span span = { _vector.data() + _index, _vector.data() + _vector.size() };
+            _index = static_cast<uint32_t>(_vector.size());
+            return span;
+        }
         virtual int write(uint8_t c) override
         {
             // Only allow writing to the end of the vector
@@ -200,4 +282,41 @@ namespace placid {
         mutable uint32_t _index;
     };
 
+    //////////////////////////////////////////////////////////////////////////////
+    //
+    //  Class: MemoryStream
+    //
+    //  Reads memory owned by someone else, without copying it
+    //
+    //////////////////////////////////////////////////////////////////////////////
+
+    class MemoryStream : public Stream {
+    public:
+        MemoryStream(const uint8_t* data, size_t size) : _cursor(data), _end(data + size) { }
+        
+        virtual ~MemoryStream() { }
+        
+        bool loaded() { return true; }
+        virtual bool eof() const override
+        {
+            return _cursor == _end;
+        }
+        virtual int read() const override
+        {
+            return (_cursor < _end) ? *_cursor++ : -1;
+        }
+        virtual Span fill() override
+        {
+            Span span = { _cursor, _end };
+            _cursor = _end;
+            return span;
+        }
+        virtual int write(uint8_t) override { return -1; }
+        virtual void flush() override { }
+        
+    private:
+        mutable const uint8_t* _cursor;
+        const uint8_t* _end;
+    };
+
 }
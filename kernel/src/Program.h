@@ -0,0 +1,157 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Value.h"
+#include "bare/String.h"
+#include <cstdint>
+#include <vector>
+
+namespace placid {
+
+    // Bytecode instructions
+    //
+    // Each is a 32 bit word with an 8 bit opcode and three 8 bit operands,
+    // A, B and C, or A and a 16 bit Bx. Registers are numbered from the base
+    // of the current call frame. Jump offsets are signed and relative to the
+    // next instruction.
+    //
+    //      Move        R[A] = R[B]
+    //      LoadK       R[A] = K[Bx]            number constant
+    //      LoadS       R[A] = S[Bx]            string constant
+    //      LoadNull    R[A] = null
+    //      LoadTrue    R[A] = true
+    //      LoadFalse   R[A] = false
+    //      GetGlobal   R[A] = G[Bx]
+    //      SetGlobal   G[Bx] = R[A]
+    //      Add .. UShr R[A] = R[B] op R[C]     UShr is >>>
+    //      Eq .. Ge    R[A] = R[B] op R[C]
+    //      Inc, Dec    R[A] = R[B] +/- 1
+    //      Neg, Not, BitNot    R[A] = op R[B]
+    //      Jump        pc += sBx
+    //      JumpIfFalse if !R[A] pc += sBx
+    //      JumpIfTrue  if R[A] pc += sBx
+    //      Call        R[A] = R[A](R[A+1] .. R[A+B])
+    //      Return      return R[A]
+    //      ReturnNull  return null
+    //
+    // The list is an X macro so the VM's dispatch table stays in step
+    #define PLACID_OPS(X) \
+        X(Move) X(LoadK) X(LoadS) X(LoadNull) X(LoadTrue) X(LoadFalse) \
+        X(GetGlobal) X(SetGlobal) \
+        X(Add) X(Sub) X(Mul) X(Div) X(Mod) \
+        X(BitAnd) X(BitOr) X(BitXor) X(Shl) X(Shr) X(UShr) \
+        X(Eq) X(Ne) X(Lt) X(Le) X(Gt) X(Ge) \
+        X(Inc) X(Dec) X(Neg) X(Not) X(BitNot) \
+        X(Jump) X(JumpIfFalse) X(JumpIfTrue) \
+        X(Call) X(Return) X(ReturnNull)
+
+    #define PLACID_OP_ENUM(name) name,
+    enum class Op : uint8_t { PLACID_OPS(PLACID_OP_ENUM) Count };
+    #undef PLACID_OP_ENUM
+    
+    class Instruction
+    {
+    public:
+        Instruction() { }
+        
+        static Instruction abc(Op op, uint8_t a, uint8_t b = 0, uint8_t c = 0)
+        {
+            return Instruction(static_cast<uint32_t>(op) | (a << 8) | (b << 16) | (c << 24));
+        }
+        static Instruction abx(Op op, uint8_t a, uint16_t bx) { return Instruction(static_cast<uint32_t>(op) | (a << 8) | (bx << 16)); }
+        static Instruction asbx(Op op, uint8_t a, int16_t sbx) { return abx(op, a, static_cast<uint16_t>(sbx)); }
+        
+        Op op() const { return static_cast<Op>(_word & 0xff); }
+        uint8_t a() const { return static_cast<uint8_t>(_word >> 8); }
+        uint8_t b() const { return static_cast<uint8_t>(_word >> 16); }
+        uint8_t c() const { return static_cast<uint8_t>(_word >> 24); }
+        uint16_t bx() const { return static_cast<uint16_t>(_word >> 16); }
+        int16_t sbx() const { return static_cast<int16_t>(_word >> 16); }
+        
+    private:
+        Instruction(uint32_t word) : _word(word) { }
+        
+        uint32_t _word = 0;
+    };
+    
+    // Functions built into the VM, which scripts see as globals
+    //
+    //      print(...)  print the arguments separated by spaces, then a newline
+    //      time()      milliseconds since boot
+    //      sleep(ms)   wait for ms milliseconds
+    enum class Native : uint8_t { Print, Time, Sleep, Count };
+    
+    static inline const char* nativeName(Native native)
+    {
+        static const char* names[] = { "print", "time", "sleep" };
+        return names[static_cast<uint8_t>(native)];
+    }
+    
+    // Function - The code for one script function
+    struct Function
+    {
+        bare::String name;
+        uint8_t params = 0;
+        uint8_t registers = 0;
+        uint16_t global = 0; // slot holding the function
+        std::vector<Instruction> code;
+        std::vector<uint16_t> lines; // source line of each instruction
+    };
+    
+    // Program - The output of Compiler, run by VM
+    //
+    // Function 0 is the top level code of the script. Globals are numbered
+    // by the compiler, with the natives first.
+    class Program
+    {
+        friend class Compiler;
+        friend class ProgramImage;
+        
+    public:
+        const std::vector<Function>& functions() const { return _functions; }
+        const std::vector<bare::Float>& constants() const { return _constants; }
+        const std::vector<bare::String>& strings() const { return _strings; }
+        const std::vector<bare::String>& globals() const { return _globals; }
+        
+    private:
+        std::vector<Function> _functions;
+        std::vector<bare::Float> _constants;
+        std::vector<bare::String> _strings;
+        std::vector<bare::String> _globals;
+    };
+
+}
@@ -0,0 +1,418 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "ProgramImage.h"
+
+#include "Allocator.h"
+#include "Compiler.h"
+#include "FileSystem.h"
+#include "MStream.h"
+#include "bare/Trace.h"
+
+using namespace placid;
+
+constexpr uint32_t ProgramImage::Magic;
+
+// Bumped when the layout of the image changes
+static constexpr uint32_t ImageLayout = 2;
+
+// Images hold opcodes by number, so the version is a hash of the op names
+// in order as well as the layout. An image from a build with other ops is
+// recompiled rather than run.
+static constexpr uint16_t versionHash(const char* names, uint32_t layout)
+{
+    uint32_t h = 2166136261u ^ layout;
+    for ( ; *names; ++names) {
+        h = (h ^ static_cast<uint8_t>(*names)) * 16777619u;
+    }
+    return static_cast<uint16_t>(h ^ (h >> 16));
+}
+
+#define PLACID_OP_NAME(name) #name " "
+static constexpr uint16_t Version = versionHash(PLACID_OPS(PLACID_OP_NAME), ImageLayout);
+#undef PLACID_OP_NAME
+
+// Sequential writes into a growing buffer
+class ImageWriter
+{
+public:
+    void put(const void* data, size_t size)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        _buffer.insert(_buffer.end(), p, p + size);
+    }
+    
+    template<typename T>
+    void put(const T& value) { put(&value, sizeof(T)); }
+    
+    void putString(const bare::String& s)
+    {
+        put(static_cast<uint32_t>(s.size()));
+        put(s.c_str(), s.size());
+    }
+    
+    std::vector<uint8_t>& buffer() { return _buffer; }
+    
+private:
+    std::vector<uint8_t> _buffer;
+};
+
+// Sequential reads from an image in memory. Any read past the end fails
+// and so does every one after it
+class ImageReader
+{
+public:
+    ImageReader(const uint8_t* data, size_t size) : _cursor(data), _end(data + size) { }
+    
+    bool get(void* data, size_t size)
+    {
+        if (!_ok || static_cast<size_t>(_end - _cursor) < size) {
+            _ok = false;
+            return false;
+        }
+        bare::memcpy(data, _cursor, size);
+        _cursor += size;
+        return true;
+    }
+    
+    template<typename T>
+    bool get(T& value) { return get(&value, sizeof(T)); }
+    
+    bool getString(bare::String& s)
+    {
+        uint32_t size;
+        if (!get(size) || static_cast<size_t>(_end - _cursor) < size) {
+            _ok = false;
+            return false;
+        }
+        s = bare::String(reinterpret_cast<const char*>(_cursor), static_cast<int32_t>(size));
+        _cursor += size;
+        return true;
+    }
+    
+    template<typename T>
+    bool getVector(std::vector<T>& vector, uint32_t count)
+    {
+        if (!_ok || static_cast<size_t>(_end - _cursor) / sizeof(T) < count) {
+            _ok = false;
+            return false;
+        }
+        vector.resize(count);
+        return get(vector.data(), count * sizeof(T));
+    }
+    
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _cursor == _end; }
+    
+private:
+    const uint8_t* _cursor;
+    const uint8_t* _end;
+    bool _ok = true;
+};
+
+// Reads all of a file into buffer with one read
+static bool readFile(const char* name, AlignedBuffer& buffer)
+{
+    File* fp = FileSystem::sharedFileSystem()->open(name);
+    bool ok = fp->valid() && buffer.allocate(fp->size() ? fp->size() : 1) &&
+              fp->read(reinterpret_cast<char*>(buffer.data()), fp->size()) == static_cast<int32_t>(fp->size());
+    if (ok && fp->size() == 0) {
+        buffer.release();
+    }
+    delete fp;
+    return ok;
+}
+
+ProgramImage::ProgramImage(const char* source)
+    : _source(source)
+    , _image(imageName(source))
+{
+}
+
+bare::String ProgramImage::imageName(const char* source)
+{
+    const char* dot = nullptr;
+    for (const char* p = source; *p; ++p) {
+        if (*p == '.') {
+            dot = p;
+        } else if (*p == '/') {
+            dot = nullptr;
+        }
+    }
+    bare::String name(source, dot ? static_cast<int32_t>(dot - source) : -1);
+    name += ".pbc";
+    return name;
+}
+
+ProgramImage::Status ProgramImage::load(Program& program)
+{
+    TRACE_SCOPE("ProgramImage::load");
+    
+    _error.clear();
+    _line = 0;
+    
+    AlignedBuffer source;
+    if (!readFile(_source.c_str(), source)) {
+        return Status::NotFound;
+    }
+    uint32_t sourceSize = static_cast<uint32_t>(source.size());
+    uint32_t sourceHash = bare::hash(source.data(), source.size());
+    
+    if (read(program, sourceSize, sourceHash)) {
+        return Status::Cached;
+    }
+    
+    MemoryStream stream(source.data(), source.size());
+    Compiler compiler(&stream);
+    if (!compiler.compile(program)) {
+        _error = compiler.error();
+        _line = compiler.line();
+        return Status::Error;
+    }
+    
+    // Failing to save the image only costs a compile next time
+    write(program, sourceSize, sourceHash);
+    return Status::Compiled;
+}
+
+bool ProgramImage::read(Program& program, uint32_t sourceSize, uint32_t sourceHash)
+{
+    if (!FileSystem::sharedFileSystem()->exists(_image.c_str())) {
+        return false;
+    }
+    AlignedBuffer image;
+    return readFile(_image.c_str(), image) && decode(image.data(), image.size(), sourceSize, sourceHash, program);
+}
+
+// The VM doesn't check operands as it runs, so a damaged image could
+// make it read or write outside its registers and tables. Each
+// instruction must be a known op whose registers are in its function's
+// frame, whose constant, string and global indexes are in range and
+// whose jump lands in the function. The last instruction can't fall
+// through to past the end.
+static bool validate(const Program& program)
+{
+    const std::vector<Function>& functions = program.functions();
+    uint32_t constants = static_cast<uint32_t>(program.constants().size());
+    uint32_t strings = static_cast<uint32_t>(program.strings().size());
+    uint32_t globals = static_cast<uint32_t>(program.globals().size());
+    
+    // The natives are the first globals
+    if (functions.empty() || globals < static_cast<uint32_t>(Native::Count)) {
+        return false;
+    }
+    
+    for (const Function& function : functions) {
+        const std::vector<Instruction>& code = function.code;
+        uint32_t registers = function.registers;
+        int32_t size = static_cast<int32_t>(code.size());
+        if (code.empty() || function.params > registers || function.global >= globals) {
+            return false;
+        }
+        
+        Op last = code.back().op();
+        if (last != Op::Return && last != Op::ReturnNull && last != Op::Jump) {
+            return false;
+        }
+        
+        for (int32_t pc = 0; pc < size; ++pc) {
+            Instruction i = code[pc];
+            bool valid;
+            switch (i.op()) {
+                case Op::LoadNull:
+                case Op::LoadTrue:
+                case Op::LoadFalse:
+                case Op::Return:
+                    valid = i.a() < registers;
+                    break;
+                case Op::LoadK:
+                    valid = i.a() < registers && i.bx() < constants;
+                    break;
+                case Op::LoadS:
+                    valid = i.a() < registers && i.bx() < strings;
+                    break;
+                case Op::GetGlobal:
+                case Op::SetGlobal:
+                    valid = i.a() < registers && i.bx() < globals;
+                    break;
+                case Op::Move:
+                case Op::Inc:
+                case Op::Dec:
+                case Op::Neg:
+                case Op::Not:
+                case Op::BitNot:
+                    valid = i.a() < registers && i.b() < registers;
+                    break;
+                case Op::Add: case Op::Sub: case Op::Mul: case Op::Div: case Op::Mod:
+                case Op::BitAnd: case Op::BitOr: case Op::BitXor:
+                case Op::Shl: case Op::Shr: case Op::UShr:
+                case Op::Eq: case Op::Ne: case Op::Lt: case Op::Le: case Op::Gt: case Op::Ge:
+                    valid = i.a() < registers && i.b() < registers && i.c() < registers;
+                    break;
+                case Op::Jump:
+                case Op::JumpIfFalse:
+                case Op::JumpIfTrue: {
+                    int32_t target = pc + 1 + i.sbx();
+                    valid = (i.op() == Op::Jump || i.a() < registers) && target >= 0 && target < size;
+                    break;
+                }
+                case Op::Call:
+                    // The function and its arguments
+                    valid = static_cast<uint32_t>(i.a()) + i.b() < registers;
+                    break;
+                case Op::ReturnNull:
+                    valid = true;
+                    break;
+                default:
+                    valid = false;
+                    break;
+            }
+            if (!valid) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ProgramImage::decode(const uint8_t* data, size_t size, uint32_t sourceSize, uint32_t sourceHash, Program& program)
+{
+    ImageReader reader(data, size);
+    Header header;
+    if (!reader.get(header) || header.magic != Magic || header.version != Version ||
+            header.floatFormat != floatFormat() || header.imageSize != size ||
+            header.sourceSize != sourceSize || header.sourceHash != sourceHash) {
+        return false;
+    }
+    
+    if (header.checksum != bare::hash(data + sizeof(Header), size - sizeof(Header))) {
+        return false;
+    }
+    
+    // Counts are checked against the size before anything is allocated
+    if (header.functions > size || header.strings > size || header.globals > size) {
+        return false;
+    }
+    
+    Program result;
+    result._functions.resize(header.functions);
+    for (Function& function : result._functions) {
+        uint32_t codeSize = 0;
+        reader.getString(function.name);
+        reader.get(function.params);
+        reader.get(function.registers);
+        reader.get(function.global);
+        reader.get(codeSize);
+        reader.getVector(function.code, codeSize);
+        reader.getVector(function.lines, codeSize);
+    }
+    reader.getVector(result._constants, header.constants);
+    
+    result._strings.resize(header.strings);
+    for (bare::String& s : result._strings) {
+        reader.getString(s);
+    }
+    result._globals.resize(header.globals);
+    for (bare::String& s : result._globals) {
+        reader.getString(s);
+    }
+    
+    if (!reader.ok() || !reader.atEnd() || !validate(result)) {
+        return false;
+    }
+    program = std::move(result);
+    return true;
+}
+
+bool ProgramImage::write(const Program& program, uint32_t sourceSize, uint32_t sourceHash)
+{
+    std::vector<uint8_t> image;
+    encode(program, sourceSize, sourceHash, image);
+    uint32_t imageSize = static_cast<uint32_t>(image.size());
+    
+    // Write mode won't replace a file, so remove the stale image first
+    FileSystem* fs = FileSystem::sharedFileSystem();
+    if (fs->exists(_image.c_str()) && fs->remove(_image.c_str()) != bare::Volume::Error::OK) {
+        return false;
+    }
+    File* fp = fs->open(_image.c_str(), FileSystem::OpenMode::Write);
+    bool ok = fp->valid() && fp->write(reinterpret_cast<const char*>(image.data()), imageSize) == static_cast<int32_t>(imageSize);
+    ok = (fp->close() == bare::Volume::Error::OK) && ok;
+    delete fp;
+    
+    // Don't leave a partial image behind
+    if (!ok) {
+        fs->remove(_image.c_str());
+    }
+    return ok;
+}
+
+void ProgramImage::encode(const Program& program, uint32_t sourceSize, uint32_t sourceHash, std::vector<uint8_t>& image)
+{
+    ImageWriter writer;
+    Header header = {
+        Magic, Version, floatFormat(), 0, 0, sourceSize, sourceHash,
+        static_cast<uint32_t>(program._functions.size()),
+        static_cast<uint32_t>(program._constants.size()),
+        static_cast<uint32_t>(program._strings.size()),
+        static_cast<uint32_t>(program._globals.size()),
+    };
+    writer.put(header);
+    for (const Function& function : program._functions) {
+        writer.putString(function.name);
+        writer.put(function.params);
+        writer.put(function.registers);
+        writer.put(function.global);
+        writer.put(static_cast<uint32_t>(function.code.size()));
+        writer.put(function.code.data(), function.code.size() * sizeof(Instruction));
+        writer.put(function.lines.data(), function.lines.size() * sizeof(uint16_t));
+    }
+    writer.put(program._constants.data(), program._constants.size() * sizeof(bare::Float));
+    for (const bare::String& s : program._strings) {
+        writer.putString(s);
+    }
+    for (const bare::String& s : program._globals) {
+        writer.putString(s);
+    }
+    
+    // The size and checksum are only known now
+    image.swap(writer.buffer());
+    uint32_t imageSize = static_cast<uint32_t>(image.size());
+    uint32_t checksum = bare::hash(image.data() + sizeof(Header), image.size() - sizeof(Header));
+    bare::memcpy(image.data() + offsetof(Header, imageSize), &imageSize, sizeof(imageSize));
+    bare::memcpy(image.data() + offsetof(Header, checksum), &checksum, sizeof(checksum));
+}
@@ -0,0 +1,105 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Program.h"
+
+namespace placid {
+
+    // ProgramImage - A compiled Program cached in a file next to its source
+    //
+    // The image of foo.js is foo.pbc. It holds the size and hash of the
+    // source it was compiled from and is only used while both still match.
+    // FAT32 files here don't get modification times, so the hash is what
+    // catches an edited source. A current image is read with one read of
+    // the whole file. A missing or stale one is replaced by compiling the
+    // source and writing the result with one write.
+    class ProgramImage
+    {
+    public:
+        enum class Status { Cached, Compiled, NotFound, Error };
+        
+        ProgramImage(const char* source);
+        
+        // Fills program from the image, or from the source if the image
+        // isn't current. On Error, error() and line() describe the syntax
+        // error
+        Status load(Program&);
+        
+        const char* error() const { return _error.c_str(); }
+        uint32_t line() const { return _line; }
+        
+        static bare::String imageName(const char* source);
+        
+    private:
+        static constexpr uint32_t Magic = 0x31434250; // "PBC1"
+        
+        // The version is derived from the op list, see ProgramImage.cpp.
+        // checksum covers everything after the header
+        struct Header
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t floatFormat;
+            uint32_t imageSize;
+            uint32_t checksum;
+            uint32_t sourceSize;
+            uint32_t sourceHash;
+            uint32_t functions;
+            uint32_t constants;
+            uint32_t strings;
+            uint32_t globals;
+        };
+        
+        // Images hold raw bare::Float values, so they're only good for
+        // builds with the same Float
+        static uint16_t floatFormat() { return static_cast<uint16_t>((sizeof(bare::Float) << 8) | bare::Float::BinaryExponent); }
+        
+        bool read(Program&, uint32_t sourceSize, uint32_t sourceHash);
+        bool write(const Program&, uint32_t sourceSize, uint32_t sourceHash);
+        
+        // Returns false if the image is damaged or not for this source. A
+        // Program it returns is safe for the VM to run
+        static bool decode(const uint8_t* image, size_t size, uint32_t sourceSize, uint32_t sourceHash, Program&);
+        static void encode(const Program&, uint32_t sourceSize, uint32_t sourceHash, std::vector<uint8_t>& image);
+        
+        bare::String _source;
+        bare::String _image;
+        bare::String _error;
+        uint32_t _line = 0;
+    };
+
+}
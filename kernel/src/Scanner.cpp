@@ -37,18 +37,18 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "Scanner.h"
 
+#include "bare/Parse.h"
+#include <limits>
+
 using namespace placid;
 
 uint32_t placid::stringToUInt32(const char* str)
 {
-    StringStream stream(str);
-    Scanner scanner(&stream);
-    Scanner::TokenType type;
-    Token token = scanner.getToken(type, true);
-    if (token == Token::Integer) {
-        return type.integer;
-    }
-    return 0;
+	while (bare::isSpace(*str)) {
+		++str;
+	}
+	uint32_t n;
+	return bare::parse(str, n, 0).ok() ? n : 0;
 }
 
 static const char* specialSingleChar = "(),.:;?[]{}~";
@@ -66,10 +66,139 @@ inline static bool findChar(const char* s, char c)
 
 struct Keyword
 {
-	uint8_t index;
+	const char* name;
 	Token token;
 };
 
+static constexpr Keyword keywords[] = {
+	{ "break", Token::Break },
+	{ "case", Token::Case },
+	{ "class", Token::Class },
+	{ "constructor", Token::Constructor },
+	{ "continue", Token::Continue },
+	{ "default", Token::Default },
+	{ "delete", Token::Delete },
+	{ "do", Token::Do },
+	{ "else", Token::Else },
+	{ "false", Token::False },
+	{ "for", Token::For },
+	{ "function", Token::Function },
+	{ "if", Token::If },
+	{ "new", Token::New },
+	{ "null", Token::Null },
+	{ "return", Token::Return },
+	{ "switch", Token::Switch },
+	{ "this", Token::This },
+	{ "true", Token::True },
+	{ "var", Token::Var },
+	{ "while", Token::While },
+};
+
+static constexpr uint32_t KeywordCount = sizeof(keywords) / sizeof(keywords[0]);
+
+// Keywords are found with a perfect hash. At compile time a seed is
+// searched for which puts every keyword in a slot of its own, so an
+// identifier is classified with one hash and one string compare. The
+// hash only looks at the first two characters, the last one and the
+// length, and keywords are all at least 2 characters long.
+static constexpr uint32_t KeywordHashBits = 6;
+static constexpr uint32_t KeywordHashSize = 1 << KeywordHashBits;
+static constexpr uint8_t NoKeyword = 0xff;
+static constexpr uint32_t MinKeywordLength = 2;
+static constexpr uint32_t MaxKeywordLength = 11;
+
+static constexpr uint32_t keywordHash(uint32_t seed, const char* s, uint32_t length)
+{
+	uint32_t h = seed;
+	h = (h ^ static_cast<uint8_t>(s[0])) * 0x01000193;
+	h = (h ^ static_cast<uint8_t>(s[1])) * 0x01000193;
+	h = (h ^ static_cast<uint8_t>(s[length - 1])) * 0x01000193;
+	h = (h ^ length) * 0x01000193;
+	return h >> (32 - KeywordHashBits);
+}
+
+static constexpr uint32_t keywordLength(const char* s)
+{
+	uint32_t length = 0;
+	while (s[length]) {
+		++length;
+	}
+	return length;
+}
+
+struct KeywordTable
+{
+	uint32_t seed;
+	uint8_t slots[KeywordHashSize];
+};
+
+static constexpr KeywordTable makeKeywordTable()
+{
+	for (uint32_t seed = 1; seed < 10000; ++seed) {
+		KeywordTable table { seed, { } };
+		for (uint8_t& slot : table.slots) {
+			slot = NoKeyword;
+		}
+		
+		bool collision = false;
+		for (uint32_t i = 0; i < KeywordCount && !collision; ++i) {
+			uint32_t slot = keywordHash(seed, keywords[i].name, keywordLength(keywords[i].name));
+			collision = table.slots[slot] != NoKeyword;
+			table.slots[slot] = static_cast<uint8_t>(i);
+		}
+		if (!collision) {
+			return table;
+		}
+	}
+	return KeywordTable { 0, { } };
+}
+
+static constexpr KeywordTable keywordTable = makeKeywordTable();
+static_assert(keywordTable.seed != 0, "no perfect hash seed for the keywords, increase KeywordHashBits");
+
+static Token lookupKeyword(const char* s, uint32_t length)
+{
+	if (length < MinKeywordLength || length > MaxKeywordLength) {
+		return Token::Identifier;
+	}
+	uint8_t index = keywordTable.slots[keywordHash(keywordTable.seed, s, length)];
+	if (index == NoKeyword) {
+		return Token::Identifier;
+	}
+	const char* name = keywords[index].name;
+	return (bare::memcmp(name, s, length) == 0 && name[length] == '\0') ? keywords[index].token : Token::Identifier;
+}
+
+Token Scanner::scanIdentifier(TokenType& tokenValue)
+{
+	_tokenString.clear();
+	_tokenString += get();
+	
+	// Scan straight through the current chunk, refilling at its end.
+	// Identifiers never contain newlines, so there's no line counting.
+	// Characters past MAX_ID_LENGTH are dropped
+	for ( ; ; ) {
+		const uint8_t* p = _cursor;
+		while (p < _end && bare::isIdOther(*p)) {
+			++p;
+		}
+		size_t room = MAX_ID_LENGTH - _tokenString.size();
+		size_t size = static_cast<size_t>(p - _cursor);
+		_tokenString.append(reinterpret_cast<const char*>(_cursor), (size < room) ? size : room);
+		_cursor = p;
+		if (p < _end || !refill()) {
+			break;
+		}
+	}
+	
+	uint32_t length = static_cast<uint32_t>(_tokenString.size());
+	Token token = lookupKeyword(_tokenString.c_str(), length);
+	if (token == Token::Identifier) {
+		tokenValue.atom = _atoms->intern(_tokenString.c_str(), length);
+	}
+	return token;
+}
+
 Token Scanner::scanString(char terminal)
 {    
 	uint8_t c;
@@ -79,80 +208,80 @@ Token Scanner::scanString(char terminal)
 		if (c == terminal) {
 			break;
 		}
-        while (c == '\\') {
-            switch((c = get())) {
-                case 'a': c = 0x07; break;
-                case 'b': c = 0x08; break;
-                case 'f': c = 0x0c; break;
-                case 'n': c = 0x0a; break;
-                case 'r': c = 0x0d; break;
-                case 't': c = 0x09; break;
-                case 'v': c = 0x0b; break;
-                case '\\': c = 0x5c; break;
-                case '\'': c = 0x27; break;
-                case '"': c = 0x22; break;
-                case '?': c = 0x3f; break;
-                case 'u':
-                case 'x': {
-                    if ((c = get()) == C_EOF) {
-                        return Token::String;
-                    }
-                    
-                    if (!bare::isHex(c) && !bare::isDigit(c)) {
-                        c = '?';
-                        break;
-                    }
-                    
-                    uint32_t num = 0;
-                    putback(c);
-                    while ((c = get()) != C_EOF) {
-                        if (!bare::isHex(c) && !bare::isDigit(c)) {
-                            break;
-                        }
-                        if (bare::isDigit(c)) {
-                            num = (num << 4) | (c - '0');
-                        } else if (bare::isUpper(c)) {
-                            num = (num << 4) | ((c - 'A') + 0x0a);
-                        } else {
-                            num = (num << 4) | ((c - 'a') + 0x0a);
-                        }
-                    }
-                    if (num > 0xffffff) {
-                        _tokenString += static_cast<uint8_t>(num >> 24);
-                        _tokenString += static_cast<uint8_t>(num >> 16);
-                        _tokenString += static_cast<uint8_t>(num >> 8);
-                        _tokenString += static_cast<uint8_t>(num);
-                    } else if (num > 0xffff) {
-                        _tokenString += static_cast<uint8_t>(num >> 16);
-                        _tokenString += static_cast<uint8_t>(num >> 8);
-                        _tokenString += static_cast<uint8_t>(num);
-                    } else if (num > 0xff) {
-                        _tokenString += static_cast<uint8_t>(num >> 8);
-                        _tokenString += static_cast<uint8_t>(num);
-                    } else {
-                        _tokenString += static_cast<uint8_t>(num);
-                    }
-                    break;
-                }
-                default: {
-                    if (!bare::isOctal(c)) {
-                        c = '?';
-                        break;
-                    }
-                    
-                    uint32_t size = 0;
-                    uint32_t num = c - '0';
-                    while ((c = get()) != C_EOF) {
-                        if (!bare::isOctal(c) || ++size >= 3) {
-                            break;
-                        }
-                        num = (num << 3) | (c - '0');
-                    }
-                    _tokenString += static_cast<uint8_t>(num & 0x3f);
-                    break;
-                }
-            }
-        }
+		while (c == '\\') {
+			switch((c = get())) {
+				case 'a': c = 0x07; break;
+				case 'b': c = 0x08; break;
+				case 'f': c = 0x0c; break;
+				case 'n': c = 0x0a; break;
+				case 'r': c = 0x0d; break;
+				case 't': c = 0x09; break;
+				case 'v': c = 0x0b; break;
+				case '\\': c = 0x5c; break;
+				case '\'': c = 0x27; break;
+				case '"': c = 0x22; break;
+				case '?': c = 0x3f; break;
+				case 'u':
+				case 'x': {
+					if ((c = get()) == C_EOF) {
+						return Token::String;
+					}
+					
+					if (!bare::isHex(c) && !bare::isDigit(c)) {
+						c = '?';
+						break;
+					}
+					
+					uint32_t num = 0;
+					putback(c);
+					while ((c = get()) != C_EOF) {
+						if (!bare::isHex(c) && !bare::isDigit(c)) {
+							break;
+						}
+						if (bare::isDigit(c)) {
+							num = (num << 4) | (c - '0');
+						} else if (bare::isUpper(c)) {
+							num = (num << 4) | ((c - 'A') + 0x0a);
+						} else {
+							num = (num << 4) | ((c - 'a') + 0x0a);
+						}
+					}
+					if (num > 0xffffff) {
+						_tokenString += static_cast<uint8_t>(num >> 24);
+						_tokenString += static_cast<uint8_t>(num >> 16);
+						_tokenString += static_cast<uint8_t>(num >> 8);
+						_tokenString += static_cast<uint8_t>(num);
+					} else if (num > 0xffff) {
+						_tokenString += static_cast<uint8_t>(num >> 16);
+						_tokenString += static_cast<uint8_t>(num >> 8);
+						_tokenString += static_cast<uint8_t>(num);
+					} else if (num > 0xff) {
+						_tokenString += static_cast<uint8_t>(num >> 8);
+						_tokenString += static_cast<uint8_t>(num);
+					} else {
+						_tokenString += static_cast<uint8_t>(num);
+					}
+					break;
+				}
+				default: {
+					if (!bare::isOctal(c)) {
+						c = '?';
+						break;
+					}
+					
+					uint32_t size = 0;
+					uint32_t num = c - '0';
+					while ((c = get()) != C_EOF) {
+						if (!bare::isOctal(c) || ++size >= 3) {
+							break;
+						}
+						num = (num << 3) | (c - '0');
+					}
+					_tokenString += static_cast<uint8_t>(num & 0x3f);
+					break;
+				}
+			}
+		}
 		_tokenString += c;
 	}
 	return Token::String;
@@ -161,250 +290,242 @@ Token Scanner::scanString(char terminal)
 Token Scanner::scanSpecial()
 {
 	uint8_t c1 = get();
-    uint8_t c2;
-    if (c1 == C_EOF) {
-        return Token::EndOfFile;
-    }
-    
-    if (c1 == '<') {
-        if ((c2 = get()) == C_EOF) {
-            return Token::EndOfFile;
-        }
-        if (c2 == '<') {
-            if ((c2 = get()) == C_EOF) {
-                return Token::EndOfFile;
-            }
-            if (c2 == '=') {
-                return Token::SHLSTO;
-            }
-            putback(c2);
-            return Token::SHL;
-        }
-        if (c2 == '=') {
-            return Token::LE;
-        }
-        putback(c2);
-        return static_cast<Token>(c1);
-    }
+	uint8_t c2;
+	if (c1 == C_EOF) {
+		return Token::EndOfFile;
+	}
+	
+	if (c1 == '<') {
+		if ((c2 = get()) == C_EOF) {
+			return Token::EndOfFile;
+		}
+		if (c2 == '<') {
+			if ((c2 = get()) == C_EOF) {
+				return Token::EndOfFile;
+			}
+			if (c2 == '=') {
+				return Token::SHLSTO;
+			}
+			putback(c2);
+			return Token::SHL;
+		}
+		if (c2 == '=') {
+			return Token::LE;
+		}
+		putback(c2);
+		return static_cast<Token>(c1);
+	}
 
-    if (c1 == '>') {
-        if ((c2 = get()) == C_EOF) {
-            return Token::EndOfFile;
-        }
-        if (c2 == '>') {
-            if ((c2 = get()) == C_EOF) {
-                return Token::EndOfFile;
-            }
-            if (c2 == '=') {
-                return Token::SHRSTO;
-            }
-            if (c2 == '>') {
-                if ((c2 = get()) == C_EOF) {
-                    return Token::EndOfFile;
-                }
-                if (c2 == '=') {
-                    return Token::SARSTO;
-                }
-                putback(c2);
-                return Token::SAR;
-            }
-            putback(c2);
-            return Token::SHR;
-        }
-        if (c2 == '=') {
-            return Token::GE;
-        }
-        putback(c2);
-        return static_cast<Token>(c1);
-    }
-        
-    if (findChar(specialSingleChar, c1)) {
-        return static_cast<Token>(c1);
-    }
-    
-    if (!findChar(specialFirstChar, c1)) {
-        putback(c1);
-        return Token::EndOfFile;
-    }
+	if (c1 == '>') {
+		if ((c2 = get()) == C_EOF) {
+			return Token::EndOfFile;
+		}
+		if (c2 == '>') {
+			if ((c2 = get()) == C_EOF) {
+				return Token::EndOfFile;
+			}
+			if (c2 == '=') {
+				return Token::SHRSTO;
+			}
+			if (c2 == '>') {
+				if ((c2 = get()) == C_EOF) {
+					return Token::EndOfFile;
+				}
+				if (c2 == '=') {
+					return Token::SARSTO;
+				}
+				putback(c2);
+				return Token::SAR;
+			}
+			putback(c2);
+			return Token::SHR;
+		}
+		if (c2 == '=') {
+			return Token::GE;
+		}
+		putback(c2);
+		return static_cast<Token>(c1);
+	}
+		
+	if (findChar(specialSingleChar, c1)) {
+		return static_cast<Token>(c1);
+	}
+	
+	if (!findChar(specialFirstChar, c1)) {
+		putback(c1);
+		return Token::EndOfFile;
+	}
 
 	if ((c2 = get()) == C_EOF) {
-        return Token::EndOfFile;
-    }
-    
-    switch(c1) {
-        case '!':
-            if (c2 == '=') {
-                return Token::NE;
-            }
-            break;
-        case '%':
-            if (c2 == '=') {
-                return Token::MODSTO;
-            }
-            break;
-        case '&':
-            if (c2 == '&') {
-                return Token::LAND;
-            }
-            if (c2 == '=') {
-                return Token::ANDSTO;
-            }
-            break;
-        case '*':
-            if (c2 == '=') {
-                return Token::MULSTO;
-            }
-            break;
-        case '+':
-            if (c2 == '=') {
-                return Token::ADDSTO;
-            }
-            if (c2 == '+') {
-                return Token::INC;
-            }
-            break;
-        case '-':
-            if (c2 == '=') {
-                return Token::SUBSTO;
-            }
-            if (c2 == '-') {
-                return Token::DEC;
-            }
-            break;
-        case '/':
-            if (c2 == '=') {
-                return Token::DIVSTO;
-            }
-            break;
-        case '=':
-            if (c2 == '=') {
-                return Token::EQ;
-            }
-            break;
-        case '^':
-            if (c2 == '=') {
-                return Token::XORSTO;
-            }
-            break;
-        case '|':
-            if (c2 == '=') {
-                return Token::ORSTO;
-            }
-            if (c2 == '|') {
-                return Token::LOR;
-            }
-            break;
-    }
-    putback(c2);
-    return static_cast<Token>(c1);
+		return Token::EndOfFile;
+	}
+	
+	switch(c1) {
+		case '!':
+			if (c2 == '=') {
+				return Token::NE;
+			}
+			break;
+		case '%':
+			if (c2 == '=') {
+				return Token::MODSTO;
+			}
+			break;
+		case '&':
+			if (c2 == '&') {
+				return Token::LAND;
+			}
+			if (c2 == '=') {
+				return Token::ANDSTO;
+			}
+			break;
+		case '*':
+			if (c2 == '=') {
+				return Token::MULSTO;
+			}
+			break;
+		case '+':
+			if (c2 == '=') {
+				return Token::ADDSTO;
+			}
+			if (c2 == '+') {
+				return Token::INC;
+			}
+			break;
+		case '-':
+			if (c2 == '=') {
+				return Token::SUBSTO;
+			}
+			if (c2 == '-') {
+				return Token::DEC;
+			}
+			break;
+		case '/':
+			if (c2 == '=') {
+				return Token::DIVSTO;
+			}
+			break;
+		case '=':
+			if (c2 == '=') {
+				return Token::EQ;
+			}
+			break;
+		case '^':
+			if (c2 == '=') {
+				return Token::XORSTO;
+			}
+			break;
+		case '|':
+			if (c2 == '=') {
+				return Token::ORSTO;
+			}
+			if (c2 == '|') {
+				return Token::LOR;
+			}
+			break;
+	}
+	putback(c2);
+	return static_cast<Token>(c1);
 }
 
-// Return the number of digits scanned
-int32_t Scanner::scanDigits(int32_t& number, bool hex)
+// Append digits to _tokenString, returning how many there were
+uint32_t Scanner::scanDigits(bool hex)
 {
+	uint32_t numDigits = 0;
 	uint8_t c;
-    int32_t radix = hex ? 16 : 10;
-    int32_t numDigits = 0;
-    
 	while ((c = get()) != C_EOF) {
-		if (bare::isDigit(c)) {
-            number = number * radix;
-            number += static_cast<int32_t>(c - '0');
-        } else if (hex && bare::isLCHex(c)) {
-            number = number * radix;
-            number += static_cast<int32_t>(c - 'a' + 10);
-        } else if (hex && bare::isUCHex(c)) {
-            number = number * radix;
-            number += static_cast<int32_t>(c - 'A' + 10);
-        } else {
+		if (!bare::isDigit(c) && !(hex && bare::isHex(c))) {
 			putback(c);
 			break;
-        }
-        ++numDigits;
+		}
+		_tokenString += c;
+		++numDigits;
 	}
-    return numDigits;
+	return numDigits;
 }
 
+// Gather the literal into _tokenString and let bare::parse convert it
 Token Scanner::scanNumber(TokenType& tokenValue)
 {
 	uint8_t c = get();
-    if (c == C_EOF) {
-        return Token::EndOfFile;
-    }
-    
+	if (c == C_EOF) {
+		return Token::EndOfFile;
+	}
+	
 	if (!bare::isDigit(c)) {
 		putback(c);
 		return Token::EndOfFile;
 	}
 	
-    bool hex = false;
-    int32_t number = static_cast<int32_t>(c - '0');
-    int32_t exp = 0;
-
-    if (c == '0') {
-        if ((c = get()) == C_EOF) {
-            tokenValue.integer = static_cast<uint32_t>(number);
-            return Token::Integer;
-        }
-        if (c == 'x' || c == 'X') {
-            if ((c = get()) == C_EOF) {
-                return Token::EndOfFile;
-            }
-            if (!bare::isDigit(c)) {
-                putback(c);
-                return Token::Unknown;
-            }
-            hex = true;
-        }
-        putback(c);
+	_tokenString.clear();
+	_tokenString += c;
+	
+	if (c == '0') {
+		if ((c = get()) == C_EOF) {
+			tokenValue.integer = 0;
+			return Token::Integer;
+		}
+		if (c == 'x' || c == 'X') {
+			if ((c = get()) == C_EOF) {
+				return Token::EndOfFile;
+			}
+			putback(c);
+			if (!bare::isXDigit(c)) {
+				return Token::Unknown;
+			}
+			
+			// Hex too big for an Integer becomes a Float
+			_tokenString.clear();
+			scanDigits(true);
+			const char* text = _tokenString.c_str();
+			uint64_t number;
+			bare::parse(text, text + _tokenString.size(), number, 16);
+			if (number <= std::numeric_limits<uint32_t>::max()) {
+				tokenValue.integer = static_cast<uint32_t>(number);
+				return Token::Integer;
+			}
+			tokenValue.number = bare::Float(static_cast<double>(number));
+			return Token::Float;
+		}
+		putback(c);
 	}
-    
-    scanDigits(number, hex);
-    if (scanFloat(number, exp)) {
-        // FIXME: Implement
-        //Float f(number, exp);
-        //tokenValue.number = static_cast<Float::Raw>(f);
-        return Token::Float;
-    }
-    assert(exp == 0);
-    tokenValue.integer = static_cast<uint32_t>(number);
-    return Token::Integer;
-}
-
-bool Scanner::scanFloat(int32_t& mantissa, int32_t& exp)
-{
-    bool haveFloat = false;
-	uint8_t c;
-    if ((c = get()) == C_EOF) {
-        return false;
-    }
-    if (c == '.') {
-        haveFloat = true;
-        exp = -scanDigits(mantissa, false);
-        if ((c = get()) == C_EOF) {
-            return true;
-        }
-    }
-    if (c == 'e' || c == 'E') {
-        haveFloat = true;
-        if ((c = get()) == C_EOF) {
-            return false;
-        }
-        int32_t neg = 1;
-        if (c == '+' || c == '-') {
-            if (c == '-') {
-                neg = -1;
-            }
-        } else {
-            putback(c);
-        }
-        int32_t realExp = 0;
-        scanDigits(realExp, false);
-        exp += neg * realExp;
-    } else {
-        putback(c);
-    }
-    return haveFloat;
+	
+	scanDigits(false);
+	
+	bool haveFloat = false;
+	if ((c = get()) == '.') {
+		haveFloat = true;
+		_tokenString += c;
+		scanDigits(false);
+		c = get();
+	}
+	if (c == 'e' || c == 'E') {
+		// An e without digits is dropped, parse stops before it
+		haveFloat = true;
+		_tokenString += c;
+		if ((c = get()) == '+' || c == '-') {
+			_tokenString += c;
+		} else if (c != C_EOF) {
+			putback(c);
+		}
+		scanDigits(false);
+	} else if (c != C_EOF) {
+		putback(c);
+	}
+	
+	const char* text = _tokenString.c_str();
+	const char* end = text + _tokenString.size();
+	
+	// A decimal too big for an Integer becomes a Float
+	if (!haveFloat) {
+		uint32_t number;
+		if (bare::parse(text, end, number).ok()) {
+			tokenValue.integer = number;
+			return Token::Integer;
+		}
+	}
+	bare::parse(text, end, tokenValue.number);
+	return Token::Float;
 }
 
 Token Scanner::scanComment()
@@ -439,24 +560,21 @@ Token Scanner::scanComment()
 		}
 		return Token::Comment;
 	}
+	if (c != C_EOF) {
+		putback(c);
+	}
 	return static_cast<Token>('/');
 }
 
-uint8_t Scanner::get() const
+bool Scanner::refill() const
 {
-    if (_lastChar != C_EOF) {
-        uint8_t c = _lastChar;
-        _lastChar = C_EOF;
-        return c;
-    }
-    if (_istream->eof()) {
-        return C_EOF;
-    }
-    uint8_t c = _istream->read();
-    if (c == '\n') {
-        ++_lineno;
-    }
-    return c;
+	if (!_istream) {
+		return false;
+	}
+	Stream::Span span = _istream->fill();
+	_cursor = span.cursor;
+	_end = span.end;
+	return !span.empty();
 }
 
 Token Scanner::getToken(TokenType& tokenValue, bool ignoreWhitespace)
@@ -465,19 +583,19 @@ Token Scanner::getToken(TokenType& tokenValue, bool ignoreWhitespace)
 	Token token = Token::EndOfFile;
 	
 	while (token == Token::EndOfFile && (c = get()) != C_EOF) {
-        if (bare::isSpace(c)) {
-            if (ignoreWhitespace) {
-                continue;
-            }
-            token = Token::Whitespace;
-            break;
-        }
+		if (bare::isSpace(c)) {
+			if (ignoreWhitespace) {
+				continue;
+			}
+			token = Token::Whitespace;
+			break;
+		}
 		switch(c) {
 			case '/':
 				token = scanComment();
 				if (token == Token::Comment) {
 					// For now we ignore comments
-                    token = Token::EndOfFile;
+					token = Token::EndOfFile;
 					break;
 				}
 				break;
@@ -485,21 +603,28 @@ Token Scanner::getToken(TokenType& tokenValue, bool ignoreWhitespace)
 			case '\"':
 			case '\'':
 				token = scanString(c);
-                tokenValue.str = _tokenString.c_str();
+				tokenValue.atom = _atoms->intern(_tokenString.c_str(), static_cast<uint32_t>(_tokenString.size()));
 				break;
 
 			default:
 				putback(c);
+				if (bare::isIdFirst(c)) {
+					token = scanIdentifier(tokenValue);
+					break;
+				}
 				if ((token = scanNumber(tokenValue)) != Token::EndOfFile) {
 					break;
 				}
 				if ((token = scanSpecial()) != Token::EndOfFile) {
 					break;
 				}
+				
+				// scanSpecial put it back. Consume it so the next call moves on
+				get();
 				token = Token::Unknown;
-                break;
+				break;
 		}
 	}
-    
+	
 	return token;
 }
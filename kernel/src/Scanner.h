@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "AtomTable.h"
 #include "MStream.h"
 
 #define MAX_ID_LENGTH 32
@@ -150,16 +151,21 @@ namespace placid {
 
     class Scanner  {
     public:
+        // Identifiers and strings are interned in the atom table, so the
+        // value of one is just its atom
         typedef struct {
             bare::Float	number;
             uint32_t    integer;
-            const char* str;
+            Atom        atom;
         } TokenType;
 
-        Scanner(Stream* istream = nullptr)
+        // Atoms go in the passed table, so they can outlive the Scanner,
+        // or one of its own
+        Scanner(Stream* istream = nullptr, AtomTable* atoms = nullptr)
          : _lastChar(C_EOF)
          , _istream(istream)
          , _lineno(1)
+         , _atoms(atoms ? atoms : &_ownAtoms)
         {
         }
         
@@ -167,10 +173,18 @@ namespace placid {
         {
         }
         
-        void setStream(Stream* istream) { _istream = istream; }
+        void setStream(Stream* istream)
+        {
+            _istream = istream;
+            _cursor = nullptr;
+            _end = nullptr;
+        }
       
         uint32_t lineno() const { return _lineno; }
         
+        AtomTable& atoms() { return *_atoms; }
+        const AtomTable& atoms() const { return *_atoms; }
+        
         Token getToken(TokenType& token, bool ignoreWhitespace = true);
 
         Token getToken()
@@ -192,7 +206,26 @@ namespace placid {
         void retireToken() { _currentToken = Token::None; }
 
     private:
-        uint8_t get() const;
+        // Input is read a chunk at a time from the stream, so this is
+        // usually a pointer increment
+        uint8_t get() const
+        {
+            if (_lastChar != C_EOF) {
+                uint8_t c = _lastChar;
+                _lastChar = C_EOF;
+                return c;
+            }
+            if (_cursor == _end && !refill()) {
+                return C_EOF;
+            }
+            uint8_t c = *_cursor++;
+            if (c == '\n') {
+                ++_lineno;
+            }
+            return c;
+        }
+        
+        bool refill() const;
         
         void putback(uint8_t c) const
         {
@@ -200,17 +233,21 @@ namespace placid {
             _lastChar = c;
         }
 
+        Token scanIdentifier(TokenType& tokenValue);
         Token scanString(char terminal);
         Token scanSpecial();
         Token scanNumber(TokenType& tokenValue);
         Token scanComment();
-        int32_t scanDigits(int32_t& number, bool hex);
-        bool scanFloat(int32_t& mantissa, int32_t& exp);
+        uint32_t scanDigits(bool hex);
         
         mutable uint8_t _lastChar;
         bare::String _tokenString;
         Stream* _istream;
+        mutable const uint8_t* _cursor = nullptr;
+        mutable const uint8_t* _end = nullptr;
         mutable uint32_t _lineno;
+        AtomTable _ownAtoms;
+        AtomTable* _atoms;
 
         Token _currentToken = Token::None;
         Scanner::TokenType _currentTokenValue;
@@ -0,0 +1,304 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "SelfTest.h"
+
+#include "Compiler.h"
+#include "MStream.h"
+#include "TreeWalker.h"
+#include "VM.h"
+#include "bare/Print.h"
+#include "bare/String.h"
+#include "bare/Timer.h"
+#include <vector>
+
+using namespace placid;
+
+SelfTest::Registration* SelfTest::_first = nullptr;
+
+SelfTest::Registration::Registration(const char* name, Function function)
+    : name(name)
+    , function(function)
+{
+    Registration** p = &_first;
+    while (*p) {
+        p = &(*p)->next;
+    }
+    *p = this;
+}
+
+uint32_t SelfTest::run(const bare::StringView& pattern, const Reporter& reporter, uint32_t& failed)
+{
+    uint32_t count = 0;
+    failed = 0;
+    for (Registration* r = _first; r; r = r->next) {
+        if (bare::StringView(r->name).find(pattern) == bare::StringView::npos) {
+            continue;
+        }
+        SelfTest test(r->name, reporter);
+        r->function(test);
+        
+        bare::String line;
+        line.printf(FMT("%-8s %s"), r->name, test._failures ? "FAILED" : "passed");
+        reporter(line.c_str());
+        
+        ++count;
+        if (test._failures) {
+            ++failed;
+        }
+    }
+    return count;
+}
+
+bool SelfTest::check(bool ok, const char* what)
+{
+    if (!ok) {
+        bare::String line;
+        line.printf(FMT("%-8s failed: %s"), _name, what);
+        _reporter(line.c_str());
+        ++_failures;
+    }
+    return ok;
+}
+
+// Scripts which must print the expected output with both the VM and the
+// tree walker, so a bug the two front ends share is caught too. The first
+// ones assign a local while it is the left operand of the same expression.
+// The big literals would go negative if read as signed
+static const struct { const char* name; const char* source; const char* expected; } VMChecks[] = {
+    { "postfix", "function f() { var a = 1; print(a + a++, a); } f();\n", "2 2" },
+    { "assign", "function f() { var c = 2; print(c + (c = 10), c); } f();\n", "12 10" },
+    { "prefix", "function f() { var i = 3; print(i + ++i, i); } f();\n", "7 4" },
+    { "compound", "function f() { var c = 2, d = 3; c += (c = 10); d *= d++; print(c, d); } f();\n", "12 9" },
+    { "literals", "print(0x80000000 > 0, 0xffffffff > 0x80000000, 3000000000 > 0, -0xffffffff < 0);\n", "true true true true" },
+};
+
+static void vmTest(SelfTest& test)
+{
+    for (const auto& check : VMChecks) {
+        bare::String vmOutput;
+        bare::String walkerOutput;
+        bare::String::PrintSink vmSink(vmOutput);
+        bare::String::PrintSink walkerSink(walkerOutput);
+        
+        StringStream compilerStream(check.source);
+        Compiler compiler(&compilerStream);
+        Program program;
+        StringStream walkerStream(check.source);
+        TreeWalker walker(&walkerStream, walkerSink);
+        VM vm(program, vmSink);
+        bool ok = compiler.compile(program) && walker.parse() && vm.run() && walker.run() &&
+                  vmOutput.trim() == check.expected && walkerOutput.trim() == check.expected;
+        
+        bare::String what;
+        what.printf(FMT("%s: vm printed %s, tree walker %s"), check.name, vmOutput.trim().c_str(), walkerOutput.trim().c_str());
+        test.check(ok, what.c_str());
+    }
+}
+
+SELF_TEST("vm", vmTest);
+
+// Timers run on a fake clock through Timer::Hooks, so the heap can be
+// checked on the host as well as the device. The clock starts at 0, so the
+// kernel's own timers, due at real times, stay put until the hooks are
+// removed
+static int64_t fakeTime;
+
+static int64_t fakeClock() { return fakeTime; }
+
+struct TimerEvent
+{
+    uint32_t id;
+    int64_t time;
+};
+
+static std::vector<TimerEvent> timerEvents;
+
+class TestTimer : public bare::Timer
+{
+public:
+    TestTimer(uint32_t id) : _id(id) { }
+    
+    virtual void handleTimerEvent() override { timerEvents.push_back({ _id, fakeTime }); }
+    
+private:
+    uint32_t _id;
+};
+
+static void advanceTo(int64_t time)
+{
+    fakeTime = time;
+    bare::Timer::fireDue();
+}
+
+// Whether the events since the last call are the expected ones, with times
+// relative to base. Moves base up to now for the next call
+static bool eventsWere(int64_t& base, std::initializer_list<TimerEvent> expected)
+{
+    bool ok = timerEvents.size() == expected.size();
+    for (uint32_t i = 0; ok && i < expected.size(); ++i) {
+        const TimerEvent& event = expected.begin()[i];
+        ok = timerEvents[i].id == event.id && timerEvents[i].time == base + event.time;
+    }
+    timerEvents.clear();
+    base = fakeTime;
+    return ok;
+}
+
+static void timerTest(SelfTest& test)
+{
+    static const bare::Timer::Hooks hooks = { fakeClock, true, bare::Timer::fireDue };
+    
+    fakeTime = 0;
+    bare::Timer::setHooks(&hooks);
+    timerEvents.clear();
+    
+    {
+        TestTimer a(1), b(2), c(3);
+        int64_t base = fakeTime;
+        
+        // Fired in deadline order, whatever the start order
+        bare::Timer::start(&a, 300, false);
+        bare::Timer::start(&b, 100, false);
+        bare::Timer::start(&c, 200, false);
+        advanceTo(base + 99);
+        advanceTo(base + 150);
+        advanceTo(base + 250);
+        advanceTo(base + 400);
+        test.check(eventsWere(base, { { 2, 150 }, { 3, 250 }, { 1, 400 } }), "order");
+        
+        // Due at the same time, all fire at once in deadline order
+        bare::Timer::start(&a, 30, false);
+        bare::Timer::start(&b, 10, false);
+        bare::Timer::start(&c, 20, false);
+        advanceTo(base + 100);
+        test.check(eventsWere(base, { { 2, 100 }, { 3, 100 }, { 1, 100 } }), "same time");
+        
+        // A stopped timer doesn't fire
+        bare::Timer::start(&a, 100, false);
+        bare::Timer::start(&b, 200, false);
+        bare::Timer::stop(&a);
+        advanceTo(base + 100);
+        advanceTo(base + 200);
+        advanceTo(base + 300);
+        test.check(eventsWere(base, { { 2, 200 } }), "stop");
+        test.check(!a.running() && !b.running(), "running");
+        
+        // Starting a running timer moves its deadline
+        bare::Timer::start(&a, 100, false);
+        advanceTo(base + 50);
+        bare::Timer::start(&a, 100, false);
+        advanceTo(base + 149);
+        advanceTo(base + 150);
+        advanceTo(base + 300);
+        test.check(eventsWere(base, { { 1, 150 } }), "restart");
+        
+        // A repeating timer keeps to its original schedule however late
+        // it fires
+        bare::Timer::start(&a, 100, true);
+        advanceTo(base + 130);
+        advanceTo(base + 205);
+        advanceTo(base + 299);
+        advanceTo(base + 300);
+        test.check(eventsWere(base, { { 1, 130 }, { 1, 205 }, { 1, 300 } }), "repeat");
+        
+        // One which falls behind fires once and skips the missed events
+        advanceTo(base + 350);
+        advanceTo(base + 399);
+        advanceTo(base + 400);
+        test.check(eventsWere(base, { { 1, 350 }, { 1, 400 } }), "catch up");
+        bare::Timer::stop(&a);
+    }
+    
+    bare::Timer::setHooks(nullptr);
+}
+
+SELF_TEST("timer", timerTest);
+
+// For usleep the clock has to move while it spins, so each read takes 1us,
+// and each idle is a wakeup idleStep later
+static uint32_t idleStep;
+static uint32_t idles;
+
+static int64_t tickingClock() { return ++fakeTime; }
+
+static void fakeIdle()
+{
+    ++idles;
+    advanceTo(fakeTime + idleStep);
+}
+
+// Sleeps for us with a wakeup every step. Whether it idled between
+// minIdles and maxIdles times and returned at or just past the deadline
+static bool sleeps(uint32_t us, uint32_t step, uint32_t minIdles, uint32_t maxIdles)
+{
+    idleStep = step;
+    idles = 0;
+    int64_t start = fakeTime;
+    bare::Timer::usleep(us);
+    int64_t late = fakeTime - (start + us);
+    
+    // A wakeup can overshoot by a step, and each clock read adds 1us
+    return idles >= minIdles && idles <= maxIdles && late >= 0 && late <= step + 10;
+}
+
+static void sleepTest(SelfTest& test)
+{
+    static const bare::Timer::Hooks hooks = { tickingClock, true, fakeIdle };
+    static const bare::Timer::Hooks noInterrupts = { tickingClock, false, fakeIdle };
+    
+    fakeTime = 0;
+    bare::Timer::setHooks(&hooks);
+    
+    // Idles once and the timer wakes it at the deadline
+    test.check(sleeps(1000, 1000, 1, 1), "idle");
+    
+    // Woken early by other interrupts, goes back to sleep until its own
+    test.check(sleeps(1000, 37, 27, 28), "early wakeup");
+    
+    // Too short to be worth a timer, so it spins
+    test.check(sleeps(bare::Timer::MinIdleSleep - 1, 37, 0, 0), "short");
+    
+    bare::Timer::setHooks(&noInterrupts);
+    
+    // With no timer interrupt to wait for, it spins
+    test.check(sleeps(1000, 37, 0, 0), "no interrupts");
+    
+    bare::Timer::setHooks(nullptr);
+}
+
+SELF_TEST("sleep", sleepTest);
@@ -0,0 +1,88 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare/StringView.h"
+#include <cstdint>
+#include <functional>
+
+// Adds a test to the registry. function is a void(SelfTest&), which calls
+// check() for each thing it verifies
+#define SELF_TEST(name, function) \
+    static placid::SelfTest::Registration _selfTest_##function(name, function)
+
+namespace placid {
+
+    // SelfTest - Correctness checks for the shell's test command
+    //
+    // Each registered test is run by name, or all of them whose name
+    // contains a pattern. Each failed check is reported, then whether the
+    // test passed, a line at a time through the passed function. The same
+    // tests run on the device and in the host build.
+    class SelfTest
+    {
+    public:
+        using Reporter = std::function<void(const char*)>;
+        using Function = void (*)(SelfTest&);
+        
+        struct Registration
+        {
+            Registration(const char* name, Function);
+            
+            const char* name;
+            Function function;
+            Registration* next = nullptr;
+        };
+        
+        // Runs the tests whose names contain pattern, or all of them if it
+        // is empty, in the order they were registered. Returns the number
+        // run, and sets failed to the number of those which failed
+        static uint32_t run(const bare::StringView& pattern, const Reporter&, uint32_t& failed);
+        
+        // Reports what as failed unless ok. Returns ok
+        bool check(bool ok, const char* what);
+        
+    private:
+        SelfTest(const char* name, const Reporter& reporter) : _name(name), _reporter(reporter) { }
+        
+        const char* _name;
+        const Reporter& _reporter;
+        uint32_t _failures = 0;
+        
+        static Registration* _first;
+    };
+
+}
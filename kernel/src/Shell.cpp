@@ -39,6 +39,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "bare/Print.h"
 #include "bare/Serial.h"
+#include "bare/Trace.h"
 
 using namespace placid;
 
@@ -106,16 +107,27 @@ bool Shell::received(uint8_t c)
 		return true;
 	}
 	
-    std::vector<bare::String> array = bare::String(_buffer, _bufferIndex).trim().split(" ", true);
-   
-    bool returnValue = executeCommand(array);
+    bool returnValue = true;
+    ArgList array;
+    if (!bare::StringView(_buffer, _bufferIndex).trim().split(array, " ", true)) {
+        showMessage(MessageType::Error, "too many arguments, %d allowed\n", MaxArgs);
+    } else {
+        // Terminate each argument in the buffer. There is room for one
+        // past the end.
+        for (const bare::StringView& arg : array) {
+            _buffer[arg.end() - _buffer] = '\0';
+        }
+        
+        returnValue = executeCommand(array);
+    }
 	_bufferIndex = 0;
     sendComplete();
 	return returnValue;
 }
 
-bool Shell::executeCommand(const std::vector<bare::String>& array)
+bool Shell::executeCommand(const ArgList& array)
 {
+    TRACE_SCOPE("shell.command");
 	_state = State::NeedPrompt;
 	
     if (array.size() == 0) {
@@ -124,7 +136,7 @@ bool Shell::executeCommand(const std::vector<bare::String>& array)
     if (array[0] == "?") {
         _state = State::ShowHelp;
     } else if (!executeShellCommand(array)) {
-        showMessage(MessageType::Error, "unrecognized command: %s", join(array, " ").c_str());
+        showMessage(MessageType::Error, "unrecognized command: %s", array[0].data());
     }
     return true;
 }
@@ -139,7 +151,8 @@ void Shell::showMessage(MessageType type, const char* msg, ...)
     va_list args;
     va_start(args, msg);
     
-    bare::String string;
+    bare::Arena::Scope scope(_arena);
+    bare::String string(&_arena);
     string.vprintf(msg, args);    
     shellSend(string.c_str());
 
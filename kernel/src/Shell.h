@@ -37,7 +37,10 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstdint>
 #include <vector>
+#include "bare/Arena.h"
+#include "bare/FixedVector.h"
 #include "bare/String.h"
+#include "bare/StringView.h"
 
 namespace placid {
 	
@@ -47,6 +50,11 @@ namespace placid {
 	class Shell {
 	public:
 	    enum class State { Connect, Disconnect, NeedPrompt, ShowingPrompt, ShowHelp };
+	    
+	    // Command arguments are views into the line buffer. Each is null
+	    // terminated there, so data() can be used as a C string.
+	    static constexpr uint32_t MaxArgs = 16;
+	    using ArgList = bare::FixedVector<bare::StringView, MaxArgs>;
 		
 	    void connected();
 	    void disconnected();
@@ -56,7 +64,7 @@ namespace placid {
 		virtual const char* helpString() const = 0;
         virtual const char* promptString() const = 0;
 	    virtual void shellSend(const char* data, uint32_t size = 0, bool raw = false) = 0;
-		virtual bool executeShellCommand(const std::vector<bare::String>&) = 0;
+		virtual bool executeShellCommand(const ArgList&) = 0;
 
 	protected:
         enum class MessageType { Info, Error };
@@ -65,9 +73,13 @@ namespace placid {
 	    void sendComplete();
 
 	private:
-	    bool executeCommand(const std::vector<bare::String>&);
+	    bool executeCommand(const ArgList&);
 
 	    State _state = State::Connect;
+	    
+	    // Temporary allocations made while formatting a message come from
+	    // here and are released in one shot when done
+	    bare::Arena _arena;
 		
 		static constexpr uint32_t BufferSize = 200;
 		char _buffer[BufferSize + 1];
@@ -0,0 +1,746 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "bare.h"
+
+#include "TreeWalker.h"
+
+#include "Compiler.h"
+#include "bare/Timer.h"
+
+using namespace placid;
+
+uint32_t TreeWalker::node(Kind kind)
+{
+    _nodes.emplace_back();
+    _nodes.back().kind = kind;
+    _nodes.back().line = static_cast<uint16_t>(_scanner.lineno());
+    return static_cast<uint32_t>(_nodes.size() - 1);
+}
+
+bool TreeWalker::parse()
+{
+    _nodes.clear();
+    _error.clear();
+    
+    // Node 0 means none
+    node(Kind::Null);
+    
+    _program = node(Kind::Block);
+    uint32_t last = 0;
+    while (_error.empty() && _scanner.getToken() != Token::EndOfFile) {
+        uint32_t statementNode = statement();
+        if (last) {
+            _nodes[last].next = statementNode;
+        } else {
+            _nodes[_program].a = statementNode;
+        }
+        last = statementNode;
+    }
+    return _error.empty();
+}
+
+uint32_t TreeWalker::statement()
+{
+    Token token = _scanner.getToken();
+    switch (token) {
+        case Token::Var:
+            _scanner.retireToken();
+            return varStatement();
+        case Token::Function:
+            _scanner.retireToken();
+            return functionDeclaration();
+        case Token::If: {
+            _scanner.retireToken();
+            uint32_t n = node(Kind::If);
+            expect(Token::LParen, "'('");
+            uint32_t condition = expression();
+            expect(Token::RParen, "')'");
+            uint32_t then = statement();
+            uint32_t otherwise = accept(Token::Else) ? statement() : 0;
+            _nodes[n].a = condition;
+            _nodes[n].b = then;
+            _nodes[n].c = otherwise;
+            return n;
+        }
+        case Token::While: {
+            _scanner.retireToken();
+            uint32_t n = node(Kind::While);
+            expect(Token::LParen, "'('");
+            uint32_t condition = expression();
+            expect(Token::RParen, "')'");
+            uint32_t body = statement();
+            _nodes[n].a = condition;
+            _nodes[n].b = body;
+            return n;
+        }
+        case Token::For: {
+            _scanner.retireToken();
+            uint32_t n = node(Kind::For);
+            expect(Token::LParen, "'('");
+            uint32_t init = 0;
+            if (accept(Token::Var)) {
+                init = varStatement();
+            } else if (!accept(Token::Semicolon)) {
+                init = node(Kind::Expression);
+                uint32_t e = expression();
+                _nodes[init].a = e;
+                expect(Token::Semicolon, "';'");
+            }
+            uint32_t condition = 0;
+            if (!accept(Token::Semicolon)) {
+                condition = expression();
+                expect(Token::Semicolon, "';'");
+            }
+            uint32_t step = (_scanner.getToken() != Token::RParen) ? expression() : 0;
+            expect(Token::RParen, "')'");
+            uint32_t body = statement();
+            _nodes[n].a = init;
+            _nodes[n].b = condition;
+            _nodes[n].c = step;
+            _nodes[n].d = body;
+            return n;
+        }
+        case Token::Break:
+        case Token::Continue: {
+            _scanner.retireToken();
+            uint32_t n = node((token == Token::Break) ? Kind::Break : Kind::Continue);
+            endStatement();
+            return n;
+        }
+        case Token::Return: {
+            _scanner.retireToken();
+            uint32_t n = node(Kind::Return);
+            Token next = _scanner.getToken();
+            if (next != Token::Semicolon && next != Token::RBrace && next != Token::EndOfFile) {
+                uint32_t value = expression();
+                _nodes[n].a = value;
+            }
+            endStatement();
+            return n;
+        }
+        case Token::LBrace:
+            _scanner.retireToken();
+            return block();
+        case Token::Semicolon:
+            _scanner.retireToken();
+            return node(Kind::Block);
+        default: {
+            uint32_t n = node(Kind::Expression);
+            uint32_t e = expression();
+            _nodes[n].a = e;
+            endStatement();
+            return n;
+        }
+    }
+}
+
+uint32_t TreeWalker::block()
+{
+    uint32_t n = node(Kind::Block);
+    uint32_t last = 0;
+    while (_error.empty() && _scanner.getToken() != Token::RBrace && _scanner.getToken() != Token::EndOfFile) {
+        uint32_t statementNode = statement();
+        if (last) {
+            _nodes[last].next = statementNode;
+        } else {
+            _nodes[n].a = statementNode;
+        }
+        last = statementNode;
+    }
+    expect(Token::RBrace, "'}'");
+    return n;
+}
+
+// Declarations go in a Block, so a statement is always one node
+uint32_t TreeWalker::varStatement()
+{
+    uint32_t n = node(Kind::Block);
+    uint32_t last = 0;
+    do {
+        uint32_t declaration = node(Kind::Var);
+        Atom id = name("variable name");
+        uint32_t init = accept(Token::STO) ? expression() : 0;
+        _nodes[declaration].name = id;
+        _nodes[declaration].a = init;
+        if (last) {
+            _nodes[last].next = declaration;
+        } else {
+            _nodes[n].a = declaration;
+        }
+        last = declaration;
+    } while (_error.empty() && accept(Token::Comma));
+    endStatement();
+    return n;
+}
+
+uint32_t TreeWalker::functionDeclaration()
+{
+    uint32_t n = node(Kind::Function);
+    Atom id = name("function name");
+    _nodes[n].name = id;
+    
+    expect(Token::LParen, "'('");
+    uint32_t last = 0;
+    uint32_t count = 0;
+    if (!accept(Token::RParen)) {
+        do {
+            uint32_t param = node(Kind::Name);
+            Atom paramName = name("parameter name");
+            _nodes[param].name = paramName;
+            if (last) {
+                _nodes[last].next = param;
+            } else {
+                _nodes[n].a = param;
+            }
+            last = param;
+            ++count;
+        } while (_error.empty() && accept(Token::Comma));
+        expect(Token::RParen, "')'");
+    }
+    expect(Token::LBrace, "'{'");
+    uint32_t body = block();
+    _nodes[n].b = body;
+    _nodes[n].c = count;
+    return n;
+}
+
+uint32_t TreeWalker::expression()
+{
+    uint32_t condition = binary(1);
+    if (!accept(Token::Question)) {
+        return condition;
+    }
+    uint32_t n = node(Kind::Conditional);
+    uint32_t then = expression();
+    expect(Token::Colon, "':'");
+    uint32_t otherwise = expression();
+    _nodes[n].a = condition;
+    _nodes[n].b = then;
+    _nodes[n].c = otherwise;
+    return n;
+}
+
+uint32_t TreeWalker::binary(uint8_t minPrecedence)
+{
+    uint32_t left = unary();
+    for ( ; ; ) {
+        Token op = _scanner.getToken();
+        uint8_t opPrecedence = Compiler::precedence(op);
+        if (!_error.empty() || opPrecedence == 0 || opPrecedence < minPrecedence) {
+            return left;
+        }
+        _scanner.retireToken();
+        uint32_t n = node((op == Token::LAND || op == Token::LOR) ? Kind::Logical : Kind::Binary);
+        uint32_t right = binary(opPrecedence + 1);
+        _nodes[n].op = op;
+        _nodes[n].a = left;
+        _nodes[n].b = right;
+        left = n;
+    }
+}
+
+uint32_t TreeWalker::unary()
+{
+    Token op = _scanner.getToken();
+    if (op == Token::Minus || op == Token::Bang || op == Token::Twiddle) {
+        _scanner.retireToken();
+        uint32_t n = node(Kind::Unary);
+        uint32_t operand = unary();
+        _nodes[n].op = op;
+        _nodes[n].a = operand;
+        return n;
+    }
+    if (op == Token::INC || op == Token::DEC) {
+        _scanner.retireToken();
+        uint32_t n = node(Kind::Inc);
+        Atom id = name("variable after ++ or --");
+        _nodes[n].op = op;
+        _nodes[n].name = id;
+        _nodes[n].c = 1;
+        return n;
+    }
+    
+    uint32_t callee = primary();
+    while (_error.empty() && accept(Token::LParen)) {
+        uint32_t n = node(Kind::Call);
+        _nodes[n].a = callee;
+        uint32_t last = 0;
+        if (!accept(Token::RParen)) {
+            do {
+                uint32_t arg = expression();
+                if (last) {
+                    _nodes[last].next = arg;
+                } else {
+                    _nodes[n].b = arg;
+                }
+                last = arg;
+            } while (_error.empty() && accept(Token::Comma));
+            expect(Token::RParen, "')'");
+        }
+        callee = n;
+    }
+    return callee;
+}
+
+uint32_t TreeWalker::primary()
+{
+    Token token = _scanner.getToken();
+    switch (token) {
+        case Token::Integer:
+        case Token::Float: {
+            uint32_t n = node(Kind::Number);
+            _nodes[n].number = (token == Token::Integer) ? bare::Float(static_cast<double>(_scanner.getTokenValue().integer)) : _scanner.getTokenValue().number;
+            _scanner.retireToken();
+            return n;
+        }
+        case Token::String: {
+            uint32_t n = node(Kind::String);
+            _nodes[n].name = _scanner.getTokenValue().atom;
+            _scanner.retireToken();
+            return n;
+        }
+        case Token::True:
+        case Token::False:
+        case Token::Null:
+            _scanner.retireToken();
+            return node((token == Token::True) ? Kind::True : ((token == Token::False) ? Kind::False : Kind::Null));
+        case Token::LParen: {
+            _scanner.retireToken();
+            uint32_t n = expression();
+            expect(Token::RParen, "')'");
+            return n;
+        }
+        case Token::Identifier: {
+            Atom id = name("name");
+            Token op = _scanner.getToken();
+            if (op == Token::INC || op == Token::DEC) {
+                _scanner.retireToken();
+                uint32_t n = node(Kind::Inc);
+                _nodes[n].op = op;
+                _nodes[n].name = id;
+                return n;
+            }
+            if (op == Token::STO || (op >= Token::SHRSTO && op <= Token::ORSTO)) {
+                _scanner.retireToken();
+                uint32_t n = node(Kind::Assign);
+                uint32_t value = expression();
+                _nodes[n].op = op;
+                _nodes[n].name = id;
+                _nodes[n].a = value;
+                return n;
+            }
+            uint32_t n = node(Kind::Name);
+            _nodes[n].name = id;
+            return n;
+        }
+        default:
+            if (_error.empty()) {
+                _error = "expected an expression";
+                _errorLine = _scanner.lineno();
+            }
+            return 0;
+    }
+}
+
+Atom TreeWalker::name(const char* what)
+{
+    if (_scanner.getToken() != Token::Identifier) {
+        expect(Token::Identifier, what);
+        return 0;
+    }
+    Atom id = _scanner.getTokenValue().atom;
+    _scanner.retireToken();
+    return id;
+}
+
+void TreeWalker::endStatement()
+{
+    Token token = _scanner.getToken();
+    if (!accept(Token::Semicolon) && token != Token::RBrace && token != Token::EndOfFile) {
+        expect(Token::Semicolon, "';'");
+    }
+}
+
+bool TreeWalker::accept(Token token)
+{
+    if (_scanner.getToken() != token) {
+        return false;
+    }
+    _scanner.retireToken();
+    return true;
+}
+
+bool TreeWalker::expect(Token token, const char* what)
+{
+    if (accept(token)) {
+        return true;
+    }
+    if (_error.empty()) {
+        _error = "expected ";
+        _error += what;
+        _errorLine = _scanner.lineno();
+    }
+    return false;
+}
+
+bool TreeWalker::run()
+{
+    _error.clear();
+    _globals.clear();
+    _locals = nullptr;
+    _depth = 0;
+    
+    for (uint32_t i = 0; i < static_cast<uint32_t>(Native::Count); ++i) {
+        Atom id = _scanner.atoms().find(nativeName(static_cast<Native>(i)));
+        if (id != NoAtom) {
+            _globals.push_back({ id, Value::native(i) });
+        }
+    }
+    for (uint32_t n = _nodes[_program].a; n; n = _nodes[n].next) {
+        if (_nodes[n].kind == Kind::Function) {
+            assign(_nodes[n].name, Value::function(n));
+        }
+    }
+    
+    Value result;
+    return exec(_program, result) != Flow::Error;
+}
+
+TreeWalker::Flow TreeWalker::exec(uint32_t index, Value& result)
+{
+    const Node& n = _nodes[index];
+    switch (n.kind) {
+        case Kind::Block:
+            for (uint32_t statementNode = n.a; statementNode; statementNode = _nodes[statementNode].next) {
+                Flow flow = exec(statementNode, result);
+                if (flow != Flow::Normal) {
+                    return flow;
+                }
+            }
+            return Flow::Normal;
+        case Kind::Var: {
+            Value value = n.a ? eval(n.a) : Value();
+            if (_locals) {
+                for (Binding& binding : *_locals) {
+                    if (binding.name == n.name) {
+                        if (n.a) {
+                            binding.value = value;
+                        }
+                        return _error.empty() ? Flow::Normal : Flow::Error;
+                    }
+                }
+                _locals->push_back({ n.name, value });
+            } else if (n.a || !lookup(n.name)) {
+                assign(n.name, value);
+            }
+            break;
+        }
+        case Kind::Function:
+            break;
+        case Kind::If:
+            if (eval(n.a).toBool()) {
+                return exec(n.b, result);
+            }
+            if (n.c && _error.empty()) {
+                return exec(n.c, result);
+            }
+            break;
+        case Kind::While:
+        case Kind::For: {
+            bool isFor = n.kind == Kind::For;
+            uint32_t condition = isFor ? n.b : n.a;
+            uint32_t body = isFor ? n.d : n.b;
+            if (isFor && n.a && exec(n.a, result) == Flow::Error) {
+                return Flow::Error;
+            }
+            while (_error.empty() && (!condition || eval(condition).toBool()) && _error.empty()) {
+                Flow flow = exec(body, result);
+                if (flow == Flow::Break) {
+                    break;
+                }
+                if (flow == Flow::Return || flow == Flow::Error) {
+                    return flow;
+                }
+                if (isFor && n.c) {
+                    eval(n.c);
+                }
+            }
+            break;
+        }
+        case Kind::Break: return Flow::Break;
+        case Kind::Continue: return Flow::Continue;
+        case Kind::Return:
+            result = n.a ? eval(n.a) : Value();
+            return _error.empty() ? Flow::Return : Flow::Error;
+        case Kind::Expression:
+            eval(n.a);
+            break;
+        default:
+            break;
+    }
+    return _error.empty() ? Flow::Normal : Flow::Error;
+}
+
+Value TreeWalker::eval(uint32_t index)
+{
+    if (!_error.empty()) {
+        return Value();
+    }
+    
+    const Node& n = _nodes[index];
+    switch (n.kind) {
+        case Kind::Number: return n.number;
+        case Kind::String: return Value::string(n.name);
+        case Kind::True: return Value::boolean(true);
+        case Kind::False: return Value::boolean(false);
+        case Kind::Null: return Value();
+        case Kind::Name: {
+            Value* value = lookup(n.name);
+            return value ? *value : Value();
+        }
+        case Kind::Assign: {
+            // A compound assignment reads the variable before the right
+            // side, which may assign it too
+            Value current;
+            if (n.op != Token::STO) {
+                Value* variable = lookup(n.name);
+                current = variable ? *variable : Value();
+            }
+            Value value = eval(n.a);
+            if (n.op != Token::STO) {
+                Node op = n;
+                
+                // compound[i] is ops[i] followed by =
+                static const Token ops[] = {
+                    Token::Plus, Token::Minus, Token::Star, Token::Slash, Token::Percent,
+                    Token::Ampersand, Token::OR, Token::XOR, Token::SHL, Token::SHR, Token::SAR,
+                };
+                static const Token compound[] = {
+                    Token::ADDSTO, Token::SUBSTO, Token::MULSTO, Token::DIVSTO, Token::MODSTO,
+                    Token::ANDSTO, Token::ORSTO, Token::XORSTO, Token::SHLSTO, Token::SHRSTO, Token::SARSTO,
+                };
+                for (uint32_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+                    if (compound[i] == n.op) {
+                        op.op = ops[i];
+                    }
+                }
+                value = binaryOp(op, current, value);
+            }
+            assign(n.name, value);
+            return value;
+        }
+        case Kind::Binary: {
+            Value left = eval(n.a);
+            Value right = eval(n.b);
+            return binaryOp(n, left, right);
+        }
+        case Kind::Logical: {
+            Value left = eval(n.a);
+            if (left.toBool() == (n.op == Token::LOR)) {
+                return left;
+            }
+            return eval(n.b);
+        }
+        case Kind::Unary: {
+            Value operand = eval(n.a);
+            if (n.op == Token::Bang) {
+                return Value::boolean(!operand.toBool());
+            }
+            if (!operand.isNumber()) {
+                return fail("operand must be a number", n);
+            }
+            return (n.op == Token::Minus) ? Value(-operand.number()) : Value(bare::Float(~static_cast<int32_t>(operand.number())));
+        }
+        case Kind::Inc: {
+            Value* current = lookup(n.name);
+            Value old = current ? *current : Value();
+            if (!old.isNumber()) {
+                return fail("operand of ++ or -- must be a number", n);
+            }
+            Value value = old.number() + ((n.op == Token::INC) ? bare::Float(1) : bare::Float(-1));
+            assign(n.name, value);
+            return n.c ? value : old;
+        }
+        case Kind::Conditional:
+            return eval(eval(n.a).toBool() ? n.b : n.c);
+        case Kind::Call:
+            return call(n);
+        default:
+            return Value();
+    }
+}
+
+Value TreeWalker::call(const Node& n)
+{
+    Value callee = eval(n.a);
+    std::vector<Value> args;
+    for (uint32_t arg = n.b; arg; arg = _nodes[arg].next) {
+        args.push_back(eval(arg));
+    }
+    if (!_error.empty()) {
+        return Value();
+    }
+    
+    if (callee.type() == Value::Type::Native) {
+        switch (static_cast<Native>(callee.index())) {
+            case Native::Print:
+                for (size_t i = 0; i < args.size(); ++i) {
+                    if (i > 0) {
+                        _sink.write(" ", 1);
+                    }
+                    printValue(args[i]);
+                }
+                _sink.write("\n", 1);
+                break;
+            case Native::Time:
+                return bare::Float(static_cast<int32_t>(bare::Timer::systemTime() / 1000));
+            case Native::Sleep:
+                if (!args.empty() && args[0].isNumber() && static_cast<int32_t>(args[0].number()) > 0) {
+                    bare::Timer::usleep(static_cast<uint32_t>(static_cast<int32_t>(args[0].number())) * 1000);
+                }
+                break;
+            default:
+                break;
+        }
+        return Value();
+    }
+    if (callee.type() != Value::Type::Function) {
+        return fail("value is not a function", n);
+    }
+    if (_depth >= MaxDepth) {
+        return fail("stack overflow", n);
+    }
+    
+    const Node& function = _nodes[callee.index()];
+    std::vector<Binding> locals;
+    uint32_t i = 0;
+    for (uint32_t param = function.a; param; param = _nodes[param].next, ++i) {
+        locals.push_back({ _nodes[param].name, (i < args.size()) ? args[i] : Value() });
+    }
+    
+    std::vector<Binding>* outer = _locals;
+    _locals = &locals;
+    ++_depth;
+    Value result;
+    Flow flow = exec(function.b, result);
+    --_depth;
+    _locals = outer;
+    return (flow == Flow::Return) ? result : Value();
+}
+
+Value* TreeWalker::lookup(Atom name)
+{
+    if (_locals) {
+        for (Binding& binding : *_locals) {
+            if (binding.name == name) {
+                return &binding.value;
+            }
+        }
+    }
+    for (Binding& binding : _globals) {
+        if (binding.name == name) {
+            return &binding.value;
+        }
+    }
+    return nullptr;
+}
+
+void TreeWalker::assign(Atom name, const Value& value)
+{
+    Value* current = lookup(name);
+    if (current) {
+        *current = value;
+    } else {
+        _globals.push_back({ name, value });
+    }
+}
+
+Value TreeWalker::binaryOp(const Node& n, const Value& left, const Value& right)
+{
+    if (n.op == Token::EQ || n.op == Token::NE) {
+        return Value::boolean((left == right) == (n.op == Token::EQ));
+    }
+    if (!left.isNumber() || !right.isNumber()) {
+        return fail("operands must be numbers", n);
+    }
+    
+    bare::Float a = left.number();
+    bare::Float b = right.number();
+    int32_t ia = static_cast<int32_t>(a);
+    int32_t ib = static_cast<int32_t>(b);
+    switch (n.op) {
+        case Token::Plus: return a + b;
+        case Token::Minus: return a - b;
+        case Token::Star: return a * b;
+        case Token::Slash: return a / b;
+        case Token::Percent: return a % b;
+        case Token::LT: return Value::boolean(a < b);
+        case Token::LE: return Value::boolean(a <= b);
+        case Token::GT: return Value::boolean(a > b);
+        case Token::GE: return Value::boolean(a >= b);
+        case Token::Ampersand: return bare::Float(ia & ib);
+        case Token::OR: return bare::Float(ia | ib);
+        case Token::XOR: return bare::Float(ia ^ ib);
+        case Token::SHL: return bare::Float(static_cast<int32_t>(static_cast<uint32_t>(ia) << (ib & 0x1f)));
+        case Token::SHR: return bare::Float(ia >> (ib & 0x1f));
+        case Token::SAR: {
+            uint32_t result = static_cast<uint32_t>(ia) >> (ib & 0x1f);
+            return (result > 0x7fffffff) ? bare::Float(static_cast<double>(result)) : bare::Float(static_cast<int32_t>(result));
+        }
+        default: return Value();
+    }
+}
+
+void TreeWalker::printValue(const Value& value)
+{
+    switch (value.type()) {
+        case Value::Type::Null: bare::Print::format(_sink, "null"); break;
+        case Value::Type::Bool: bare::Print::format(_sink, value.toBool() ? "true" : "false"); break;
+        case Value::Type::Number: bare::Print::format(_sink, "%g", value.number().toArg()); break;
+        case Value::Type::String: bare::Print::format(_sink, "%s", _scanner.atoms().name(value.index())); break;
+        case Value::Type::Function: bare::Print::format(_sink, "<function %s>", _scanner.atoms().name(_nodes[value.index()].name)); break;
+        case Value::Type::Native: bare::Print::format(_sink, "<native %s>", nativeName(static_cast<Native>(value.index()))); break;
+    }
+}
+
+Value TreeWalker::fail(const char* message, const Node& n)
+{
+    if (_error.empty()) {
+        _error = message;
+        _errorLine = n.line;
+    }
+    return Value();
+}
@@ -0,0 +1,131 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Program.h"
+#include "Scanner.h"
+#include "bare/Print.h"
+
+namespace placid {
+
+    // TreeWalker - Reference interpreter for the script language
+    //
+    // Parses the same language as Compiler into a syntax tree and runs it by
+    // walking the tree, looking variables up by name as it goes. It is the
+    // straightforward way to run a script and is only here as the baseline
+    // the VM is measured against by the vm benchmark.
+    class TreeWalker
+    {
+    public:
+        TreeWalker(Stream* stream, bare::Print::Sink& sink) : _scanner(stream), _sink(sink) { }
+        
+        // Returns false on a syntax error
+        bool parse();
+        
+        // Returns false on a runtime error. Can be run more than once
+        bool run();
+        
+        const char* error() const { return _error.c_str(); }
+        uint32_t line() const { return _errorLine; }
+        
+    private:
+        static constexpr uint32_t MaxDepth = 64;
+        
+        enum class Kind : uint8_t {
+            Number, String, True, False, Null, Name, Assign, Binary, Logical, Unary, Inc, Conditional, Call,
+            Var, Block, If, While, For, Break, Continue, Return, Expression, Function,
+        };
+        
+        // Children are node indexes, with 0 for none. Lists (statements,
+        // arguments, parameters) are chained through next
+        struct Node
+        {
+            Kind kind;
+            Token op = Token::EndOfFile;
+            uint16_t line = 0;
+            Atom name = 0; // of a variable, or the text of a String
+            uint32_t a = 0, b = 0, c = 0, d = 0;
+            uint32_t next = 0;
+            bare::Float number;
+        };
+        
+        enum class Flow { Normal, Break, Continue, Return, Error };
+        
+        struct Binding
+        {
+            Atom name;
+            Value value;
+        };
+        
+        // Parser
+        uint32_t node(Kind);
+        uint32_t statement();
+        uint32_t block();
+        uint32_t varStatement();
+        uint32_t functionDeclaration();
+        uint32_t expression();
+        uint32_t binary(uint8_t minPrecedence);
+        uint32_t unary();
+        uint32_t primary();
+        Atom name(const char*);
+        void endStatement();
+        bool accept(Token);
+        bool expect(Token, const char* what);
+        
+        // Evaluator
+        Flow exec(uint32_t node, Value& result);
+        Value eval(uint32_t node);
+        Value call(const Node&);
+        Value* lookup(Atom name);
+        void assign(Atom name, const Value&);
+        Value binaryOp(const Node&, const Value& left, const Value& right);
+        void printValue(const Value&);
+        Value fail(const char* message, const Node&);
+        
+        Scanner _scanner;
+        bare::Print::Sink& _sink;
+        std::vector<Node> _nodes;
+        uint32_t _program = 0;
+        
+        std::vector<Binding> _globals;
+        std::vector<Binding>* _locals = nullptr;
+        uint32_t _depth = 0;
+        
+        bare::String _error;
+        uint32_t _errorLine = 0;
+    };
+
+}
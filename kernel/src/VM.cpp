@@ -0,0 +1,340 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#include "VM.h"
+
+#include "bare/Timer.h"
+
+using namespace placid;
+
+#if defined(__GNUC__)
+#define PLACID_COMPUTED_GOTO 1
+#else
+#define PLACID_COMPUTED_GOTO 0
+#endif
+
+// Checked on backward jumps and calls, so a program stops even if it's
+// stuck in a loop or recursing
+bool VM::shouldStop(uint32_t& countdown)
+{
+    if (_stopRequested) {
+        return true;
+    }
+    if (--countdown) {
+        return false;
+    }
+    countdown = PollInterval;
+    if (_stopCheck && _stopCheck()) {
+        _stopRequested = true;
+    }
+    return _stopRequested;
+}
+
+bool VM::run()
+{
+    const std::vector<Function>& functions = _program.functions();
+    const std::vector<bare::Float>& constants = _program.constants();
+    
+    _error.clear();
+    _globals.assign(_program.globals().size(), Value());
+    for (uint32_t i = 0; i < static_cast<uint32_t>(Native::Count); ++i) {
+        _globals[i] = Value::native(i);
+    }
+    for (uint32_t i = 1; i < functions.size(); ++i) {
+        _globals[functions[i].global] = Value::function(i);
+    }
+    
+    _stack.assign(StackSize, Value());
+    Value* stackEnd = _stack.data() + _stack.size();
+    
+    Frame frames[MaxFrames];
+    uint32_t depth = 0;
+    
+    _stopRequested = false;
+    uint32_t countdown = PollInterval;
+    
+    const Function* fn = &functions[0];
+    const Instruction* pc = fn->code.data();
+    Value* base = _stack.data();
+    if (base + fn->registers > stackEnd) {
+        return fail("stack overflow", fn, pc + 1);
+    }
+    
+    Instruction i;
+    
+    #define RA base[i.a()]
+    #define RB base[i.b()]
+    #define RC base[i.c()]
+    #define VM_ERROR(message) return fail(message, fn, pc)
+    
+#if PLACID_COMPUTED_GOTO
+    #define PLACID_OP_LABEL(name) &&L_##name,
+    static const void* const labels[] = { PLACID_OPS(PLACID_OP_LABEL) };
+    #undef PLACID_OP_LABEL
+    
+    #define VM_CASE(name) L_##name:
+    #define VM_NEXT() do { i = *pc++; goto *labels[static_cast<uint8_t>(i.op())]; } while (0)
+    
+    VM_NEXT();
+    {
+#else
+    #define VM_CASE(name) case Op::name:
+    #define VM_NEXT() break
+    
+    for ( ; ; ) {
+        i = *pc++;
+        switch (i.op()) {
+#endif
+        VM_CASE(Move) RA = RB; VM_NEXT();
+        VM_CASE(LoadK) RA = constants[i.bx()]; VM_NEXT();
+        VM_CASE(LoadS) RA = Value::string(i.bx()); VM_NEXT();
+        VM_CASE(LoadNull) RA = Value(); VM_NEXT();
+        VM_CASE(LoadTrue) RA = Value::boolean(true); VM_NEXT();
+        VM_CASE(LoadFalse) RA = Value::boolean(false); VM_NEXT();
+        VM_CASE(GetGlobal) RA = _globals[i.bx()]; VM_NEXT();
+        VM_CASE(SetGlobal) _globals[i.bx()] = RA; VM_NEXT();
+        
+        #define VM_ARITH(name, op) \
+            VM_CASE(name) \
+                if (!RB.isNumber() || !RC.isNumber()) { \
+                    VM_ERROR("operands of " #op " must be numbers"); \
+                } \
+                RA = RB.number() op RC.number(); \
+                VM_NEXT();
+
+        VM_ARITH(Add, +)
+        VM_ARITH(Sub, -)
+        VM_ARITH(Mul, *)
+        VM_ARITH(Div, /)
+        VM_ARITH(Mod, %)
+        #undef VM_ARITH
+        
+        // Bitwise operators work on the number truncated to 32 bits
+        #define VM_BITWISE(name, op, type) \
+            VM_CASE(name) \
+                if (!RB.isNumber() || !RC.isNumber()) { \
+                    VM_ERROR("operands of " #op " must be numbers"); \
+                } \
+                RA = bare::Float(static_cast<int32_t>(static_cast<type>(static_cast<int32_t>(RB.number())) op static_cast<type>(static_cast<int32_t>(RC.number())))); \
+                VM_NEXT();
+        
+        VM_BITWISE(BitAnd, &, int32_t)
+        VM_BITWISE(BitOr, |, int32_t)
+        VM_BITWISE(BitXor, ^, int32_t)
+        #undef VM_BITWISE
+        
+        #define VM_SHIFT(name, op, type) \
+            VM_CASE(name) \
+                if (!RB.isNumber() || !RC.isNumber()) { \
+                    VM_ERROR("operands of " #op " must be numbers"); \
+                } \
+                RA = bare::Float(static_cast<int32_t>(static_cast<type>(static_cast<int32_t>(RB.number())) op (static_cast<int32_t>(RC.number()) & 0x1f))); \
+                VM_NEXT();
+        
+        VM_SHIFT(Shl, <<, uint32_t)
+        VM_SHIFT(Shr, >>, int32_t)
+        #undef VM_SHIFT
+        
+        VM_CASE(UShr) {
+            if (!RB.isNumber() || !RC.isNumber()) {
+                VM_ERROR("operands of >>> must be numbers");
+            }
+            // The result is unsigned, so it may not fit in an int32_t
+            uint32_t result = static_cast<uint32_t>(static_cast<int32_t>(RB.number())) >> (static_cast<int32_t>(RC.number()) & 0x1f);
+            RA = (result > 0x7fffffff) ? bare::Float(static_cast<double>(result)) : bare::Float(static_cast<int32_t>(result));
+            VM_NEXT();
+        }
+        
+        VM_CASE(Eq) RA = Value::boolean(RB == RC); VM_NEXT();
+        VM_CASE(Ne) RA = Value::boolean(RB != RC); VM_NEXT();
+        
+        #define VM_COMPARE(name, op) \
+            VM_CASE(name) \
+                if (!RB.isNumber() || !RC.isNumber()) { \
+                    VM_ERROR("operands of " #op " must be numbers"); \
+                } \
+                RA = Value::boolean(RB.number() op RC.number()); \
+                VM_NEXT();
+
+        VM_COMPARE(Lt, <)
+        VM_COMPARE(Le, <=)
+        VM_COMPARE(Gt, >)
+        VM_COMPARE(Ge, >=)
+        #undef VM_COMPARE
+        
+        VM_CASE(Inc)
+            if (!RB.isNumber()) {
+                VM_ERROR("operand of ++ must be a number");
+            }
+            RA = RB.number() + bare::Float(1);
+            VM_NEXT();
+        VM_CASE(Dec)
+            if (!RB.isNumber()) {
+                VM_ERROR("operand of -- must be a number");
+            }
+            RA = RB.number() - bare::Float(1);
+            VM_NEXT();
+        VM_CASE(Neg)
+            if (!RB.isNumber()) {
+                VM_ERROR("operand of - must be a number");
+            }
+            RA = -RB.number();
+            VM_NEXT();
+        VM_CASE(Not) RA = Value::boolean(!RB.toBool()); VM_NEXT();
+        VM_CASE(BitNot)
+            if (!RB.isNumber()) {
+                VM_ERROR("operand of ~ must be a number");
+            }
+            RA = bare::Float(~static_cast<int32_t>(RB.number()));
+            VM_NEXT();
+        
+        VM_CASE(Jump)
+            if (i.sbx() < 0 && shouldStop(countdown)) {
+                VM_ERROR("stopped");
+            }
+            pc += i.sbx();
+            VM_NEXT();
+        VM_CASE(JumpIfFalse)
+            if (!RA.toBool()) {
+                pc += i.sbx();
+            }
+            VM_NEXT();
+        VM_CASE(JumpIfTrue)
+            if (RA.toBool()) {
+                pc += i.sbx();
+            }
+            VM_NEXT();
+        
+        VM_CASE(Call) {
+            if (shouldStop(countdown)) {
+                VM_ERROR("stopped");
+            }
+            const Value& callee = RA;
+            if (callee.type() == Value::Type::Native) {
+                RA = callNative(static_cast<Native>(callee.index()), &RA + 1, i.b());
+                VM_NEXT();
+            }
+            if (callee.type() != Value::Type::Function) {
+                VM_ERROR("value is not a function");
+            }
+            
+            const Function* target = &functions[callee.index()];
+            Value* newBase = &RA + 1;
+            if (depth >= MaxFrames || newBase + target->registers > stackEnd) {
+                VM_ERROR("stack overflow");
+            }
+            for (uint32_t arg = i.b(); arg < target->params; ++arg) {
+                newBase[arg] = Value();
+            }
+            
+            frames[depth++] = { fn, pc, base };
+            fn = target;
+            pc = fn->code.data();
+            base = newBase;
+            VM_NEXT();
+        }
+        
+        VM_CASE(Return)
+        VM_CASE(ReturnNull) {
+            Value result = (i.op() == Op::Return) ? RA : Value();
+            if (depth == 0) {
+                return true;
+            }
+            base[-1] = result;
+            const Frame& frame = frames[--depth];
+            fn = frame.function;
+            pc = frame.pc;
+            base = frame.base;
+            VM_NEXT();
+        }
+#if !PLACID_COMPUTED_GOTO
+        default:
+            VM_ERROR("invalid instruction");
+        }
+#endif
+    }
+    
+    #undef RA
+    #undef RB
+    #undef RC
+    #undef VM_ERROR
+    #undef VM_CASE
+    #undef VM_NEXT
+}
+
+Value VM::callNative(Native native, const Value* args, uint32_t count)
+{
+    switch (native) {
+        case Native::Print:
+            for (uint32_t i = 0; i < count; ++i) {
+                if (i > 0) {
+                    _sink.write(" ", 1);
+                }
+                printValue(args[i]);
+            }
+            _sink.write("\n", 1);
+            return Value();
+        case Native::Time:
+            return bare::Float(static_cast<int32_t>(bare::Timer::systemTime() / 1000));
+        case Native::Sleep:
+            if (count > 0 && args[0].isNumber() && static_cast<int32_t>(args[0].number()) > 0) {
+                bare::Timer::usleep(static_cast<uint32_t>(static_cast<int32_t>(args[0].number())) * 1000);
+            }
+            return Value();
+        default:
+            return Value();
+    }
+}
+
+void VM::printValue(const Value& value)
+{
+    switch (value.type()) {
+        case Value::Type::Null: bare::Print::format(_sink, "null"); break;
+        case Value::Type::Bool: bare::Print::format(_sink, value.toBool() ? "true" : "false"); break;
+        case Value::Type::Number: bare::Print::format(_sink, "%g", value.number().toArg()); break;
+        case Value::Type::String: bare::Print::format(_sink, "%s", _program.strings()[value.index()].c_str()); break;
+        case Value::Type::Function: bare::Print::format(_sink, "<function %s>", _program.functions()[value.index()].name.c_str()); break;
+        case Value::Type::Native: bare::Print::format(_sink, "<native %s>", nativeName(static_cast<Native>(value.index()))); break;
+    }
+}
+
+// pc has already moved past the failing instruction
+bool VM::fail(const char* message, const Function* fn, const Instruction* pc)
+{
+    _error = message;
+    size_t index = static_cast<size_t>(pc - fn->code.data()) - 1;
+    _errorLine = (index < fn->lines.size()) ? fn->lines[index] : 0;
+    return false;
+}
@@ -0,0 +1,101 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Program.h"
+#include "bare/Print.h"
+
+namespace placid {
+
+    // VM - Runs a compiled Program
+    //
+    // Registers of all the active calls live in one value stack. A call
+    // puts the function and its arguments in consecutive registers of the
+    // caller and the callee's frame starts just after the function, so the
+    // arguments are already its first registers. The return value replaces
+    // the function in the caller's register.
+    //
+    // Dispatch is a computed goto when the compiler supports it, one
+    // indirect branch per instruction, otherwise a switch.
+    class VM
+    {
+    public:
+        VM(const Program& program, bare::Print::Sink& sink) : _program(program), _sink(sink) { }
+        
+        // Returns false on a runtime error, described by error() and line()
+        bool run();
+        
+        // Polled while the program runs to see if it should stop, such as
+        // on a Ctrl-C from the serial port. Not called on every backward
+        // jump and call, but every PollInterval of them
+        using StopCheck = bool (*)();
+        void setStopCheck(StopCheck check) { _stopCheck = check; }
+        
+        // Makes the running program fail with "stopped" at its next backward
+        // jump or call. Safe to call from an interrupt handler
+        void stop() { _stopRequested = true; }
+        
+        const char* error() const { return _error.c_str(); }
+        uint32_t line() const { return _errorLine; }
+        
+    private:
+        static constexpr uint32_t StackSize = 1024;
+        static constexpr uint32_t MaxFrames = 64;
+        static constexpr uint32_t PollInterval = 1024;
+        
+        struct Frame
+        {
+            const Function* function;
+            const Instruction* pc;
+            Value* base;
+        };
+        
+        bool shouldStop(uint32_t& countdown);
+        Value callNative(Native, const Value* args, uint32_t count);
+        void printValue(const Value&);
+        bool fail(const char* message, const Function*, const Instruction* pc);
+        
+        const Program& _program;
+        bare::Print::Sink& _sink;
+        StopCheck _stopCheck = nullptr;
+        volatile bool _stopRequested = false;
+        std::vector<Value> _stack;
+        std::vector<Value> _globals;
+        bare::String _error;
+        uint32_t _errorLine = 0;
+    };
+
+}
@@ -0,0 +1,95 @@
+/*-------------------------------------------------------------------------
+This source file is a part of Placid
+
+For the latest info, see http://www.marrin.org/
+
+Copyright (c) 2018, Chris Marrin
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+    - Redistributions of source code must retain the above copyright notice, 
+    this list of conditions and the following disclaimer.
+    
+    - Redistributions in binary form must reproduce the above copyright 
+    notice, this list of conditions and the following disclaimer in the 
+    documentation and/or other materials provided with the distribution.
+    
+    - Neither the name of the <ORGANIZATION> nor the names of its 
+    contributors may be used to endorse or promote products derived from 
+    this software without specific prior written permission.
+    
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+POSSIBILITY OF SUCH DAMAGE.
+-------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "bare.h"
+
+namespace placid {
+
+    // Value - A script value
+    //
+    // Tagged with its type. Numbers are bare::Float. Strings, functions and
+    // native functions are indexes into the string constants of the program,
+    // its function table and the native function table.
+    class Value
+    {
+    public:
+        enum class Type : uint8_t { Null, Bool, Number, String, Function, Native };
+        
+        Value() { }
+        Value(bare::Float number) : _type(Type::Number), _number(number) { }
+        
+        static Value boolean(bool b) { return Value(Type::Bool, b ? 1 : 0); }
+        static Value string(uint32_t index) { return Value(Type::String, index); }
+        static Value function(uint32_t index) { return Value(Type::Function, index); }
+        static Value native(uint32_t index) { return Value(Type::Native, index); }
+        
+        Type type() const { return _type; }
+        bool isNumber() const { return _type == Type::Number; }
+        
+        bare::Float number() const { return _number; }
+        uint32_t index() const { return _index; }
+        
+        bool toBool() const
+        {
+            switch (_type) {
+                case Type::Null: return false;
+                case Type::Bool: return _index != 0;
+                case Type::Number: return _number != bare::Float();
+                default: return true;
+            }
+        }
+        
+        // Strict equality. String constants are interned, so equal strings
+        // have equal indexes
+        bool operator==(const Value& other) const
+        {
+            if (_type != other._type) {
+                return false;
+            }
+            return (_type == Type::Number) ? (_number == other._number) : (_index == other._index);
+        }
+        bool operator!=(const Value& other) const { return !(*this == other); }
+
+    private:
+        Value(Type type, uint32_t index) : _type(type), _index(index) { }
+        
+        Type _type = Type::Null;
+        uint32_t _index = 0;
+        bare::Float _number;
+    };
+
+}
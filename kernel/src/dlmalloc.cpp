@@ -534,12 +534,24 @@ MAX_RELEASE_CHECK_RATE   default: 4095 unless not HAVE_MMAP
 #define MALLOC_FAILURE_ACTION
 #define USE_LOCKS 0
 
+// Keep the dl prefix so this can live alongside placid::Allocator. Which
+// one backs operator new is chosen in Allocator.cpp. mspaces are used to
+// replay allocation traces against a private heap
+#define USE_DL_PREFIX
+#define MSPACES 1
+
 #include <stddef.h>
 #include <stdint.h>
-#include "Print.h"
+#include "bare.h"
+#include "bare/Memory.h"
+#include "DLMalloc.h"
 
+#ifndef EINVAL
 #define EINVAL 1
+#endif
+#ifndef ENOMEM
 #define ENOMEM 2
+#endif
 
 #define PROT_READ       1
 #define PROT_WRITE      2
@@ -550,16 +562,23 @@ MAX_RELEASE_CHECK_RATE   default: 4095 unless not HAVE_MMAP
 #define MMAP(s)             _mapSegment(s)
 #define DIRECT_MMAP(s)      _mapSegment(s)
 #define MUNMAP(a, s)        _unmapSegment((a), (s))
-#define MUNMAP(a, s)        _unmapSegment((a), (s))
 
-extern void *_mapSegment(size_t length);
-extern int _unmapSegment(void *addr, size_t length);
+#define malloc_getpagesize  static_cast<size_t>(bare::Memory::DefaultPageSize)
+
+// Segments come from the kernel heap. An mspace which must stay out of it
+// is made with create_mspace_with_base() and kept from mapping any more
+static void* _mapSegment(size_t length)
+{
+    void* addr;
+    bool result = bare::Memory::mapSegment(length, addr);
+    
+    // dlmalloc expects MFAIL, not nullptr, on failure
+    return result ? addr : reinterpret_cast<void*>(~static_cast<uintptr_t>(0));
+}
 
-// Needed by dlmalloc to get page size
-extern "C" long sysconf(int name)
+static int _unmapSegment(void* addr, size_t length)
 {
-    // FIXME: Get this from some system info place
-    return 4096;
+    return bare::Memory::unmapSegment(addr, length);
 }
 
 /* Version identifier to allow people to support multiple versions */
@@ -4584,7 +4603,6 @@ static void* tmalloc_small(mstate m, size_t nb) {
 
 void* dlmalloc(size_t bytes) {
 
-placid::Print::printf("***** dlmalloc:enter, size=%d\n", bytes);
   /*
      Basic algorithm:
      If a small request (< 256 bytes minus per-chunk overhead):
@@ -4621,33 +4639,22 @@ placid::Print::printf("***** dlmalloc:enter, size=%d\n", bytes);
       nb = (bytes < MIN_REQUEST)? MIN_CHUNK_SIZE : pad_request(bytes);
       idx = small_index(nb);
       smallbits = gm->smallmap >> idx;
-placid::Print::printf("***** dlmalloc:3.1\n");
 
       if ((smallbits & 0x3U) != 0) { /* Remainderless fit to a smallbin. */
-placid::Print::printf("***** dlmalloc:3.2\n");
         mchunkptr b, p;
         idx += ~smallbits & 1;       /* Uses next bin if idx empty */
-placid::Print::printf("***** dlmalloc:3.3\n");
         b = smallbin_at(gm, idx);
         p = b->fd;
-placid::Print::printf("***** dlmalloc:3.3.2 (0x%08x, 0x%08x, 0x%08x, 0x%08x\n", p, chunksize(p), idx, small_index2size(idx));
         assert(chunksize(p) == small_index2size(idx));
-placid::Print::printf("***** dlmalloc:3.3.3 (%d, %d, %d, %d\n", gm, b, p, idx);
         unlink_first_small_chunk(gm, b, p, idx);
-placid::Print::printf("***** dlmalloc:3.3.4\n");
         set_inuse_and_pinuse(gm, p, small_index2size(idx));
-placid::Print::printf("***** dlmalloc:3.3.5\n");
         mem = chunk2mem(p);
-placid::Print::printf("***** dlmalloc:3.3.6\n");
         check_malloced_chunk(gm, mem, nb);
-placid::Print::printf("***** dlmalloc:3.3.7\n");
         goto postaction;
       }
 
       else if (nb > gm->dvsize) {
-placid::Print::printf("***** dlmalloc:3.4\n");
         if (smallbits != 0) { /* Use chunk in next nonempty smallbin */
-placid::Print::printf("***** dlmalloc:3.5\n");
           mchunkptr b, p, r;
           size_t rsize;
           bindex_t i;
@@ -4660,7 +4667,6 @@ placid::Print::printf("***** dlmalloc:3.5\n");
           unlink_first_small_chunk(gm, b, p, i);
           rsize = small_index2size(i) - nb;
           /* Fit here cannot be remainderless if 4byte sizes */
-placid::Print::printf("***** dlmalloc:3.6\n");
           if (SIZE_T_SIZE != 4 && rsize < MIN_CHUNK_SIZE)
             set_inuse_and_pinuse(gm, p, small_index2size(i));
           else {
@@ -4669,18 +4675,13 @@ placid::Print::printf("***** dlmalloc:3.6\n");
             set_size_and_pinuse_of_free_chunk(r, rsize);
             replace_dv(gm, r, rsize);
           }
-placid::Print::printf("***** dlmalloc:3.7\n");
           mem = chunk2mem(p);
-placid::Print::printf("***** dlmalloc:3.8\n");
           check_malloced_chunk(gm, mem, nb);
-placid::Print::printf("***** dlmalloc:3.9\n");
           goto postaction;
         }
 
         else if (gm->treemap != 0 && (mem = tmalloc_small(gm, nb)) != 0) {
-placid::Print::printf("***** dlmalloc:3.10\n");
           check_malloced_chunk(gm, mem, nb);
-placid::Print::printf("***** dlmalloc:3.11\n");
           goto postaction;
         }
       }
@@ -4691,14 +4692,11 @@ placid::Print::printf("***** dlmalloc:3.11\n");
       nb = pad_request(bytes);
       if (gm->treemap != 0 && (mem = tmalloc_large(gm, nb)) != 0) {
         check_malloced_chunk(gm, mem, nb);
-placid::Print::printf("***** dlmalloc:3.12\n");
         goto postaction;
       }
     }
 
-placid::Print::printf("***** dlmalloc:4\n");
     if (nb <= gm->dvsize) {
-placid::Print::printf("***** dlmalloc:4.1\n");
       size_t rsize = gm->dvsize - nb;
       mchunkptr p = gm->dv;
       if (rsize >= MIN_CHUNK_SIZE) { /* split dv */
@@ -4708,41 +4706,32 @@ placid::Print::printf("***** dlmalloc:4.1\n");
         set_size_and_pinuse_of_inuse_chunk(gm, p, nb);
       }
       else { /* exhaust dv */
-placid::Print::printf("***** dlmalloc:4.2\n");
         size_t dvs = gm->dvsize;
         gm->dvsize = 0;
         gm->dv = 0;
         set_inuse_and_pinuse(gm, p, dvs);
       }
-placid::Print::printf("***** dlmalloc:4.3\n");
       mem = chunk2mem(p);
       check_malloced_chunk(gm, mem, nb);
-placid::Print::printf("***** dlmalloc:4.4\n");
       goto postaction;
     }
 
     else if (nb < gm->topsize) { /* Split top */
-placid::Print::printf("***** dlmalloc:4.5\n");
       size_t rsize = gm->topsize -= nb;
       mchunkptr p = gm->top;
       mchunkptr r = gm->top = chunk_plus_offset(p, nb);
       r->head = rsize | PINUSE_BIT;
       set_size_and_pinuse_of_inuse_chunk(gm, p, nb);
-placid::Print::printf("***** dlmalloc:4.6\n");
       mem = chunk2mem(p);
       check_top_chunk(gm, gm->top);
       check_malloced_chunk(gm, mem, nb);
-placid::Print::printf("***** dlmalloc:4.7\n");
       goto postaction;
     }
 
-placid::Print::printf("***** dlmalloc:4.8\n");
     mem = sys_alloc(gm, nb);
-placid::Print::printf("***** dlmalloc:4.9\n");
 
   postaction:
     POSTACTION(gm);
-placid::Print::printf("***** dlmalloc:5, returned 0x%08x\n", mem);
     return mem;
   }
 
@@ -6042,6 +6031,13 @@ int mspace_mallopt(int param_number, int value) {
   return change_mparam(param_number, value);
 }
 
+// Added by placid
+size_t placid::mspaceExtent(void* msp)
+{
+    mstate ms = (mstate)msp;
+    return ok_magic(ms) ? ms->footprint - ms->topsize : 0;
+}
+
 #endif /* MSPACES */
 
 
@@ -36,6 +36,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "bare.h"
 
 #include "bare/GPIO.h"
+#include "bare/Log.h"
 #include "bare/Memory.h"
 #include "bare/Print.h"
 #include "bare/SDCard.h"
@@ -61,23 +62,12 @@ public:
 	}
 };
 
-static void timingTest(const char* s)
-{
-    // Timing test
-    int64_t startTime = bare::Timer::systemTime();
-    volatile uint32_t n = 0;
-    for (int i = 0; i < 1000000; ++i) {
-        n += i + 234;
-    }
-    bare::Serial::printf("*** Timing test %s: %d us\n", s, static_cast<uint32_t>(bare::Timer::systemTime() - startTime));
-}
-
 static void showTime()
 {
     static const char* days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
     
     bare::RealTime currentTime = bare::Timer::currentTime();
-    bare::Serial::printf("*** current time = %d:%d:%d %s %d/%d/%d\n",
+    bare::Serial::printf(FMT("*** current time = %d:%d:%d %s %d/%d/%d\n"),
         currentTime.hours(), currentTime.minutes(), currentTime.seconds(),
         days[currentTime.dayOfWeek()],
         currentTime.month(), currentTime.day(), currentTime.year());
@@ -91,76 +81,81 @@ int main()
     bare::Timer::init();
     char buffer[256];
     emb_snprintf(buffer, 255, "This is %s: num=%d, %d\n", "a test", 1234, 0);
-    bare::Serial::printf("%s", buffer);
-    bare::Serial::printf("This is %s: num=%d, %d\n", "a test", 1234, 0);
+    bare::Serial::printf(FMT("%s"), buffer);
+    bare::Serial::printf(FMT("This is %s: num=%d, %d\n"), "a test", 1234, 0);
 
     
+#if !defined(FLOATNONE)
     bare::Float f = 1234.56;
-    bare::Serial::printf("\n\nFloat value = %g\n\n", f.toArg());
+    bare::Serial::printf(FMT("\n\nFloat value = %g\n\n"), f);
+#endif
 
-    bare::Serial::printf("\n\nHex value = %#010x\n\n", 0x1234);
-    bare::Serial::printf("\n\nFloat value = %g\n\n", bare::Float(1234.5078).toArg());
+    bare::Serial::printf(FMT("\n\nHex value = %#010x\n\n"), 0x1234);
+#if !defined(FLOATNONE)
+    bare::Serial::printf(FMT("\n\nFloat value = %g\n\n"), bare::Float(1234.5078));
+#endif
 
-    bare::Serial::printf("\n\nWelcome to the Placid Kernel\n\n");
+    bare::Serial::printf(FMT("\n\nWelcome to the Placid Kernel\n\n"));
         
-    timingTest("Memory perf without cache");
     bare::Memory::KernelHeap<bare::Memory::DefaultKernelHeapSize, bare::Memory::DefaultPageSize> kernelHeap;
     bare::Memory::init(&kernelHeap);
-    timingTest("Memory perf with cache");
+    bare::Memory::setExpandFunction(kernelHeapExpand);
+    bare::Serial::printf(FMT("Bootstrap heap: %d of %d bytes used\n"),
+        static_cast<uint32_t>(bare::Memory::bootstrapHeapUsed()), static_cast<uint32_t>(bare::Memory::bootstrapHeapSize()));
     
     bare::Timer::setCurrentTime(bare::RealTime(2018, 10, 5, 10, 19));
     showTime();
     
     // Test file read
-    bare::Serial::printf("File read test...\n");
+    bare::Serial::printf(FMT("File read test...\n"));
     File* fp = FileSystem::sharedFileSystem()->open("sample.txt", FileSystem::OpenMode::Read, FileSystem::OpenOption::Update);
     if (!fp->valid()) {
-        bare::Serial::printf("File read open error for '%s': %s\n", "sample.txt", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+        bare::Serial::printf(FMT("File read open error for '%s': %s\n"), "sample.txt", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
     } else {
         char buf[26];
         fp->seek(511, File::SeekWhence::Set);
         int32_t size = fp->read(buf, 25);
         buf[25] = '\0';
         if (size < 0) {
-            bare::Serial::printf("File read error: %s\n", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+            bare::Serial::printf(FMT("File read error: %s\n"), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
         } else {
-            bare::Serial::printf("File read:'%s'\n", buf);
+            bare::Serial::printf(FMT("File read:'%s'\n"), buf);
         }
     }
     
     // Test update
-    bare::Serial::printf("File update test...\n");
+    bare::Serial::printf(FMT("File update test...\n"));
     fp->seek(518, File::SeekWhence::Set);
     int32_t size = fp->write("0123456789", 10);
     if (size < 0) {
-        bare::Serial::printf("File update error: %s\n", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+        bare::Serial::printf(FMT("File update error: %s\n"), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
     } else {
         fp->seek(-17, File::SeekWhence::Cur);
         char buf[26];
         int32_t size = fp->read(buf, 25);
         buf[25] = '\0';
         if (size < 0) {
-            bare::Serial::printf("Reading back after update error: %s\n", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+            bare::Serial::printf(FMT("Reading back after update error: %s\n"), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
         } else {
-            bare::Serial::printf("After update read:'%s'\n", buf);
+            bare::Serial::printf(FMT("After update read:'%s'\n"), buf);
         }
     }
     
     // Repair the file
-    bare::Serial::printf("File repair test...\n");
+    bare::Serial::printf(FMT("File repair test...\n"));
     fp->seek(518, File::SeekWhence::Set);
     size = fp->write("altogether", 10);
     if (size < 0) {
-        bare::Serial::printf("File repair error: %s\n", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+        bare::Serial::printf(FMT("File repair error: %s\n"), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
     } else {
         fp->seek(-17, File::SeekWhence::Cur);
         char buf[26];
         int32_t size = fp->read(buf, 25);
         buf[25] = '\0';
         if (size < 0) {
-            bare::Serial::printf("Reading back after repair error: %s\n", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+            bare::Serial::printf(FMT("Reading back after repair error: %s\n"), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
         } else {
-            bare::Serial::printf("After repair read:'%s'\n", buf);
+            bare::Serial::printf(FMT("After repair read:'%s'\n"), buf);
         }
     }
 
@@ -168,23 +163,23 @@ int main()
     fp = nullptr;
     
     // Test file write
-    bare::Serial::printf("File write test...\n");
+    bare::Serial::printf(FMT("File write test...\n"));
     FileSystem::sharedFileSystem()->remove("test.txt");
     
     fp = FileSystem::sharedFileSystem()->open("test.txt", FileSystem::OpenMode::Write);
     if (!fp->valid()) {
-        bare::Serial::printf("File write open error for '%s': %s\n", "test.txt", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+        bare::Serial::printf(FMT("File write open error for '%s': %s\n"), "test.txt", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
     } else {
         int32_t size = fp->write("The quick brown fox", 19);
         if (size < 0) {
-            bare::Serial::printf("File write error: %s\n", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+            bare::Serial::printf(FMT("File write error: %s\n"), FileSystem::sharedFileSystem()->errorDetail(fp->error()));
         } else {
-            bare::Serial::printf("File write successful\n");
+            bare::Serial::printf(FMT("File write successful\n"));
         }
     }
     
     if (fp->close() != bare::Volume::Error::OK) {
-        bare::Serial::printf("File write close error for '%s': %s\n", "test.txt", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
+        bare::Serial::printf(FMT("File write close error for '%s': %s\n"), "test.txt", FileSystem::sharedFileSystem()->errorDetail(fp->error()));
     }
     
     delete fp;
@@ -201,6 +196,12 @@ int main()
 	shell.connected();
 
 	while (1) {
+        // Drain deferred log entries while there's no input. Once they're
+        // gone, wait for input in read
+        if (!bare::Serial::rxReady() && bare::Log::idle()) {
+            continue;
+        }
+        
         uint8_t c;
         if (bare::Serial::read(c) != bare::Serial::Error::OK) {
             bare::Serial::puts("*** Serial Read Error\n");